@@ -0,0 +1,257 @@
+#include "alloc_stats.hpp"
+
+#ifdef CRONA_ALLOC_STATS
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <new>
+
+namespace crona{
+
+static const char * const TAG_NAMES[AllocStats::TAG_COUNT] = {
+	"other", "tokens", "parser", "ast nodes", "symbols", "scopes",
+	"types", "node types"
+};
+
+//Sizes up to 16 bytes, then each power of two up to 8 KB, and
+// then everything larger
+static const size_t BUCKETS = 11;
+static const size_t MAX_PHASES = 32;
+
+static size_t bucketOf(size_t bytes){
+	size_t bucket = 0;
+	size_t limit = 16;
+	while (bytes > limit && bucket + 1 < BUCKETS){
+		limit *= 2;
+		bucket++;
+	}
+	return bucket;
+}
+
+//What one phase allocated for one subsystem. Every member is
+// zero before any constructor runs, so allocations made during
+// static initialization are counted too.
+class AllocCell{
+public:
+	std::atomic<size_t> allocs;
+	std::atomic<size_t> bytes;
+	std::atomic<size_t> live;
+	std::atomic<size_t> peak;
+	std::atomic<size_t> sizes[BUCKETS];
+};
+
+static AllocCell cells[MAX_PHASES][AllocStats::TAG_COUNT];
+static std::atomic<size_t> totalLive;
+static std::atomic<size_t> totalPeak;
+
+//Phase 0 is for allocations made outside any phase
+static std::atomic<const char *> phaseNames[MAX_PHASES];
+static std::atomic<size_t> phaseCount;
+static std::mutex phaseLock;
+
+static thread_local AllocStats::Tag threadTag = AllocStats::OTHER;
+static thread_local size_t threadPhase = 0;
+
+//Each block starts with a header saying how big it is and what
+// it was counted against. It is as large as the alignment
+// operator new must give, so the block after it is aligned.
+class AllocHeader{
+public:
+	size_t bytes;
+	size_t cell;
+};
+static const size_t HEADER_BYTES = alignof(std::max_align_t) > sizeof(AllocHeader)
+  ? alignof(std::max_align_t) : sizeof(AllocHeader);
+
+static void raisePeak(std::atomic<size_t>& peak, size_t now){
+	size_t seen = peak.load(std::memory_order_relaxed);
+	while (now > seen
+	  && !peak.compare_exchange_weak(seen, now, std::memory_order_relaxed)){
+	}
+}
+
+void * AllocStats::allocateOrNull(size_t bytes, Tag tag){
+	char * raw = static_cast<char *>(malloc(HEADER_BYTES + bytes));
+	if (raw == nullptr){ return nullptr; }
+	AllocHeader * header = reinterpret_cast<AllocHeader *>(raw);
+	header->bytes = bytes;
+	header->cell = threadPhase * TAG_COUNT + static_cast<size_t>(tag);
+	AllocCell& cell = cells[threadPhase][tag];
+	cell.allocs.fetch_add(1, std::memory_order_relaxed);
+	cell.bytes.fetch_add(bytes, std::memory_order_relaxed);
+	cell.sizes[bucketOf(bytes)].fetch_add(1, std::memory_order_relaxed);
+	raisePeak(cell.peak,
+		cell.live.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+	raisePeak(totalPeak,
+		totalLive.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+	return raw + HEADER_BYTES;
+}
+
+void * AllocStats::allocate(size_t bytes, Tag tag){
+	void * ptr = allocateOrNull(bytes, tag);
+	if (ptr == nullptr){ throw std::bad_alloc(); }
+	return ptr;
+}
+
+void AllocStats::release(void * ptr){
+	if (ptr == nullptr){ return; }
+	char * raw = static_cast<char *>(ptr) - HEADER_BYTES;
+	AllocHeader * header = reinterpret_cast<AllocHeader *>(raw);
+	AllocCell& cell = cells[header->cell / TAG_COUNT][header->cell % TAG_COUNT];
+	cell.live.fetch_sub(header->bytes, std::memory_order_relaxed);
+	totalLive.fetch_sub(header->bytes, std::memory_order_relaxed);
+	free(raw);
+}
+
+AllocStats::Tag AllocStats::currentTag(){ return threadTag; }
+
+AllocStats::Scope::Scope(Tag tag) : prev(threadTag){
+	threadTag = tag;
+}
+
+AllocStats::Scope::~Scope(){
+	threadTag = prev;
+}
+
+AllocStats::PhaseScope::PhaseScope(const char * phase)
+: prev(threadPhase){
+	//Phases are found by name, and there are few of them
+	size_t count = phaseCount.load(std::memory_order_acquire);
+	for (size_t k = 1; k < count; k++){
+		if (strcmp(phaseNames[k].load(std::memory_order_relaxed), phase) == 0){
+			threadPhase = k;
+			return;
+		}
+	}
+	std::lock_guard<std::mutex> guard(phaseLock);
+	count = phaseCount.load(std::memory_order_relaxed);
+	if (count == 0){ count = 1; }
+	for (size_t k = 1; k < count; k++){
+		if (strcmp(phaseNames[k].load(std::memory_order_relaxed), phase) == 0){
+			threadPhase = k;
+			return;
+		}
+	}
+	if (count == MAX_PHASES){
+		//Past the limit, the rest are counted outside any phase
+		threadPhase = 0;
+		return;
+	}
+	phaseNames[count].store(phase, std::memory_order_relaxed);
+	phaseCount.store(count + 1, std::memory_order_release);
+	threadPhase = count;
+}
+
+AllocStats::PhaseScope::~PhaseScope(){
+	threadPhase = prev;
+}
+
+static void putSizes(std::ostream& out, const AllocCell& cell){
+	size_t limit = 16;
+	for (size_t k = 0; k < BUCKETS; k++, limit *= 2){
+		size_t count = cell.sizes[k].load();
+		if (count == 0){ continue; }
+		if (k + 1 < BUCKETS){
+			out << " <=" << limit << ":" << count;
+		} else {
+			out << " >" << limit / 2 << ":" << count;
+		}
+	}
+}
+
+void AllocStats::report(std::ostream& out){
+	//What the report itself allocates is counted as other
+	Scope quiet(OTHER);
+	size_t phases = phaseCount.load();
+	if (phases == 0){ phases = 1; }
+	out << "allocations\n";
+	out << std::left << std::setw(22) << "phase" << std::setw(12)
+	  << "subsystem" << std::right << std::setw(11) << "count"
+	  << std::setw(14) << "bytes" << std::setw(14) << "peak live"
+	  << std::setw(14) << "live" << "  sizes\n";
+	size_t tagAllocs[TAG_COUNT] = {};
+	size_t tagBytes[TAG_COUNT] = {};
+	for (size_t p = 0; p < phases; p++){
+		const char * phase = p == 0 ? "(no phase)" : phaseNames[p].load();
+		for (size_t t = 0; t < TAG_COUNT; t++){
+			AllocCell& cell = cells[p][t];
+			size_t allocs = cell.allocs.load();
+			if (allocs == 0){ continue; }
+			tagAllocs[t] += allocs;
+			tagBytes[t] += cell.bytes.load();
+			out << std::left << std::setw(22) << phase << std::setw(12)
+			  << TAG_NAMES[t] << std::right << std::setw(11) << allocs
+			  << std::setw(14) << cell.bytes.load()
+			  << std::setw(14) << cell.peak.load()
+			  << std::setw(14) << cell.live.load() << " ";
+			putSizes(out, cell);
+			out << "\n";
+		}
+	}
+	size_t allAllocs = 0;
+	size_t allBytes = 0;
+	for (size_t t = 0; t < TAG_COUNT; t++){
+		if (tagAllocs[t] == 0){ continue; }
+		allAllocs += tagAllocs[t];
+		allBytes += tagBytes[t];
+		out << std::left << std::setw(22) << "(all phases)" << std::setw(12)
+		  << TAG_NAMES[t] << std::right << std::setw(11) << tagAllocs[t]
+		  << std::setw(14) << tagBytes[t] << "\n";
+	}
+	out << std::left << std::setw(34) << "total" << std::right
+	  << std::setw(11) << allAllocs << std::setw(14) << allBytes
+	  << std::setw(14) << totalPeak.load()
+	  << std::setw(14) << totalLive.load() << "\n";
+	out.flush();
+}
+
+}
+
+//Every other allocation is counted against the subsystem of the
+// scope it is made in
+void * operator new(size_t bytes){
+	return crona::AllocStats::allocate(bytes, crona::AllocStats::currentTag());
+}
+
+void * operator new[](size_t bytes){
+	return crona::AllocStats::allocate(bytes, crona::AllocStats::currentTag());
+}
+
+void * operator new(size_t bytes, const std::nothrow_t&) noexcept{
+	return crona::AllocStats::allocateOrNull(bytes,
+		crona::AllocStats::currentTag());
+}
+
+void * operator new[](size_t bytes, const std::nothrow_t&) noexcept{
+	return crona::AllocStats::allocateOrNull(bytes,
+		crona::AllocStats::currentTag());
+}
+
+void operator delete(void * ptr) noexcept{
+	crona::AllocStats::release(ptr);
+}
+
+void operator delete[](void * ptr) noexcept{
+	crona::AllocStats::release(ptr);
+}
+
+void operator delete(void * ptr, size_t) noexcept{
+	crona::AllocStats::release(ptr);
+}
+
+void operator delete[](void * ptr, size_t) noexcept{
+	crona::AllocStats::release(ptr);
+}
+
+void operator delete(void * ptr, const std::nothrow_t&) noexcept{
+	crona::AllocStats::release(ptr);
+}
+
+void operator delete[](void * ptr, const std::nothrow_t&) noexcept{
+	crona::AllocStats::release(ptr);
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef CRONA_ALLOC_STATS_HPP
+#define CRONA_ALLOC_STATS_HPP
+
+// Allocation accounting, for --alloc-stats. It is only built in
+// with CRONA_ALLOC_STATS defined (make ALLOC_STATS=1); otherwise
+// the macros below expand to nothing and none of it is compiled.
+//
+// With it built in, every allocation is counted against the
+// phase running on its thread and a subsystem. A class's own
+// objects are counted against its subsystem wherever they are
+// made (CRONA_ALLOC_CLASS); anything else made inside a
+// CRONA_ALLOC_TAG scope, such as the containers of a symbol
+// table, is counted against that scope's subsystem. For each
+// phase and subsystem it keeps the number of allocations, their
+// bytes, the peak of the bytes live at once, and a histogram
+// of their sizes.
+
+#ifdef CRONA_ALLOC_STATS
+
+#include <cstddef>
+#include <ostream>
+
+namespace crona{
+
+class AllocStats{
+public:
+	enum Tag{
+		OTHER, TOKENS, PARSER, AST_NODES, SYMBOLS, SCOPES, TYPES,
+		NODE_TYPES, TAG_COUNT
+	};
+
+	static void * allocate(size_t bytes, Tag tag);
+	//May return null instead of throwing std::bad_alloc
+	static void * allocateOrNull(size_t bytes, Tag tag);
+	static void release(void * ptr);
+
+	//The subsystem of the calling thread's allocations
+	static Tag currentTag();
+
+	//Counts what the calling thread allocates against tag, for
+	// as long as it exists
+	class Scope{
+	public:
+		Scope(Tag tag);
+		~Scope();
+	private:
+		Tag prev;
+	};
+
+	//Counts what the calling thread allocates against the named
+	// phase, for as long as it exists
+	class PhaseScope{
+	public:
+		PhaseScope(const char * phase);
+		~PhaseScope();
+	private:
+		size_t prev;
+	};
+
+	//A table of everything counted so far
+	static void report(std::ostream& out);
+};
+
+}
+
+#define CRONA_ALLOC_TAG(tag) \
+	crona::AllocStats::Scope allocScope(crona::AllocStats::tag)
+
+//In the public part of a class, to count its objects against tag
+#define CRONA_ALLOC_CLASS(tag) \
+	static void * operator new(size_t bytes){ \
+		return crona::AllocStats::allocate(bytes, crona::AllocStats::tag); \
+	} \
+	static void operator delete(void * ptr){ \
+		crona::AllocStats::release(ptr); \
+	}
+
+#else
+
+#define CRONA_ALLOC_TAG(tag)
+#define CRONA_ALLOC_CLASS(tag)
+
+#endif
+
+#endif
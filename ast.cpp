@@ -0,0 +1,113 @@
+#include "ast.hpp"
+#include "module.hpp"
+
+namespace crona{
+
+template <typename Node>
+static void deleteAll(std::list<Node *> * nodes){
+	if (nodes == nullptr){ return; }
+	for (auto node : *nodes){
+		delete node;
+	}
+	delete nodes;
+}
+
+ImportNode::~ImportNode(){
+	delete myModule;
+}
+
+void ImportNode::setModule(ModuleInterface * module){
+	delete myModule;
+	myModule = module;
+}
+
+ProgramNode::~ProgramNode(){
+	deleteAll(myImports);
+	deleteAll(myGlobals);
+}
+
+IndexNode::~IndexNode(){
+	delete myBase;
+	delete myOffset;
+}
+
+VarDeclNode::~VarDeclNode(){
+	delete myType;
+	delete myID;
+}
+
+FnDeclNode::~FnDeclNode(){
+	delete myID;
+	delete myRetType;
+	deleteAll(myFormals);
+	deleteAll(myBody);
+}
+
+AssignStmtNode::~AssignStmtNode(){
+	delete myExp;
+}
+
+ReadStmtNode::~ReadStmtNode(){
+	delete myDst;
+}
+
+WriteStmtNode::~WriteStmtNode(){
+	delete mySrc;
+}
+
+PostDecStmtNode::~PostDecStmtNode(){
+	delete myLVal;
+}
+
+PostIncStmtNode::~PostIncStmtNode(){
+	delete myLVal;
+}
+
+IfStmtNode::~IfStmtNode(){
+	delete myCond;
+	deleteAll(myBody);
+}
+
+IfElseStmtNode::~IfElseStmtNode(){
+	delete myCond;
+	deleteAll(myBodyTrue);
+	deleteAll(myBodyFalse);
+}
+
+WhileStmtNode::~WhileStmtNode(){
+	delete myCond;
+	deleteAll(myBody);
+}
+
+ReturnStmtNode::~ReturnStmtNode(){
+	delete myExp;
+}
+
+CallExpNode::~CallExpNode(){
+	delete myID;
+	deleteAll(myArgs);
+}
+
+BinaryExpNode::~BinaryExpNode(){
+	delete myExp1;
+	delete myExp2;
+}
+
+UnaryExpNode::~UnaryExpNode(){
+	delete myExp;
+}
+
+ArrayTypeNode::~ArrayTypeNode(){
+	delete myBase;
+}
+
+AssignExpNode::~AssignExpNode(){
+	delete myDst;
+	delete mySrc;
+}
+
+CallStmtNode::~CallStmtNode(){
+	delete myCallExp;
+}
+
+}
@@ -7,14 +7,19 @@
 #include <list>
 #include "tokens.hpp"
 #include "types.hpp"
+#include "out_buffer.hpp"
 
 namespace crona {
 
 class NameAnalysis;
 class TypeAnalysis;
+class Layout;
+class CallGraph;
+class Census;
 
 class SymbolTable;
 class SemSymbol;
+class ModuleInterface;
 
 class DeclNode;
 class VarDeclNode;
@@ -28,9 +33,13 @@ class IDNode;
 
 class ASTNode{
 public:
+	CRONA_ALLOC_CLASS(AST_NODES)
 	ASTNode(size_t lineIn, size_t colIn)
-	: l(lineIn), c(colIn){ }
-	virtual void unparse(std::ostream&, int) = 0;
+	: l(lineIn), c(colIn){ TimeReport::counts().nodes++; }
+	//Each node owns its children, so deleting a node
+	// deletes the whole subtree below it
+	virtual ~ASTNode(){ }
+	virtual void unparse(OutBuffer&, int) = 0;
 	size_t line() const { return this->l; }
 	size_t col() const { return this->c; }
 	std::string pos(){
@@ -38,6 +47,8 @@ public:
 			+ std::to_string(col()) + "]";
 	}
 	virtual bool nameAnalysis(SymbolTable *) = 0;
+	//Count this node and its subtree, for --stats
+	virtual void census(Census *) = 0;
 	//Note that there is no ASTNode::typeAnalysis. To allow
 	// for different type signatures, type analysis is 
 	// implemented as needed in various subclasses
@@ -46,56 +57,117 @@ private:
 	size_t c;
 };
 
+//An import of another module's interface, written
+// import "name"; before the program's declarations. The
+// interface is read from name.cri beside the importing source.
+class ImportNode : public ASTNode{
+public:
+	ImportNode(size_t lIn, size_t cIn, std::string nameIn)
+	: ASTNode(lIn, cIn), myName(nameIn), myModule(nullptr){ }
+	~ImportNode();
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
+	//Declare the module's globals in the current scope
+	bool nameAnalysis(SymbolTable *) override;
+	std::string getName() const { return myName; }
+	//The interface imported, or null if it could not be read.
+	// The node owns it.
+	ModuleInterface * getModule() const { return myModule; }
+	void setModule(ModuleInterface * module);
+private:
+	std::string myName;
+	ModuleInterface * myModule;
+};
+
 class ProgramNode : public ASTNode{
 public:
-	ProgramNode(std::list<DeclNode *> * globalsIn)
-	: ASTNode(1,1), myGlobals(globalsIn){}
-	void unparse(std::ostream&, int) override;
+	ProgramNode(std::list<ImportNode *> * importsIn,
+	  std::list<DeclNode *> * globalsIn)
+	: ASTNode(1,1), myImports(importsIn), myGlobals(globalsIn), 
+	  mySize(0){}
+	std::list<ImportNode *> * getImports() const { return myImports; }
+	std::list<DeclNode *> * getGlobals() const { return myGlobals; }
+	//How many nodes are in the whole tree, as counted while
+	// parsing it
+	size_t size() const { return mySize; }
+	void setSize(size_t nodes){ mySize = nodes; }
+	void unparse(OutBuffer&, int) override;
+	void census(Census *) override;
+	//As unparse, with each global rendered into a buffer of its
+	// own by one of the given number of threads
+	void unparseParallel(OutBuffer&, size_t workers);
 	virtual bool nameAnalysis(SymbolTable *) override;
 	virtual void typeAnalysis(TypeAnalysis *);
+	virtual void layout(Layout *);
+	virtual void callGraph(CallGraph *);
+	~ProgramNode();
 private:
+	std::list<ImportNode *> * myImports;
 	std::list<DeclNode *> * myGlobals;
+	size_t mySize;
 };
 
 class ExpNode : public ASTNode{
 public:
 	ExpNode(size_t lIn, size_t cIn) : ASTNode(lIn, cIn){ }
-	virtual void unparseNested(std::ostream& out);
-	virtual void unparse(std::ostream& out, int indent) override = 0;
+	virtual void unparseNested(OutBuffer& out);
+	virtual void unparse(OutBuffer& out, int indent) override = 0;
+	void census(Census *) override;
 	virtual bool nameAnalysis(SymbolTable * symTab) override = 0;
 	virtual void typeAnalysis(TypeAnalysis *);
+	virtual void layout(Layout *);
+	virtual void callGraph(CallGraph *);
 };
 
 class LValNode : public ExpNode{
 public:
 	LValNode(size_t lIn, size_t cIn) : ExpNode(lIn, cIn){}
-	void unparse(std::ostream& out, int indent) override = 0;
-	void unparseNested(std::ostream& out) override;
+	void unparse(OutBuffer& out, int indent) override = 0;
+	void unparseNested(OutBuffer& out) override;
 	bool nameAnalysis(SymbolTable * symTab) override { return false; }
 };
 
 class IDNode : public LValNode{
 public:
 	IDNode(size_t lIn, size_t cIn, std::string nameIn)
-	: LValNode(lIn, cIn), name(nameIn), mySymbol(nullptr){}
+	: LValNode(lIn, cIn), name(nameIn), mySymbol(nullptr),
+	  myStorage(UNALLOCATED), myOffset(0){}
 	std::string getName(){ return name; }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	void attachSymbol(SemSymbol * symbolIn);
 	SemSymbol * getSymbol() const { return mySymbol; }
+	//The address of the variable this ID refers to, copied
+	// from its symbol by the layout pass so that no symbol
+	// lookup is needed to reach the storage.
+	void attachLocation(StorageKind storageIn, size_t offsetIn){
+		myStorage = storageIn;
+		myOffset = offsetIn;
+	}
+	StorageKind getStorage() const { return myStorage; }
+	size_t getOffset() const { return myOffset; }
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
 private:
 	std::string name;
 	SemSymbol * mySymbol;
+	StorageKind myStorage;
+	size_t myOffset;
 };
 
 class IndexNode : public LValNode{
 public:
 	IndexNode(size_t l, size_t c, IDNode * id, ExpNode * offset)
 	: LValNode(l, c), myBase(id), myOffset(offset){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	virtual bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~IndexNode();
 private:
 	IDNode * myBase;
 	ExpNode * myOffset;
@@ -105,7 +177,8 @@ private:
 class TypeNode : public ASTNode{
 public:
 	TypeNode(size_t l, size_t c) : ASTNode(l, c){ }
-	void unparse(std::ostream&, int) override = 0;
+	void unparse(OutBuffer&, int) override = 0;
+	void census(Census *) override;
 	virtual DataType * getType() = 0;
 	virtual bool nameAnalysis(SymbolTable *) override;
 };
@@ -114,14 +187,18 @@ public:
 class StmtNode : public ASTNode{
 public:
 	StmtNode(size_t lIn, size_t cIn) : ASTNode(lIn, cIn){ }
-	virtual void unparse(std::ostream& out, int indent) override = 0;
+	virtual void unparse(OutBuffer& out, int indent) override = 0;
 	virtual void typeAnalysis(TypeAnalysis *);
+	virtual void layout(Layout *);
+	virtual void callGraph(CallGraph *);
 };
 
 class DeclNode : public StmtNode{
 public:
 	DeclNode(size_t l, size_t c) : StmtNode(l, c){ }
-	void unparse(std::ostream& out, int indent) override =0;
+	void unparse(OutBuffer& out, int indent) override =0;
+	//The identifier being declared
+	virtual IDNode * ID() const = 0;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
 
@@ -129,11 +206,15 @@ class VarDeclNode : public DeclNode{
 public:
 	VarDeclNode(size_t lIn, size_t cIn, TypeNode * typeIn, IDNode * IDIn)
 	: DeclNode(lIn, cIn), myType(typeIn), myID(IDIn){ }
-	void unparse(std::ostream& out, int indent) override;
-	IDNode * ID(){ return myID; }
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
+	IDNode * ID() const override { return myID; }
 	TypeNode * getTypeNode(){ return myType; }
 	virtual bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~VarDeclNode();
 private:
 	TypeNode * myType;
 	IDNode * myID;
@@ -143,7 +224,7 @@ class FormalDeclNode : public VarDeclNode{
 public:
 	FormalDeclNode(size_t lIn, size_t cIn, TypeNode * type, IDNode * id) 
 	: VarDeclNode(lIn, cIn, type, id){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 };
 
 class FnDeclNode : public DeclNode{
@@ -154,31 +235,44 @@ public:
 	  std::list<StmtNode *> * bodyIn)
 	: DeclNode(lIn, cIn), 
 	  myID(idIn), myRetType(retTypeIn),
-	  myFormals(formalsIn), myBody(bodyIn){ }
-	IDNode * ID() const { return myID; }
+	  myFormals(formalsIn), myBody(bodyIn), mySize(0){ }
+	IDNode * ID() const override { return myID; }
+	//How many nodes are in this function's subtree, as
+	// counted by the parser
+	size_t size() const { return mySize; }
+	void setSize(size_t nodes){ mySize = nodes; }
 	std::list<FormalDeclNode *> * getFormals() const{
 		return myFormals;
 	}
 	virtual TypeNode * getRetTypeNode() { 
 		return myRetType;
 	}
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	virtual bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~FnDeclNode();
 private:
 	IDNode * myID;
 	TypeNode * myRetType;
 	std::list<FormalDeclNode *> * myFormals;
 	std::list<StmtNode *> * myBody;
+	size_t mySize;
 };
 
 class AssignStmtNode : public StmtNode{
 public:
 	AssignStmtNode(size_t l, size_t c, AssignExpNode * expIn)
 	: StmtNode(l, c), myExp(expIn){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~AssignStmtNode();
 private:
 	AssignExpNode * myExp;
 };
@@ -187,9 +281,13 @@ class ReadStmtNode : public StmtNode{
 public:
 	ReadStmtNode(size_t l, size_t c, LValNode * dstIn)
 	: StmtNode(l, c), myDst(dstIn){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~ReadStmtNode();
 private:
 	LValNode * myDst;
 };
@@ -198,9 +296,13 @@ class WriteStmtNode : public StmtNode{
 public:
 	WriteStmtNode(size_t l, size_t c, ExpNode * srcIn)
 	: StmtNode(l, c), mySrc(srcIn){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~WriteStmtNode();
 private:
 	ExpNode * mySrc;
 };
@@ -209,9 +311,13 @@ class PostDecStmtNode : public StmtNode{
 public:
 	PostDecStmtNode(size_t l, size_t c, LValNode * lvalIn)
 	: StmtNode(l, c), myLVal(lvalIn){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	virtual bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~PostDecStmtNode();
 private:
 	LValNode * myLVal;
 };
@@ -220,9 +326,13 @@ class PostIncStmtNode : public StmtNode{
 public:
 	PostIncStmtNode(size_t l, size_t c, LValNode * lvalIn)
 	: StmtNode(l, c), myLVal(lvalIn){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	virtual bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~PostIncStmtNode();
 private:
 	LValNode * myLVal;
 };
@@ -232,9 +342,13 @@ public:
 	IfStmtNode(size_t l, size_t c, ExpNode * condIn,
 	  std::list<StmtNode *> * bodyIn)
 	: StmtNode(l, c), myCond(condIn), myBody(bodyIn){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~IfStmtNode();
 private:
 	ExpNode * myCond;
 	std::list<StmtNode *> * myBody;
@@ -247,9 +361,13 @@ public:
 	  std::list<StmtNode *> * bodyFalseIn)
 	: StmtNode(l, c), myCond(condIn),
 	  myBodyTrue(bodyTrueIn), myBodyFalse(bodyFalseIn) { }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~IfElseStmtNode();
 private:
 	ExpNode * myCond;
 	std::list<StmtNode *> * myBodyTrue;
@@ -261,9 +379,13 @@ public:
 	WhileStmtNode(size_t l, size_t c, ExpNode * condIn, 
 	  std::list<StmtNode *> * bodyIn)
 	: StmtNode(l, c), myCond(condIn), myBody(bodyIn){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~WhileStmtNode();
 private:
 	ExpNode * myCond;
 	std::list<StmtNode *> * myBody;
@@ -273,9 +395,13 @@ class ReturnStmtNode : public StmtNode{
 public:
 	ReturnStmtNode(size_t l, size_t c, ExpNode * exp)
 	: StmtNode(l, c), myExp(exp){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~ReturnStmtNode();
 private:
 	ExpNode * myExp;
 };
@@ -285,10 +411,14 @@ public:
 	CallExpNode(size_t l, size_t c, IDNode * id,
 	  std::list<ExpNode *> * argsIn)
 	: ExpNode(l, c), myID(id), myArgs(argsIn){ }
-	void unparse(std::ostream& out, int indent) override;
-	void unparseNested(std::ostream& out) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
+	void unparseNested(OutBuffer& out) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~CallExpNode();
 private:
 	IDNode * myID;
 	std::list<ExpNode *> * myArgs;
@@ -298,12 +428,16 @@ class BinaryExpNode : public ExpNode{
 public:
 	BinaryExpNode(size_t lIn, size_t cIn, ExpNode * lhs, ExpNode * rhs)
 	: ExpNode(lIn, cIn), myExp1(lhs), myExp2(rhs) { }
+	void census(Census *) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override = 0;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
 	void mathTypeAnalysis(TypeAnalysis * ta);
 	void logicTypeAnalysis(TypeAnalysis * ta);
 	void equalityTypeAnalysis(TypeAnalysis * ta);
 	void relationalTypeAnalysis(TypeAnalysis * ta);
+	~BinaryExpNode();
 protected:
 	ExpNode * myExp1;
 	ExpNode * myExp2;
@@ -313,7 +447,7 @@ class PlusNode : public BinaryExpNode{
 public:
 	PlusNode(size_t l, size_t c, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(l, c, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
 
@@ -321,7 +455,7 @@ class MinusNode : public BinaryExpNode{
 public:
 	MinusNode(size_t l, size_t c, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(l, c, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
 
@@ -329,7 +463,7 @@ class TimesNode : public BinaryExpNode{
 public:
 	TimesNode(size_t l, size_t c, ExpNode * e1In, ExpNode * e2In)
 	: BinaryExpNode(l, c, e1In, e2In){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
 
@@ -337,7 +471,7 @@ class DivideNode : public BinaryExpNode{
 public:
 	DivideNode(size_t lIn, size_t cIn, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(lIn, cIn, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
 
@@ -345,7 +479,7 @@ class AndNode : public BinaryExpNode{
 public:
 	AndNode(size_t l, size_t c, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(l, c, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
 
@@ -353,7 +487,7 @@ class OrNode : public BinaryExpNode{
 public:
 	OrNode(size_t l, size_t c, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(l, c, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
 
@@ -361,7 +495,7 @@ class EqualsNode : public BinaryExpNode{
 public:
 	EqualsNode(size_t l, size_t c, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(l, c, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
 
@@ -369,7 +503,7 @@ class NotEqualsNode : public BinaryExpNode{
 public:
 	NotEqualsNode(size_t l, size_t c, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(l, c, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
 
@@ -378,7 +512,7 @@ public:
 	LessNode(size_t lineIn, size_t colIn, 
 		ExpNode * exp1, ExpNode * exp2)
 	: BinaryExpNode(lineIn, colIn, exp1, exp2){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
 
@@ -386,7 +520,7 @@ class LessEqNode : public BinaryExpNode{
 public:
 	LessEqNode(size_t l, size_t c, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(l, c, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
 
@@ -395,7 +529,7 @@ public:
 	GreaterNode(size_t lineIn, size_t colIn, 
 		ExpNode * exp1, ExpNode * exp2)
 	: BinaryExpNode(lineIn, colIn, exp1, exp2){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
 
@@ -403,7 +537,7 @@ class GreaterEqNode : public BinaryExpNode{
 public:
 	GreaterEqNode(size_t l, size_t c, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(l, c, e1, e2){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
 
@@ -413,9 +547,13 @@ public:
 	: ExpNode(lIn, cIn){
 		this->myExp = expIn;
 	}
-	virtual void unparse(std::ostream& out, int indent) override = 0;
+	virtual void unparse(OutBuffer& out, int indent) override = 0;
+	void census(Census *) override;
 	virtual bool nameAnalysis(SymbolTable * symTab) override = 0;
 	virtual void typeAnalysis(TypeAnalysis *) override = 0;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~UnaryExpNode();
 protected:
 	ExpNode * myExp;
 };
@@ -424,7 +562,7 @@ class NegNode : public UnaryExpNode{
 public:
 	NegNode(size_t l, size_t c, ExpNode * exp)
 	: UnaryExpNode(l, c, exp){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
@@ -433,7 +571,7 @@ class NotNode : public UnaryExpNode{
 public:
 	NotNode(size_t lIn, size_t cIn, ExpNode * exp)
 	: UnaryExpNode(lIn, cIn, exp){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
@@ -441,7 +579,7 @@ public:
 class VoidTypeNode : public TypeNode{
 public:
 	VoidTypeNode(size_t l, size_t c) : TypeNode(l, c){}
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual DataType * getType() override { 
 		return BasicType::VOID(); 
 	}
@@ -450,33 +588,35 @@ public:
 class IntTypeNode : public TypeNode{
 public:
 	IntTypeNode(size_t l, size_t c): TypeNode(l, c){}
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual DataType * getType() override;
 };
 
 class BoolTypeNode : public TypeNode{
 public:
 	BoolTypeNode(size_t l, size_t c): TypeNode(l, c) { }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual DataType * getType() override;
 };
 
 class ByteTypeNode : public TypeNode{
 public:
 	ByteTypeNode(size_t l, size_t c): TypeNode(l, c) { }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	virtual DataType * getType() override;
 };
 
 class ArrayTypeNode : public TypeNode{
 public:
 	ArrayTypeNode(size_t l, size_t c, TypeNode * base, size_t len): TypeNode(l, c), myLen(len), myBase(base){}
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	virtual TypeNode * getBase() { return myBase; }
 	virtual DataType * getType() override {
 		const BasicType * t = myBase->getType()->asBasic();
 		return ArrayType::produce(t, myLen);
 	}
+	~ArrayTypeNode();
 private:
 	size_t myLen;
 	TypeNode * myBase;
@@ -487,9 +627,13 @@ class AssignExpNode : public ExpNode{
 public:
 	AssignExpNode(size_t l, size_t c, LValNode * dstIn, ExpNode * srcIn)
 	: ExpNode(l, c), myDst(dstIn), mySrc(srcIn){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~AssignExpNode();
 private:
 	LValNode * myDst;
 	ExpNode * mySrc;
@@ -499,10 +643,11 @@ class IntLitNode : public ExpNode{
 public:
 	IntLitNode(size_t l, size_t c, const int numIn)
 	: ExpNode(l, c), myNum(numIn){ }
-	virtual void unparseNested(std::ostream& out) override{
+	virtual void unparseNested(OutBuffer& out) override{
 		unparse(out, 0);
 	}
-	void unparse(std::ostream& out, int indent) override;
+	void census(Census *) override;
+	void unparse(OutBuffer& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 private:
@@ -513,10 +658,10 @@ class HavocNode : public ExpNode{
 public:
 	HavocNode(size_t l, size_t c)
 	: ExpNode(l, c){ }
-	virtual void unparseNested(std::ostream& out) override{
+	virtual void unparseNested(OutBuffer& out) override{
 		unparse(out, 0);
 	}
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
@@ -525,10 +670,11 @@ class StrLitNode : public ExpNode{
 public:
 	StrLitNode(size_t l, size_t c, const std::string strIn)
 	: ExpNode(l, c), myStr(strIn){ }
-	virtual void unparseNested(std::ostream& out) override{
+	virtual void unparseNested(OutBuffer& out) override{
 		unparse(out, 0);
 	}
-	void unparse(std::ostream& out, int indent) override;
+	void census(Census *) override;
+	void unparse(OutBuffer& out, int indent) override;
 	bool nameAnalysis(SymbolTable *) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 private:
@@ -538,10 +684,10 @@ private:
 class TrueNode : public ExpNode{
 public:
 	TrueNode(size_t l, size_t c): ExpNode(l, c){ }
-	virtual void unparseNested(std::ostream& out) override{
+	virtual void unparseNested(OutBuffer& out) override{
 		unparse(out, 0);
 	}
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
@@ -549,10 +695,10 @@ public:
 class FalseNode : public ExpNode{
 public:
 	FalseNode(size_t l, size_t c): ExpNode(l, c){ }
-	virtual void unparseNested(std::ostream& out) override{
+	virtual void unparseNested(OutBuffer& out) override{
 		unparse(out, 0);
 	}
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
 };
@@ -561,9 +707,13 @@ class CallStmtNode : public StmtNode{
 public:
 	CallStmtNode(size_t l, size_t c, CallExpNode * expIn)
 	: StmtNode(l, c), myCallExp(expIn){ }
-	void unparse(std::ostream& out, int indent) override;
+	void unparse(OutBuffer& out, int indent) override;
+	void census(Census *) override;
 	bool nameAnalysis(SymbolTable * symTab) override;
 	virtual void typeAnalysis(TypeAnalysis *) override;
+	virtual void layout(Layout *) override;
+	virtual void callGraph(CallGraph *) override;
+	~CallStmtNode();
 private:
 	CallExpNode * myCallExp;
 };
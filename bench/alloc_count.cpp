@@ -0,0 +1,40 @@
+#include <cstdlib>
+#include <new>
+#include "alloc_count.hpp"
+
+#ifndef CRONA_ALLOC_STATS
+
+//The benchmarks run on one thread
+static size_t count = 0;
+
+namespace crona{
+
+bool AllocCount::counting(){ return true; }
+size_t AllocCount::allocations(){ return count; }
+
+}
+
+static void * allocate(size_t bytes){
+	count++;
+	void * ptr = malloc(bytes == 0 ? 1 : bytes);
+	if (ptr == nullptr){ throw std::bad_alloc(); }
+	return ptr;
+}
+
+void * operator new(size_t bytes){ return allocate(bytes); }
+void * operator new[](size_t bytes){ return allocate(bytes); }
+void operator delete(void * ptr) noexcept{ free(ptr); }
+void operator delete[](void * ptr) noexcept{ free(ptr); }
+void operator delete(void * ptr, size_t) noexcept{ free(ptr); }
+void operator delete[](void * ptr, size_t) noexcept{ free(ptr); }
+
+#else
+
+namespace crona{
+
+bool AllocCount::counting(){ return false; }
+size_t AllocCount::allocations(){ return 0; }
+
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef CRONA_BENCH_ALLOC_COUNT
+#define CRONA_BENCH_ALLOC_COUNT
+
+#include <cstddef>
+
+namespace crona{
+
+// Counts the allocations made through operator new, which it
+// replaces. When the objects under test were built with
+// ALLOC_STATS=1 they replace operator new themselves, and nothing
+// is counted.
+class AllocCount{
+public:
+	static bool counting();
+	static size_t allocations();
+};
+
+}
+
+#endif
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "runner.hpp"
+
+using namespace crona;
+
+static void usageAndDie(){
+	std::cerr << "Usage: cronabench [options]\n"
+	<< "Run cronac over generated programs of growing size, and"
+	<< " write the throughput and peak memory of each run as one"
+	<< " JSON object per line\n"
+	<< " [--cronac <path>]: The compiler to run (default ../cronac)\n"
+	<< " [--sizes <n>[K|M|G],...]: Program sizes"
+	<< " (default 1K,8K,64K,512K,4M,32M,256M,1G)\n"
+	<< " [--modes <mode>,...]: Any of t, p, u, n and c"
+	<< " (default t,p,u,n,c)\n"
+	<< " [--reps <n>]: Runs of each, keeping the fastest (default 3)\n"
+	<< " [--timeout <seconds>]: Stop a run after this long; larger"
+	<< " sizes of its mode are then skipped (default 300)\n"
+	<< " [--max-rss <MB>]: Limit each run's address space; a run"
+	<< " that fails is treated the same way (default no limit)\n"
+	<< " [--seed <n>]: Seed for the programs (default 1)\n"
+	<< " [--corpus <dir>]: Keep the programs in <dir>"
+	<< " (default corpus)\n"
+	<< " [-o <file>]: Write the results to <file> instead of stdout\n";
+	std::exit(1);
+}
+
+static void writeResult(std::ostream& out, const std::string& mode,
+	const std::string& sizeName, size_t bytes, const char * outcome,
+	const RunResult * best, size_t reps){
+	out << "{\"mode\":\"-" << mode << "\",\"size\":\"" << sizeName
+	  << "\",\"bytes\":" << bytes << ",\"result\":\"" << outcome << "\"";
+	if (best != nullptr){
+		double seconds = best->wallMs / 1e3;
+		double mbPerS = seconds > 0
+		  ? static_cast<double>(bytes) / (1 << 20) / seconds : 0;
+		out << std::fixed << std::setprecision(3)
+		  << ",\"reps\":" << reps
+		  << ",\"wall_ms\":" << best->wallMs
+		  << ",\"user_ms\":" << best->userMs
+		  << ",\"sys_ms\":" << best->sysMs
+		  << ",\"peak_rss_kb\":" << best->peakKB
+		  << ",\"mb_per_s\":" << mbPerS;
+	}
+	out << "}\n";
+	out.flush();
+}
+
+int main(int argc, char * argv[]){
+	std::string cronac = "../cronac";
+	const char * sizeList = "1K,8K,64K,512K,4M,32M,256M,1G";
+	const char * modeList = "t,p,u,n,c";
+	size_t reps = 3;
+	Runner runner;
+	runner.timeout = 300;
+	unsigned long long seed = 1;
+	std::string corpusDir = "corpus";
+	const char * outPath = nullptr;
+	for (int i = 1; i < argc; i++){
+		if (i + 1 >= argc){ usageAndDie(); }
+		const char * arg = argv[i];
+		const char * value = argv[++i];
+		if (strcmp(arg, "--cronac") == 0){
+			cronac = value;
+		} else if (strcmp(arg, "--sizes") == 0){
+			sizeList = value;
+		} else if (strcmp(arg, "--modes") == 0){
+			modeList = value;
+		} else if (strcmp(arg, "--reps") == 0){
+			reps = strtoul(value, nullptr, 10);
+			if (reps == 0){ usageAndDie(); }
+		} else if (strcmp(arg, "--timeout") == 0){
+			runner.timeout = static_cast<unsigned>(strtoul(value, nullptr, 10));
+			if (runner.timeout == 0){ usageAndDie(); }
+		} else if (strcmp(arg, "--max-rss") == 0){
+			runner.maxRssMB = strtoul(value, nullptr, 10);
+		} else if (strcmp(arg, "--seed") == 0){
+			seed = strtoull(value, nullptr, 10);
+		} else if (strcmp(arg, "--corpus") == 0){
+			corpusDir = value;
+		} else if (strcmp(arg, "-o") == 0){
+			outPath = value;
+		} else {
+			usageAndDie();
+		}
+	}
+
+	std::vector<std::pair<std::string, size_t>> sizes;
+	for (auto& name : Runner::splitList(sizeList)){
+		size_t bytes = 0;
+		if (!Runner::parseSize(name, bytes)){ usageAndDie(); }
+		sizes.push_back(std::make_pair(name, bytes));
+	}
+	std::vector<std::string> modes = Runner::splitList(modeList);
+	for (auto& mode : modes){
+		if (Runner::modeArgs(mode, "/dev/null").empty()){ usageAndDie(); }
+	}
+	if (access(cronac.c_str(), X_OK) != 0){
+		std::cerr << "No compiler at " << cronac << std::endl;
+		return 1;
+	}
+	std::ofstream outFile;
+	std::ostream * out = &std::cout;
+	if (outPath != nullptr){
+		outFile.open(outPath);
+		if (!outFile.good()){
+			std::cerr << "Bad output file " << outPath << std::endl;
+			return 1;
+		}
+		out = &outFile;
+	}
+
+	//Once a mode times out or fails at one size, it is not run
+	// at any larger one
+	std::vector<bool> stopped(modes.size(), false);
+	for (auto& size : sizes){
+		std::string input = Runner::corpusFile(corpusDir, size.first,
+			size.second, seed);
+		struct stat info;
+		stat(input.c_str(), &info);
+		size_t bytes = static_cast<size_t>(info.st_size);
+		for (size_t m = 0; m < modes.size(); m++){
+			const std::string& mode = modes[m];
+			if (stopped[m]){
+				writeResult(*out, mode, size.first, bytes, "skipped", nullptr,
+					0);
+				continue;
+			}
+			std::vector<std::string> args = { cronac, input };
+			for (auto& arg : Runner::modeArgs(mode, "/dev/null")){
+				args.push_back(arg);
+			}
+			std::cerr << "cronac -" << mode << " " << size.first << std::endl;
+			RunResult best;
+			const char * outcome = "ok";
+			for (size_t rep = 0; rep < reps; rep++){
+				RunResult run = runner.run(args);
+				if (run.timedOut || run.status != 0){
+					outcome = run.timedOut ? "timeout" : "failed";
+					best = run;
+					stopped[m] = true;
+					break;
+				}
+				if (rep == 0 || run.wallMs < best.wallMs){
+					long peakKB = std::max(best.peakKB, run.peakKB);
+					best = run;
+					best.peakKB = peakKB;
+				} else if (run.peakKB > best.peakKB){
+					best.peakKB = run.peakKB;
+				}
+			}
+			writeResult(*out, mode, size.first, bytes, outcome, &best, reps);
+		}
+	}
+	return 0;
+}
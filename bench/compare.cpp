@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "runner.hpp"
+
+using namespace crona;
+
+static void usageAndDie(){
+	std::cerr << "Usage: cronacompare [options] <baseCronac> <newCronac>"
+	<< " [<input> | @<listFile>]...\n"
+	<< "Run two builds of cronac interleaved over a corpus, and report"
+	<< " how much faster the new one is, with 95% confidence"
+	<< " intervals, and any difference in what they write\n"
+	<< " [--modes <mode>,...]: Any of t, p, u, n and c"
+	<< " (default t,p,u,n,c)\n"
+	<< " [--runs <n>]: Timed runs of each build on each input"
+	<< " (default 10)\n"
+	<< " [--warmup <n>]: Untimed runs first (default 2)\n"
+	<< " [--cpu <n>]: Pin both builds to CPU <n>, or -1 not to pin"
+	<< " (default the last CPU this may run on)\n"
+	<< " [--metric wall|cpu]: Compare wall time or user+sys time"
+	<< " (default wall)\n"
+	<< " [--sizes <n>[K|M|G],...]: Generate programs of these sizes"
+	<< " as the corpus (default 64K,512K when no inputs are given)\n"
+	<< " [--seed <n>]: Seed for generated programs (default 1)\n"
+	<< " [--corpus <dir>]: Keep generated programs in <dir>"
+	<< " (default corpus)\n"
+	<< " [--timeout <seconds>]: Give up on an input after this long"
+	<< " (default 300)\n"
+	<< " [--json <file>]: Also write one JSON object per input and"
+	<< " mode to <file>\n";
+	std::exit(1);
+}
+
+//Two-sided 95% quantiles of Student's t, by degrees of freedom
+static double tQuantile(size_t df){
+	static const double table[] = {
+		0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+		2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110,
+		2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056,
+		2.052, 2.048, 2.045, 2.042
+	};
+	if (df == 0){ return 0; }
+	if (df <= 30){ return table[df]; }
+	if (df <= 60){ return 2.000; }
+	if (df <= 120){ return 1.980; }
+	return 1.960;
+}
+
+//How a set of paired runs compares. Each pair gives the log of
+// base time over new time, so a mean above 0 means the new build
+// is faster, and its exponent is the geometric mean speedup.
+class Comparison{
+public:
+	Comparison() : meanLog(0), stdErr(0), df(0), baseMs(0), newMs(0){ }
+	double meanLog;
+	double stdErr;
+	size_t df;
+	double baseMs;
+	double newMs;
+
+	double speedup() const { return std::exp(meanLog); }
+	double low() const { return std::exp(meanLog - tQuantile(df) * stdErr); }
+	double high() const { return std::exp(meanLog + tQuantile(df) * stdErr); }
+	const char * verdict() const {
+		if (df == 0){ return "?"; }
+		if (low() > 1){ return "faster"; }
+		if (high() < 1){ return "slower"; }
+		return "same";
+	}
+};
+
+static double median(std::vector<double> values){
+	std::sort(values.begin(), values.end());
+	size_t n = values.size();
+	if (n == 0){ return 0; }
+	return n % 2 == 1 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+static Comparison comparePairs(const std::vector<double>& base,
+	const std::vector<double>& next){
+	Comparison result;
+	size_t n = base.size();
+	result.baseMs = median(base);
+	result.newMs = median(next);
+	if (n == 0){ return result; }
+	std::vector<double> logs;
+	for (size_t k = 0; k < n; k++){
+		logs.push_back(std::log(base[k] / next[k]));
+		result.meanLog += logs.back();
+	}
+	result.meanLog /= static_cast<double>(n);
+	if (n < 2){ return result; }
+	double var = 0;
+	for (auto r : logs){ var += (r - result.meanLog) * (r - result.meanLog); }
+	var /= static_cast<double>(n - 1);
+	result.stdErr = std::sqrt(var / static_cast<double>(n));
+	result.df = n - 1;
+	return result;
+}
+
+//Every input counts the same, however many runs it had
+static Comparison combine(const std::vector<Comparison>& parts){
+	Comparison result;
+	if (parts.empty()){ return result; }
+	double var = 0;
+	for (auto& part : parts){
+		result.meanLog += part.meanLog;
+		var += part.stdErr * part.stdErr;
+		result.df += part.df;
+		result.baseMs += part.baseMs;
+		result.newMs += part.newMs;
+	}
+	double count = static_cast<double>(parts.size());
+	result.meanLog /= count;
+	result.stdErr = std::sqrt(var) / count;
+	return result;
+}
+
+static bool readFile(const std::string& path, std::string& text){
+	std::ifstream in(path, std::ios::binary);
+	if (!in.good()){ return false; }
+	text.assign(std::istreambuf_iterator<char>(in),
+		std::istreambuf_iterator<char>());
+	return true;
+}
+
+//Where two files first differ, or empty if they don't
+static std::string firstDifference(const std::string& pathA,
+	const std::string& pathB){
+	std::string a;
+	std::string b;
+	bool hasA = readFile(pathA, a);
+	bool hasB = readFile(pathB, b);
+	if (hasA != hasB){ return hasA ? "only base wrote it" : "only new wrote it"; }
+	if (a == b){ return ""; }
+	size_t line = 1;
+	size_t k = 0;
+	while (k < a.size() && k < b.size() && a[k] == b[k]){
+		if (a[k] == '\n'){ line++; }
+		k++;
+	}
+	return "differs from line " + std::to_string(line);
+}
+
+static double timeOf(const RunResult& run, bool cpu){
+	return cpu ? run.userMs + run.sysMs : run.wallMs;
+}
+
+static void readList(const char * path, std::vector<std::string>& inputs){
+	std::ifstream list(path);
+	if (!list.good()){
+		std::cerr << "Bad list file " << path << std::endl;
+		std::exit(1);
+	}
+	std::string line;
+	while (std::getline(list, line)){
+		if (!line.empty()){ inputs.push_back(line); }
+	}
+}
+
+static void writeJSON(std::ostream& out, const std::string& mode,
+	const std::string& input, const Comparison& comparison,
+	const std::string& difference){
+	out << std::fixed << std::setprecision(4)
+	  << "{\"mode\":\"-" << mode << "\",\"input\":\"" << input
+	  << "\",\"base_ms\":" << comparison.baseMs
+	  << ",\"new_ms\":" << comparison.newMs
+	  << ",\"speedup\":" << comparison.speedup()
+	  << ",\"ci95_low\":" << comparison.low()
+	  << ",\"ci95_high\":" << comparison.high()
+	  << ",\"verdict\":\"" << comparison.verdict() << "\"";
+	if (!difference.empty()){
+		out << ",\"difference\":\"" << difference << "\"";
+	}
+	out << "}\n";
+}
+
+static void writeRow(const std::string& mode, const std::string& input,
+	const Comparison& comparison){
+	std::string name = input;
+	if (name.size() > 36){ name = "..." + name.substr(name.size() - 33); }
+	std::cout << std::left << std::setw(5) << ("-" + mode)
+	  << std::setw(38) << name << std::right << std::fixed
+	  << std::setprecision(2) << std::setw(11) << comparison.baseMs
+	  << std::setw(11) << comparison.newMs << std::setprecision(3)
+	  << std::setw(9) << comparison.speedup() << "x  ["
+	  << comparison.low() << ", " << comparison.high() << "]  "
+	  << comparison.verdict() << std::endl;
+}
+
+int main(int argc, char * argv[]){
+	const char * modeList = "t,p,u,n,c";
+	size_t runs = 10;
+	size_t warmup = 2;
+	int cpu = Runner::lastCPU();
+	bool cpuTime = false;
+	const char * sizeList = nullptr;
+	unsigned long long seed = 1;
+	std::string corpusDir = "corpus";
+	unsigned timeout = 300;
+	const char * jsonPath = nullptr;
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; i++){
+		const char * arg = argv[i];
+		if (strncmp(arg, "--", 2) != 0){
+			if (arg[0] == '@'){
+				readList(arg + 1, positional);
+			} else {
+				positional.push_back(arg);
+			}
+			continue;
+		}
+		if (i + 1 >= argc){ usageAndDie(); }
+		const char * value = argv[++i];
+		if (strcmp(arg, "--modes") == 0){
+			modeList = value;
+		} else if (strcmp(arg, "--runs") == 0){
+			runs = strtoul(value, nullptr, 10);
+			if (runs == 0){ usageAndDie(); }
+		} else if (strcmp(arg, "--warmup") == 0){
+			warmup = strtoul(value, nullptr, 10);
+		} else if (strcmp(arg, "--cpu") == 0){
+			cpu = atoi(value);
+		} else if (strcmp(arg, "--metric") == 0){
+			if (strcmp(value, "cpu") == 0){
+				cpuTime = true;
+			} else if (strcmp(value, "wall") != 0){
+				usageAndDie();
+			}
+		} else if (strcmp(arg, "--sizes") == 0){
+			sizeList = value;
+		} else if (strcmp(arg, "--seed") == 0){
+			seed = strtoull(value, nullptr, 10);
+		} else if (strcmp(arg, "--corpus") == 0){
+			corpusDir = value;
+		} else if (strcmp(arg, "--timeout") == 0){
+			timeout = static_cast<unsigned>(strtoul(value, nullptr, 10));
+		} else if (strcmp(arg, "--json") == 0){
+			jsonPath = value;
+		} else {
+			usageAndDie();
+		}
+	}
+	if (positional.size() < 2){ usageAndDie(); }
+	std::string builds[2] = { positional[0], positional[1] };
+	for (auto& build : builds){
+		if (access(build.c_str(), X_OK) != 0){
+			std::cerr << "No compiler at " << build << std::endl;
+			return 1;
+		}
+	}
+	std::vector<std::string> inputs(positional.begin() + 2, positional.end());
+	if (inputs.empty() && sizeList == nullptr){ sizeList = "64K,512K"; }
+	if (sizeList != nullptr){
+		for (auto& name : Runner::splitList(sizeList)){
+			size_t bytes = 0;
+			if (!Runner::parseSize(name, bytes)){ usageAndDie(); }
+			inputs.push_back(Runner::corpusFile(corpusDir, name, bytes, seed));
+		}
+	}
+	std::vector<std::string> modes = Runner::splitList(modeList);
+	for (auto& mode : modes){
+		if (Runner::modeArgs(mode, "").empty()){ usageAndDie(); }
+	}
+
+	std::ofstream json;
+	if (jsonPath != nullptr){
+		json.open(jsonPath);
+		if (!json.good()){
+			std::cerr << "Bad output file " << jsonPath << std::endl;
+			return 1;
+		}
+	}
+	char scratchTemplate[] = "/tmp/cronacompare.XXXXXX";
+	const char * scratch = mkdtemp(scratchTemplate);
+	if (scratch == nullptr){
+		std::cerr << "Couldn't make a scratch directory" << std::endl;
+		return 1;
+	}
+	//Each build writes its output file and its stdout and stderr
+	// to its own scratch files, to be compared after the first run
+	std::string outFiles[2];
+	std::string logFiles[2];
+	Runner runners[2];
+	for (size_t b = 0; b < 2; b++){
+		outFiles[b] = std::string(scratch) + (b == 0 ? "/base.out" : "/new.out");
+		logFiles[b] = std::string(scratch) + (b == 0 ? "/base.log" : "/new.log");
+		runners[b].cpu = cpu;
+		runners[b].timeout = timeout;
+		runners[b].output = logFiles[b];
+	}
+
+	std::cout << "base: " << builds[0] << "\nnew:  " << builds[1] << "\n"
+	  << runs << " timed runs after " << warmup << " warmups, "
+	  << (cpuTime ? "cpu" : "wall") << " time, "
+	  << (cpu >= 0 ? "pinned to CPU " + std::to_string(cpu) : "unpinned")
+	  << "\n\n" << std::left << std::setw(5) << "mode" << std::setw(38)
+	  << "input" << std::right << std::setw(11) << "base ms"
+	  << std::setw(11) << "new ms" << std::setw(10) << "speedup"
+	  << "  95% CI" << std::endl;
+
+	std::vector<std::string> differences;
+	for (auto& mode : modes){
+		std::vector<Comparison> perInput;
+		for (auto& input : inputs){
+			std::vector<double> times[2];
+			std::string difference;
+			bool timedOut = false;
+			for (size_t run = 0; run < warmup + runs && !timedOut; run++){
+				//Alternate which build goes first, so that drift in
+				// the machine's speed falls on both alike
+				for (size_t turn = 0; turn < 2; turn++){
+					size_t b = (run + turn) % 2;
+					std::vector<std::string> args = { builds[b], input };
+					for (auto& arg : Runner::modeArgs(mode, outFiles[b])){
+						args.push_back(arg);
+					}
+					unlink(outFiles[b].c_str());
+					RunResult result = runners[b].run(args);
+					if (result.timedOut){
+						timedOut = true;
+						break;
+					}
+					if (run >= warmup){ times[b].push_back(timeOf(result, cpuTime)); }
+				}
+				if (run == 0 && !timedOut){
+					std::string outDiff = firstDifference(outFiles[0], outFiles[1]);
+					std::string logDiff = firstDifference(logFiles[0], logFiles[1]);
+					if (!outDiff.empty()){ difference = "output " + outDiff; }
+					if (!logDiff.empty()){
+						if (!difference.empty()){ difference += ", "; }
+						difference += "stdout/stderr " + logDiff;
+					}
+					if (!difference.empty()){
+						differences.push_back("-" + mode + " " + input + ": "
+						  + difference);
+					}
+				}
+			}
+			if (timedOut){
+				differences.push_back("-" + mode + " " + input + ": timed out");
+				continue;
+			}
+			Comparison comparison = comparePairs(times[0], times[1]);
+			perInput.push_back(comparison);
+			writeRow(mode, input, comparison);
+			if (json.is_open()){
+				writeJSON(json, mode, input, comparison, difference);
+			}
+		}
+		if (perInput.size() > 1){
+			Comparison all = combine(perInput);
+			writeRow(mode, "all " + std::to_string(perInput.size())
+			  + " inputs", all);
+			if (json.is_open()){ writeJSON(json, mode, "(all)", all, ""); }
+		}
+	}
+
+	for (size_t b = 0; b < 2; b++){
+		unlink(outFiles[b].c_str());
+		unlink(logFiles[b].c_str());
+	}
+	rmdir(scratch);
+
+	if (differences.empty()){
+		std::cout << "\nno output differences" << std::endl;
+		return 0;
+	}
+	std::cout << "\noutput differences:\n";
+	for (auto& difference : differences){
+		std::cout << "  " << difference << "\n";
+	}
+	std::cout.flush();
+	return 2;
+}
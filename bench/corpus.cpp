@@ -0,0 +1,358 @@
+#include "corpus.hpp"
+
+namespace crona{
+
+//Names in the pool shared by every function
+static const size_t SHARED_NAMES = 16;
+//Statements in the body of each if, else and while
+static const size_t BLOCK_STMTS = 3;
+
+CorpusWriter::CorpusWriter(const CorpusShape& shapeIn)
+: shape(shapeIn), state(shapeIn.seed), errorsMade(0){
+}
+
+//splitmix64, which is small, fast and the same everywhere
+unsigned long long CorpusWriter::next(){
+	state += 0x9e3779b97f4a7c15ULL;
+	unsigned long long z = state;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+CorpusWriter::Var CorpusWriter::makeVar(const std::string& name){
+	bool isBool = chance(35);
+	size_t length = chance(shape.arrays) ? 1 + below(shape.lengths) : 0;
+	return Var(name, isBool, length);
+}
+
+void CorpusWriter::declare(const Var& var, std::string& out){
+	out += var.name;
+	out += var.isBool ? " : bool" : " : int";
+	if (var.length > 0){
+		out += " array[";
+		out += std::to_string(var.length);
+		out += "]";
+	}
+	out += ";\n";
+}
+
+void CorpusWriter::indent(size_t level, std::string& out){
+	out.append(level, '\t');
+}
+
+//A variable of the given type, scalar or array, preferring the
+// function's own. Globals 0 and 1 are an int and a bool, so there
+// always is one.
+const CorpusWriter::Var * CorpusWriter::pick(bool isBool){
+	for (size_t tries = 0; tries < 4 && !localVars.empty(); tries++){
+		const Var& var = localVars[below(localVars.size())];
+		if (var.isBool == isBool){ return &var; }
+	}
+	for (size_t tries = 0; tries < 4; tries++){
+		const Var& var = globalVars[below(globalVars.size())];
+		if (var.isBool == isBool){ return &var; }
+	}
+	return &globalVars[isBool ? 1 : 0];
+}
+
+void CorpusWriter::lval(const Var& var, std::string& out){
+	out += var.name;
+	if (var.length == 0){ return; }
+	out += "[";
+	if (chance(75)){
+		out += std::to_string(below(var.length));
+	} else {
+		intExp(0, out);
+	}
+	out += "]";
+}
+
+bool CorpusWriter::callExp(size_t depth, std::string& out){
+	if (fns.empty()){ return false; }
+	const Fn& fn = fns[below(fns.size())];
+	out += fn.name;
+	out += "(";
+	for (size_t k = 0; k < fn.formals.size(); k++){
+		if (k > 0){ out += ", "; }
+		if (fn.formals[k]){
+			boolExp(depth, out);
+		} else {
+			intExp(depth, out);
+		}
+	}
+	out += ")";
+	return true;
+}
+
+void CorpusWriter::intExp(size_t depth, std::string& out){
+	if (depth == 0 || chance(30)){
+		//Arguments are shallower than the call, so calls end
+		if (depth > 0 && chance(shape.calls) && callExp(depth - 1, out)){
+			return;
+		}
+		if (chance(40)){
+			out += std::to_string(below(1000));
+		} else {
+			lval(*pick(false), out);
+		}
+		return;
+	}
+	bool parens = chance(30);
+	if (parens){ out += "("; }
+	static const char * const ops[] = { " + ", " - ", " * ", " / " };
+	size_t op = below(4);
+	if (op == 0 && chance(10)){
+		out += "-(";
+		intExp(depth - 1, out);
+		out += ")";
+	} else {
+		intExp(depth - 1, out);
+		out += ops[op];
+		if (op == 3){
+			//Never divide by a literal 0
+			out += std::to_string(1 + below(9));
+		} else {
+			intExp(depth - 1, out);
+		}
+	}
+	if (parens){ out += ")"; }
+}
+
+void CorpusWriter::boolExp(size_t depth, std::string& out){
+	if (depth == 0 || chance(25)){
+		size_t roll = below(10);
+		if (roll < 2){
+			out += chance(50) ? "true" : "false";
+		} else {
+			lval(*pick(true), out);
+		}
+		return;
+	}
+	bool parens = chance(30);
+	if (parens){ out += "("; }
+	static const char * const compares[] = {
+		" < ", " <= ", " > ", " >= ", " == ", " != "
+	};
+	size_t roll = below(10);
+	if (roll < 5){
+		intExp(depth - 1, out);
+		out += compares[below(6)];
+		intExp(depth - 1, out);
+	} else if (roll < 9){
+		boolExp(depth - 1, out);
+		out += chance(50) ? " && " : " || ";
+		boolExp(depth - 1, out);
+	} else {
+		out += "!(";
+		boolExp(depth - 1, out);
+		out += ")";
+	}
+	if (parens){ out += ")"; }
+}
+
+void CorpusWriter::writeError(std::string& out){
+	errorsMade++;
+	size_t kind = below(3);
+	if (kind == 2 && !fns.empty()){
+		//One argument too many
+		const Fn& fn = fns[below(fns.size())];
+		out += fn.name;
+		out += "(";
+		for (size_t k = 0; k <= fn.formals.size(); k++){
+			if (k > 0){ out += ", "; }
+			out += fn.formals.size() > k && fn.formals[k] ? "true" : "1";
+		}
+		out += ");\n";
+		return;
+	}
+	lval(*pick(false), out);
+	if (kind == 0){
+		out += " = undeclared";
+		out += std::to_string(errorsMade);
+		out += " + 1;\n";
+	} else {
+		out += " = true + 1;\n";
+	}
+}
+
+//An int assignment whose right side is a chain of operands.
+// Each operator takes the chain so far as its left operand, so
+// the expression nests one deeper for each operand.
+void CorpusWriter::writeChain(std::string& out){
+	indent(1, out);
+	lval(*pick(false), out);
+	out += " = ";
+	static const char * const ops[] = { " + ", " - ", " * " };
+	for (size_t k = 0; k < shape.operands; k++){
+		if (k > 0){ out += ops[below(3)]; }
+		if (chance(40)){
+			out += std::to_string(below(1000));
+		} else {
+			lval(*pick(false), out);
+		}
+	}
+	out += ";\n";
+}
+
+//Whiles nested shape.spine deep, one inside the other, so the
+// program grows with the depth rather than exponentially. They
+// are indented no further than the body, or the tabs alone would
+// grow as the square of the depth.
+void CorpusWriter::writeSpine(std::string& out){
+	for (size_t level = 1; level <= shape.spine; level++){
+		indent(1, out);
+		out += "while (";
+		boolExp(1, out);
+		out += "){\n";
+		indent(1, out);
+		lval(*pick(false), out);
+		out += " = ";
+		intExp(1, out);
+		out += ";\n";
+	}
+	indent(1, out);
+	out.append(shape.spine, '}');
+	out += "\n";
+}
+
+void CorpusWriter::writeStmts(size_t count, size_t level, std::string& out){
+	for (size_t k = 0; k < count; k++){
+		writeStmt(level, out);
+	}
+}
+
+void CorpusWriter::writeStmt(size_t level, std::string& out){
+	indent(level, out);
+	if (shape.errors > 0 && below(1000) < shape.errors){
+		writeError(out);
+		return;
+	}
+	if (chance(shape.calls) && callExp(shape.depth / 2, out)){
+		out += ";\n";
+		return;
+	}
+	size_t roll = below(100);
+	//Blocks nest no deeper than asked; level 1 is the body
+	if (level > shape.nesting && roll >= 70){ roll = below(70); }
+	if (roll < 30){
+		lval(*pick(false), out);
+		out += " = ";
+		intExp(shape.depth, out);
+		out += ";\n";
+	} else if (roll < 45){
+		lval(*pick(true), out);
+		out += " = ";
+		boolExp(shape.depth, out);
+		out += ";\n";
+	} else if (roll < 55){
+		lval(*pick(false), out);
+		out += chance(50) ? "++;\n" : "--;\n";
+	} else if (roll < 65){
+		out += "write ";
+		intExp(shape.depth, out);
+		out += ";\n";
+	} else if (roll < 70){
+		out += "read ";
+		lval(*pick(false), out);
+		out += ";\n";
+	} else {
+		bool loop = roll >= 80 && roll < 90;
+		bool withElse = roll >= 90;
+		out += loop ? "while (" : "if (";
+		boolExp(shape.depth, out);
+		out += "){\n";
+		writeStmts(1 + below(BLOCK_STMTS), level + 1, out);
+		indent(level, out);
+		out += "}";
+		if (withElse){
+			out += " else {\n";
+			writeStmts(1 + below(BLOCK_STMTS), level + 1, out);
+			indent(level, out);
+			out += "}";
+		}
+		out += "\n";
+	}
+}
+
+void CorpusWriter::writeFn(size_t index, std::string& out){
+	Fn fn;
+	fn.name = "f" + std::to_string(index);
+	localVars.clear();
+	out += fn.name;
+	out += " : int(";
+	size_t formals = shape.formals > 0 ? shape.formals : below(4);
+	for (size_t k = 0; k < formals; k++){
+		bool isBool = chance(35);
+		fn.formals.push_back(isBool);
+		localVars.push_back(Var("p" + std::to_string(k), isBool, 0));
+		if (k > 0){ out += ", "; }
+		out += localVars.back().name;
+		out += isBool ? " : bool" : " : int";
+	}
+	out += "){\n";
+
+	size_t locals = 2 + below(4);
+	bool shared[SHARED_NAMES] = {};
+	for (size_t k = 0; k < locals; k++){
+		std::string name;
+		size_t slot = below(SHARED_NAMES);
+		if (chance(shape.reuse) && !shared[slot]){
+			shared[slot] = true;
+			name = "v" + std::to_string(slot);
+		} else {
+			name = "l" + std::to_string(index) + "_" + std::to_string(k);
+		}
+		localVars.push_back(makeVar(name));
+		indent(1, out);
+		declare(localVars.back(), out);
+	}
+	writeStmts(shape.body, 1, out);
+	if (shape.operands > 0){ writeChain(out); }
+	if (shape.spine > 0){ writeSpine(out); }
+	indent(1, out);
+	out += "return ";
+	intExp(shape.depth, out);
+	out += ";\n}\n";
+	fns.push_back(fn);
+}
+
+size_t CorpusWriter::write(std::ostream& out){
+	std::string text;
+	globalVars.push_back(Var("g0", false, 0));
+	globalVars.push_back(Var("g1", true, 0));
+	for (size_t k = 2; k < shape.globals; k++){
+		globalVars.push_back(makeVar("g" + std::to_string(k)));
+	}
+	for (auto& var : globalVars){
+		declare(var, text);
+	}
+	size_t written = text.size();
+	out << text;
+
+	for (size_t k = 0; ; k++){
+		if (shape.bytes > 0 ? written >= shape.bytes : k >= shape.functions){
+			break;
+		}
+		text.clear();
+		writeFn(k, text);
+		written += text.size();
+		out << text;
+	}
+
+	//A main calling one of the functions, as an entry for --stack
+	text = "main : void(){\n";
+	localVars.clear();
+	if (!fns.empty()){
+		indent(1, text);
+		text += "write ";
+		callExp(0, text);
+		text += ";\n";
+	}
+	text += "}\n";
+	written += text.size();
+	out << text;
+	return written;
+}
+
+}
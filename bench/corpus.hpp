@@ -0,0 +1,112 @@
+#ifndef CRONA_BENCH_CORPUS
+#define CRONA_BENCH_CORPUS
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace crona{
+
+// The shape of a generated program. Percentages are out of 100,
+// and errors are per 1000 statements.
+class CorpusShape{
+public:
+	CorpusShape()
+	: seed(1), globals(8), functions(16), body(8), depth(3),
+	  nesting(2), arrays(20), lengths(16), formals(0), operands(0),
+	  spine(0), calls(20), reuse(50), errors(0), bytes(0){ }
+	unsigned long long seed;
+	//Global variables, declared before any function
+	size_t globals;
+	//Functions to write, unless bytes is set
+	size_t functions;
+	//Statements at the top level of each function body
+	size_t body;
+	//Deepest expression nesting
+	size_t depth;
+	//Deepest nesting of if and while
+	size_t nesting;
+	//How many variables are arrays
+	unsigned arrays;
+	//Arrays are 1 to this many elements long, so there are up to
+	// twice as many distinct array types
+	size_t lengths;
+	//If not 0, every function takes this many formals, rather
+	// than 0 to 3 of them
+	size_t formals;
+	//If not 0, every function also assigns a chain of this many
+	// operands, which nests as deep as it is long
+	size_t operands;
+	//If not 0, every function also holds whiles nested this
+	// deep, with an assignment at each level
+	size_t spine;
+	//How many statements and expression leaves are calls
+	unsigned calls;
+	//How many locals take a name shared by every function,
+	// rather than one of their own
+	unsigned reuse;
+	//Statements made erroneous on purpose: an undeclared name, a
+	// mistyped operand or a call with the wrong arguments
+	unsigned errors;
+	//If not 0, write functions until the program is this many
+	// bytes long, instead of a set number of them
+	size_t bytes;
+};
+
+// Writes a random Crona program of the given shape. The same shape
+// and seed give the same program on every platform, since the
+// random numbers are made here rather than by the standard
+// library's distributions. Unless errors are asked for, the
+// program passes every stage of cronac.
+class CorpusWriter{
+public:
+	CorpusWriter(const CorpusShape& shapeIn);
+	//Write the program, and return how many bytes it took
+	size_t write(std::ostream& out);
+
+private:
+	class Var{
+	public:
+		Var(std::string nameIn, bool isBoolIn, size_t lengthIn)
+		: name(nameIn), isBool(isBoolIn), length(lengthIn){ }
+		std::string name;
+		bool isBool;
+		//0 if the variable is not an array
+		size_t length;
+	};
+	class Fn{
+	public:
+		std::string name;
+		std::vector<bool> formals;
+	};
+
+	unsigned long long next();
+	size_t below(size_t n){ return static_cast<size_t>(next() % n); }
+	bool chance(unsigned percent){ return below(100) < percent; }
+
+	Var makeVar(const std::string& name);
+	void declare(const Var& var, std::string& out);
+	void writeFn(size_t index, std::string& out);
+	void writeStmts(size_t count, size_t level, std::string& out);
+	void writeStmt(size_t level, std::string& out);
+	void writeError(std::string& out);
+	void writeChain(std::string& out);
+	void writeSpine(std::string& out);
+	void indent(size_t level, std::string& out);
+	void intExp(size_t depth, std::string& out);
+	void boolExp(size_t depth, std::string& out);
+	bool callExp(size_t depth, std::string& out);
+	void lval(const Var& var, std::string& out);
+	const Var * pick(bool isBool);
+
+	CorpusShape shape;
+	unsigned long long state;
+	std::vector<Var> globalVars;
+	std::vector<Var> localVars;
+	std::vector<Fn> fns;
+	size_t errorsMade;
+};
+
+}
+
+#endif
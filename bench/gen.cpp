@@ -0,0 +1,117 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "corpus.hpp"
+
+using namespace crona;
+
+static void usageAndDie(){
+	std::cerr << "Usage: cronagen [options]\n"
+	<< "Write a random Crona program to stdout\n"
+	<< " [-o <file>]: Write it to <file> instead\n"
+	<< " [--seed <n>]: Seed the generator (default 1)\n"
+	<< " [--globals <n>]: Global variables (default 8)\n"
+	<< " [--functions <n>]: Functions (default 16)\n"
+	<< " [--bytes <n>[K|M|G]]: Write functions until the program"
+	<< " is about <n> bytes, instead of --functions of them\n"
+	<< " [--body <n>]: Statements in each function body (default 8)\n"
+	<< " [--depth <n>]: Deepest expression nesting (default 3)\n"
+	<< " [--nesting <n>]: Deepest if and while nesting (default 2)\n"
+	<< " [--arrays <percent>]: Variables that are arrays (default 20)\n"
+	<< " [--lengths <n>]: Arrays are 1 to <n> elements long"
+	<< " (default 16)\n"
+	<< " [--formals <n>]: Formals of every function (default 0 to 3)\n"
+	<< " [--operands <n>]: Also assign a chain of <n> operands in"
+	<< " each function\n"
+	<< " [--spine <n>]: Also nest whiles <n> deep in each function\n"
+	<< " [--calls <percent>]: Statements and operands that are"
+	<< " calls (default 20)\n"
+	<< " [--reuse <percent>]: Locals named from a pool shared by"
+	<< " every function (default 50)\n"
+	<< " [--errors <permille>]: Statements with a deliberate name"
+	<< " or type error (default 0)\n";
+	std::exit(1);
+}
+
+//A count, with an optional K, M or G suffix for powers of 1024
+static unsigned long long parseCount(const char * arg){
+	char * end = nullptr;
+	unsigned long long count = strtoull(arg, &end, 10);
+	if (end == arg){ usageAndDie(); }
+	switch (*end){
+	case 'K': count <<= 10; end++; break;
+	case 'M': count <<= 20; end++; break;
+	case 'G': count <<= 30; end++; break;
+	default: break;
+	}
+	if (*end != '\0'){ usageAndDie(); }
+	return count;
+}
+
+static unsigned parsePercent(const char * arg, unsigned limit){
+	unsigned long long value = parseCount(arg);
+	if (value > limit){ usageAndDie(); }
+	return static_cast<unsigned>(value);
+}
+
+int main(int argc, char * argv[]){
+	CorpusShape shape;
+	const char * outPath = nullptr;
+	for (int i = 1; i < argc; i++){
+		if (i + 1 >= argc){ usageAndDie(); }
+		const char * arg = argv[i];
+		const char * value = argv[++i];
+		if (strcmp(arg, "-o") == 0){
+			outPath = value;
+		} else if (strcmp(arg, "--seed") == 0){
+			shape.seed = parseCount(value);
+		} else if (strcmp(arg, "--globals") == 0){
+			shape.globals = parseCount(value);
+		} else if (strcmp(arg, "--functions") == 0){
+			shape.functions = parseCount(value);
+		} else if (strcmp(arg, "--bytes") == 0){
+			shape.bytes = parseCount(value);
+		} else if (strcmp(arg, "--body") == 0){
+			shape.body = parseCount(value);
+		} else if (strcmp(arg, "--depth") == 0){
+			shape.depth = parseCount(value);
+		} else if (strcmp(arg, "--nesting") == 0){
+			shape.nesting = parseCount(value);
+		} else if (strcmp(arg, "--arrays") == 0){
+			shape.arrays = parsePercent(value, 100);
+		} else if (strcmp(arg, "--lengths") == 0){
+			shape.lengths = parseCount(value);
+			if (shape.lengths == 0){ usageAndDie(); }
+		} else if (strcmp(arg, "--formals") == 0){
+			shape.formals = parseCount(value);
+		} else if (strcmp(arg, "--operands") == 0){
+			shape.operands = parseCount(value);
+		} else if (strcmp(arg, "--spine") == 0){
+			shape.spine = parseCount(value);
+		} else if (strcmp(arg, "--calls") == 0){
+			shape.calls = parsePercent(value, 100);
+		} else if (strcmp(arg, "--reuse") == 0){
+			shape.reuse = parsePercent(value, 100);
+		} else if (strcmp(arg, "--errors") == 0){
+			shape.errors = parsePercent(value, 1000);
+		} else {
+			usageAndDie();
+		}
+	}
+
+	CorpusWriter writer(shape);
+	if (outPath == nullptr){
+		writer.write(std::cout);
+		std::cout.flush();
+		return std::cout.good() ? 0 : 1;
+	}
+	std::ofstream out(outPath);
+	if (!out.good()){
+		std::cerr << "Bad output file " << outPath << std::endl;
+		return 1;
+	}
+	writer.write(out);
+	out.close();
+	return out.good() ? 0 : 1;
+}
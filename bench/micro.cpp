@@ -0,0 +1,378 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "alloc_count.hpp"
+#include "ast.hpp"
+#include "symbol_table.hpp"
+#include "tokens.hpp"
+#include "type_analysis.hpp"
+#include "types.hpp"
+
+using namespace crona;
+
+// Microbenchmarks of the structures on cronac's hot paths, run on
+// the same objects that make cronac. Each benchmark's operation
+// is run in samples long enough to time, and the time and the
+// allocations per operation are reported over the samples.
+
+//Results are kept here so the work that makes them isn't dropped
+static volatile size_t sink;
+
+class Bench{
+public:
+	Bench(std::string nameIn, std::function<void(size_t)> runIn)
+	: name(nameIn), run(runIn){ }
+	std::string name;
+	//Do the operation the given number of times
+	std::function<void(size_t)> run;
+};
+
+class Options{
+public:
+	Options() : samples(15), minMs(10), json(false), filter(nullptr){ }
+	size_t samples;
+	size_t minMs;
+	bool json;
+	const char * filter;
+};
+
+static double elapsedNs(std::function<void(size_t)>& run, size_t ops){
+	auto start = std::chrono::steady_clock::now();
+	run(ops);
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+static void measure(Bench& bench, const Options& opts){
+	//Double the operations per sample until a sample takes long
+	// enough to time well; the runs doing so warm up the caches
+	size_t ops = 1;
+	const size_t maxOps = static_cast<size_t>(1) << 40;
+	double minNs = static_cast<double>(opts.minMs) * 1e6;
+	while (elapsedNs(bench.run, ops) < minNs && ops < maxOps){
+		ops *= 2;
+	}
+
+	std::vector<double> perOp;
+	size_t allocsBefore = AllocCount::allocations();
+	for (size_t s = 0; s < opts.samples; s++){
+		perOp.push_back(elapsedNs(bench.run, ops) / static_cast<double>(ops));
+	}
+	size_t allocs = AllocCount::allocations() - allocsBefore;
+	double allocsPerOp = static_cast<double>(allocs)
+	  / static_cast<double>(ops * opts.samples);
+
+	std::sort(perOp.begin(), perOp.end());
+	double mean = 0;
+	for (auto ns : perOp){ mean += ns; }
+	mean /= static_cast<double>(perOp.size());
+	double var = 0;
+	for (auto ns : perOp){ var += (ns - mean) * (ns - mean); }
+	double sd = perOp.size() > 1
+	  ? std::sqrt(var / static_cast<double>(perOp.size() - 1)) : 0;
+	//Half the width of a 95% confidence interval for the mean
+	double ci = 1.96 * sd / std::sqrt(static_cast<double>(perOp.size()));
+	double median = perOp[perOp.size() / 2];
+
+	if (opts.json){
+		std::cout << std::fixed << std::setprecision(3)
+		  << "{\"bench\":\"" << bench.name << "\",\"ops\":" << ops
+		  << ",\"samples\":" << opts.samples
+		  << ",\"ns_per_op\":" << median << ",\"mean_ns\":" << mean
+		  << ",\"ci95_ns\":" << ci << ",\"min_ns\":" << perOp.front();
+		if (AllocCount::counting()){
+			std::cout << ",\"allocs_per_op\":" << allocsPerOp;
+		}
+		std::cout << "}" << std::endl;
+		return;
+	}
+	std::cout << std::left << std::setw(40) << bench.name << std::right
+	  << std::fixed << std::setprecision(1)
+	  << std::setw(12) << median << std::setw(12) << perOp.front()
+	  << std::setw(8) << "+-" << std::setw(6) << std::setprecision(1)
+	  << (mean > 0 ? 100 * ci / mean : 0) << "%";
+	if (AllocCount::counting()){
+		std::cout << std::setw(12) << std::setprecision(2) << allocsPerOp;
+	} else {
+		std::cout << std::setw(12) << "-";
+	}
+	std::cout << std::endl;
+}
+
+static std::string symName(size_t scope, size_t k){
+	return "s" + std::to_string(scope) + "_" + std::to_string(k);
+}
+
+//A symbol table depth scopes deep, each holding width variables
+static SymbolTable * nestedTable(size_t depth, size_t width){
+	SymbolTable * table = new SymbolTable();
+	for (size_t d = 0; d < depth; d++){
+		table->enterScope();
+		for (size_t k = 0; k < width; k++){
+			table->insert(new VarSymbol(symName(d, k), BasicType::INT()));
+		}
+	}
+	return table;
+}
+
+static void addSymbolTableBenches(std::vector<Bench>& benches){
+	static const size_t widths[] = { 4, 64 };
+	for (size_t width : widths){
+		benches.push_back(Bench("symtab enter+insert+leave w="
+		  + std::to_string(width), [width](size_t ops){
+			SymbolTable table;
+			std::list<ScopeTable *> retired;
+			table.retireScopesTo(&retired);
+			std::vector<std::string> names;
+			for (size_t k = 0; k < width; k++){
+				names.push_back(symName(0, k));
+			}
+			for (size_t op = 0; op < ops; op++){
+				table.enterScope();
+				for (auto& name : names){
+					table.insert(new VarSymbol(name, BasicType::INT()));
+				}
+				table.leaveScope();
+				delete retired.front();
+				retired.pop_front();
+			}
+		}));
+	}
+	static const size_t depths[] = { 1, 8, 64 };
+	static const size_t findWidths[] = { 16, 1024 };
+	for (size_t depth : depths){
+		for (size_t width : findWidths){
+			std::string shape = " d=" + std::to_string(depth) + " w="
+			  + std::to_string(width);
+			SymbolTable * table = nestedTable(depth, width);
+			//Names in the outermost scope, found after walking them all
+			benches.push_back(Bench("symtab find outermost" + shape,
+				[table, width](size_t ops){
+				std::string name = symName(0, width / 2);
+				for (size_t op = 0; op < ops; op++){
+					sink = sink + (table->find(name) != nullptr);
+				}
+			}));
+			benches.push_back(Bench("symtab find innermost" + shape,
+				[table, depth, width](size_t ops){
+				std::string name = symName(depth - 1, width / 2);
+				for (size_t op = 0; op < ops; op++){
+					sink = sink + (table->find(name) != nullptr);
+				}
+			}));
+			benches.push_back(Bench("symtab find missing" + shape,
+				[table](size_t ops){
+				std::string name = "missing";
+				for (size_t op = 0; op < ops; op++){
+					sink = sink + (table->find(name) != nullptr);
+				}
+			}));
+		}
+	}
+}
+
+static void addScopeTableBenches(std::vector<Bench>& benches){
+	static const size_t widths[] = { 16, 1024, 65536 };
+	for (size_t width : widths){
+		ScopeTable * scope = new ScopeTable();
+		std::vector<std::string> names;
+		for (size_t k = 0; k < width; k++){
+			names.push_back(symName(0, k));
+			scope->addVar(names.back(), BasicType::INT());
+		}
+		std::string suffix = " w=" + std::to_string(width);
+		benches.push_back(Bench("scope lookup hit" + suffix,
+			[scope, names](size_t ops){
+			for (size_t op = 0; op < ops; op++){
+				SemSymbol * sym = scope->lookup(names[op % names.size()]);
+				sink = sink + (sym != nullptr);
+			}
+		}));
+		benches.push_back(Bench("scope lookup miss" + suffix,
+			[scope](size_t ops){
+			std::string name = "missing";
+			for (size_t op = 0; op < ops; op++){
+				sink = sink + (scope->lookup(name) != nullptr);
+			}
+		}));
+	}
+}
+
+static void addTypeBenches(std::vector<Bench>& benches){
+	benches.push_back(Bench("BasicType::produce", [](size_t ops){
+		static const BaseType bases[] = {
+			BaseType::INT, BaseType::BOOL, BaseType::BYTE, BaseType::VOID
+		};
+		for (size_t op = 0; op < ops; op++){
+			sink = sink + reinterpret_cast<size_t>(
+				BasicType::produce(bases[op % 4]));
+		}
+	}));
+	//Flyweights are kept for the whole run, so each size adds to
+	// those made before it
+	for (int arrays : { 16, 256, 4096 }){
+		for (int length = 1; length <= arrays; length++){
+			ArrayType::produce(BasicType::INT(), length);
+		}
+		benches.push_back(Bench("ArrayType::produce of "
+		  + std::to_string(arrays), [arrays](size_t ops){
+			const BasicType * base = BasicType::INT();
+			for (size_t op = 0; op < ops; op++){
+				int length = 1 + static_cast<int>(op % static_cast<size_t>(arrays));
+				sink = sink + reinterpret_cast<size_t>(
+					ArrayType::produce(base, length));
+			}
+		}));
+	}
+
+	static const size_t formalCounts[] = { 0, 4, 16 };
+	for (size_t formals : formalCounts){
+		std::string suffix = " k=" + std::to_string(formals);
+		benches.push_back(Bench("FnType construct" + suffix,
+			[formals](size_t ops){
+			for (size_t op = 0; op < ops; op++){
+				auto list = new std::list<const DataType *>(formals,
+					BasicType::INT());
+				FnType * type = new FnType(list, BasicType::BOOL());
+				sink = sink + type->str().size();
+				//Its static type is its dynamic type, but DataType
+				// has no virtual destructor to say so
+				type->~FnType();
+				::operator delete(type);
+				delete list;
+			}
+		}));
+		auto listA = new std::list<const DataType *>(formals, BasicType::INT());
+		auto listB = new std::list<const DataType *>(formals, BasicType::INT());
+		const FnType * typeA = new FnType(listA, BasicType::BOOL());
+		const FnType * typeB = new FnType(listB, BasicType::BOOL());
+		//The way a call's arguments are checked against its formals
+		benches.push_back(Bench("FnType compare formals" + suffix,
+			[typeA, typeB](size_t ops){
+			for (size_t op = 0; op < ops; op++){
+				auto a = typeA->getFormalTypes();
+				auto b = typeB->getFormalTypes();
+				bool same = a->size() == b->size()
+				  && std::equal(a->begin(), a->end(), b->begin())
+				  && typeA->getReturnType() == typeB->getReturnType();
+				sink = sink + same;
+			}
+		}));
+		benches.push_back(Bench("FnType compare strings" + suffix,
+			[typeA, typeB](size_t ops){
+			for (size_t op = 0; op < ops; op++){
+				sink = sink + (typeA->str() == typeB->str());
+			}
+		}));
+	}
+}
+
+static void addNodeTypeBenches(std::vector<Bench>& benches){
+	static const size_t counts[] = { 1 << 16, 1 << 20 };
+	for (size_t count : counts){
+		std::vector<ASTNode *> * nodes = new std::vector<ASTNode *>();
+		for (size_t k = 0; k < count; k++){
+			nodes->push_back(new IntLitNode(k, 1, 0));
+		}
+		TypeAnalysis * ta = TypeAnalysis::build();
+		const DataType * type = BasicType::INT();
+		for (auto node : *nodes){ ta->nodeType(node, type); }
+		std::string suffix = " n=" + std::to_string(count);
+		benches.push_back(Bench("nodeType set" + suffix,
+			[nodes, ta, type](size_t ops){
+			for (size_t op = 0; op < ops; op++){
+				ta->nodeType((*nodes)[op % nodes->size()], type);
+			}
+		}));
+		benches.push_back(Bench("nodeType get" + suffix,
+			[nodes, ta](size_t ops){
+			for (size_t op = 0; op < ops; op++){
+				sink = sink + reinterpret_cast<size_t>(
+					ta->nodeType((*nodes)[op % nodes->size()]));
+			}
+		}));
+	}
+}
+
+static void addTokenBenches(std::vector<Bench>& benches){
+	benches.push_back(Bench("Token new+delete", [](size_t ops){
+		for (size_t op = 0; op < ops; op++){
+			Token * token = new Token(op, 1, 1);
+			sink = sink + token->line();
+			delete token;
+		}
+	}));
+	benches.push_back(Bench("IDToken new+delete", [](size_t ops){
+		std::string name = "identifier";
+		for (size_t op = 0; op < ops; op++){
+			Token * token = new IDToken(op, 1, name);
+			sink = sink + token->line();
+			delete token;
+		}
+	}));
+}
+
+static void usageAndDie(){
+	std::cerr << "Usage: cronamicro [options]\n"
+	<< "Time cronac's core data structures, in ns and allocations"
+	<< " per operation\n"
+	<< " [--filter <text>]: Run only benchmarks whose names contain"
+	<< " <text>\n"
+	<< " [--samples <n>]: Timed samples of each (default 15)\n"
+	<< " [--min-ms <n>]: Shortest sample, in milliseconds"
+	<< " (default 10)\n"
+	<< " [--json]: Write one JSON object per benchmark\n";
+	std::exit(1);
+}
+
+int main(int argc, char * argv[]){
+	Options opts;
+	for (int i = 1; i < argc; i++){
+		if (strcmp(argv[i], "--json") == 0){
+			opts.json = true;
+			continue;
+		}
+		if (i + 1 >= argc){ usageAndDie(); }
+		const char * arg = argv[i];
+		const char * value = argv[++i];
+		if (strcmp(arg, "--filter") == 0){
+			opts.filter = value;
+		} else if (strcmp(arg, "--samples") == 0){
+			opts.samples = strtoul(value, nullptr, 10);
+			if (opts.samples == 0){ usageAndDie(); }
+		} else if (strcmp(arg, "--min-ms") == 0){
+			opts.minMs = strtoul(value, nullptr, 10);
+		} else {
+			usageAndDie();
+		}
+	}
+
+	std::vector<Bench> benches;
+	addSymbolTableBenches(benches);
+	addScopeTableBenches(benches);
+	addTypeBenches(benches);
+	addNodeTypeBenches(benches);
+	addTokenBenches(benches);
+
+	if (!opts.json){
+		std::cout << std::left << std::setw(40) << "benchmark" << std::right
+		  << std::setw(12) << "ns/op" << std::setw(12) << "min"
+		  << std::setw(15) << "ci95" << std::setw(12) << "allocs/op"
+		  << std::endl;
+	}
+	for (auto& bench : benches){
+		if (opts.filter != nullptr
+		  && bench.name.find(opts.filter) == std::string::npos){
+			continue;
+		}
+		measure(bench, opts);
+	}
+	return 0;
+}
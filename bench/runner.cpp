@@ -0,0 +1,163 @@
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sched.h>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "corpus.hpp"
+#include "runner.hpp"
+
+namespace crona{
+
+static void onAlarm(int){ }
+
+static double millis(const struct timeval& time){
+	return static_cast<double>(time.tv_sec) * 1e3
+	  + static_cast<double>(time.tv_usec) / 1e3;
+}
+
+RunResult Runner::run(const std::vector<std::string>& args) const {
+	RunResult result;
+	std::vector<char *> argv;
+	for (auto& arg : args){
+		argv.push_back(const_cast<char *>(arg.c_str()));
+	}
+	argv.push_back(nullptr);
+	const char * outPath = output.empty() ? "/dev/null" : output.c_str();
+
+	auto start = std::chrono::steady_clock::now();
+	pid_t child = fork();
+	if (child < 0){
+		std::cerr << "fork: " << strerror(errno) << std::endl;
+		std::exit(1);
+	}
+	if (child == 0){
+		int out = open(outPath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		dup2(out, 1);
+		dup2(out, 2);
+		if (maxRssMB > 0){
+			struct rlimit limit;
+			limit.rlim_cur = limit.rlim_max = maxRssMB << 20;
+			setrlimit(RLIMIT_AS, &limit);
+		}
+		if (cpu >= 0){
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+			CPU_SET(static_cast<size_t>(cpu), &cpus);
+			sched_setaffinity(0, sizeof(cpus), &cpus);
+		}
+		execv(argv[0], argv.data());
+		_exit(127);
+	}
+
+	//The alarm interrupts the wait, rather than restarting it
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = onAlarm;
+	sigaction(SIGALRM, &action, nullptr);
+	alarm(timeout);
+	int status = 0;
+	struct rusage usage;
+	while (wait4(child, &status, 0, &usage) < 0){
+		if (errno != EINTR){
+			std::cerr << "wait: " << strerror(errno) << std::endl;
+			std::exit(1);
+		}
+		result.timedOut = true;
+		kill(child, SIGKILL);
+	}
+	alarm(0);
+	auto end = std::chrono::steady_clock::now();
+
+	result.wallMs = std::chrono::duration<double, std::milli>(end - start)
+	  .count();
+	result.userMs = millis(usage.ru_utime);
+	result.sysMs = millis(usage.ru_stime);
+	result.peakKB = usage.ru_maxrss;
+	result.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	return result;
+}
+
+std::vector<std::string> Runner::modeArgs(const std::string& mode,
+	const std::string& outPath){
+	if (mode == "t"){ return { "-t", outPath }; }
+	if (mode == "p"){ return { "-p" }; }
+	if (mode == "u"){ return { "-u", outPath }; }
+	if (mode == "n"){ return { "-n", outPath }; }
+	if (mode == "c"){ return { "-c" }; }
+	return {};
+}
+
+bool Runner::parseSize(const std::string& text, size_t& bytes){
+	char * end = nullptr;
+	unsigned long long count = strtoull(text.c_str(), &end, 10);
+	if (end == text.c_str()){ return false; }
+	switch (*end){
+	case 'K': count <<= 10; end++; break;
+	case 'M': count <<= 20; end++; break;
+	case 'G': count <<= 30; end++; break;
+	default: break;
+	}
+	bytes = static_cast<size_t>(count);
+	return *end == '\0' && bytes > 0;
+}
+
+std::vector<std::string> Runner::splitList(const char * list){
+	std::vector<std::string> items;
+	std::istringstream in(list);
+	std::string item;
+	while (std::getline(in, item, ',')){
+		if (!item.empty()){ items.push_back(item); }
+	}
+	return items;
+}
+
+std::string Runner::corpusFile(const std::string& dir,
+	const std::string& sizeName, size_t bytes, unsigned long long seed){
+	CorpusShape shape;
+	shape.seed = seed;
+	shape.bytes = bytes;
+	return corpusFile(dir, "size-" + sizeName + "-seed-"
+	  + std::to_string(seed), shape);
+}
+
+std::string Runner::corpusFile(const std::string& dir,
+	const std::string& name, const CorpusShape& shape){
+	mkdir(dir.c_str(), 0777);
+	std::string path = dir + "/" + name + ".crona";
+	struct stat info;
+	if (stat(path.c_str(), &info) == 0){ return path; }
+	std::cerr << "generating " << path << std::endl;
+	std::string temp = path + ".part";
+	std::ofstream out(temp);
+	if (!out.good()){
+		std::cerr << "Bad output file " << temp << std::endl;
+		std::exit(1);
+	}
+	CorpusWriter(shape).write(out);
+	out.close();
+	if (!out.good() || rename(temp.c_str(), path.c_str()) != 0){
+		std::cerr << "Couldn't write " << path << std::endl;
+		std::exit(1);
+	}
+	return path;
+}
+
+int Runner::lastCPU(){
+	cpu_set_t cpus;
+	if (sched_getaffinity(0, sizeof(cpus), &cpus) != 0){ return -1; }
+	for (int cpu = CPU_SETSIZE - 1; cpu >= 0; cpu--){
+		if (CPU_ISSET(static_cast<size_t>(cpu), &cpus)){ return cpu; }
+	}
+	return -1;
+}
+
+}
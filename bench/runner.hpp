@@ -0,0 +1,60 @@
+#ifndef CRONA_BENCH_RUNNER
+#define CRONA_BENCH_RUNNER
+
+#include <string>
+#include <vector>
+#include "corpus.hpp"
+
+namespace crona{
+
+class RunResult{
+public:
+	RunResult() : status(-1), timedOut(false), wallMs(0), userMs(0),
+	  sysMs(0), peakKB(0){ }
+	int status;
+	bool timedOut;
+	double wallMs;
+	double userMs;
+	double sysMs;
+	long peakKB;
+};
+
+// Runs a compiler as a child process and measures it: its wall
+// time from fork to exit, and its CPU time and peak RSS from
+// wait4. What the tools that run cronac over corpora share.
+class Runner{
+public:
+	Runner() : timeout(0), maxRssMB(0), cpu(-1){ }
+	//Seconds before the child is killed, or 0 for no limit
+	unsigned timeout;
+	//Megabytes of address space the child may have, or 0
+	size_t maxRssMB;
+	//The CPU to pin the child to, or -1 to leave it unpinned
+	int cpu;
+	//Where the child's stdout and stderr go; /dev/null if empty
+	std::string output;
+
+	RunResult run(const std::vector<std::string>& args) const;
+
+	//The arguments for one of the modes t, p, u, n and c, writing
+	// any output file to outPath. Empty for an unknown mode.
+	static std::vector<std::string> modeArgs(const std::string& mode,
+		const std::string& outPath);
+	//A count such as 64K, 4M or 1G
+	static bool parseSize(const std::string& text, size_t& bytes);
+	static std::vector<std::string> splitList(const char * list);
+	//The generated program of about the given size, in dir,
+	// written the first time it is asked for
+	static std::string corpusFile(const std::string& dir,
+		const std::string& sizeName, size_t bytes, unsigned long long seed);
+	//The generated program of the given shape, named name in dir
+	static std::string corpusFile(const std::string& dir,
+		const std::string& name, const CorpusShape& shape);
+	//The last CPU this process may run on, which is the least
+	// likely to be handling interrupts, or -1 if unknown
+	static int lastCPU();
+};
+
+}
+
+#endif
@@ -0,0 +1,540 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "runner.hpp"
+
+using namespace crona;
+
+static void usageAndDie(){
+	std::cerr << "Usage: cronascale [options]\n"
+	<< "Check cronac over families of programs that grow along one"
+	<< " axis at a time, at n, 2n, 4n and 8n, and fail if the time of"
+	<< " a phase or the work of a data structure grows faster with the"
+	<< " program than expected\n"
+	<< " [--cronac <path>]: The compiler to check (default ../cronac)\n"
+	<< " [--axes <axis>,...]: Any of globals, nesting, arrays,"
+	<< " operands and formals (default all of them)\n"
+	<< " [--scale <k>]: Multiply the n of every axis by <k>"
+	<< " (default 1)\n"
+	<< " [--reps <n>]: Timed runs of each program, keeping the"
+	<< " fastest (default 5)\n"
+	<< " [--tolerance <x>]: How far above the expected exponent a"
+	<< " phase's time may grow (default 0.5)\n"
+	<< " [--min-ms <ms>]: Only judge a phase that takes this long on"
+	<< " the smallest program (default 1)\n"
+	<< " [--cpu <n>]: Pin cronac to CPU <n>, or -1 not to pin"
+	<< " (default the last CPU this may run on)\n"
+	<< " [--seed <n>]: Seed for the programs (default 1)\n"
+	<< " [--corpus <dir>]: Keep the programs in <dir>"
+	<< " (default corpus)\n"
+	<< " [--timeout <seconds>]: Fail an axis whose run takes longer"
+	<< " (default 300)\n"
+	<< " [--json <file>]: Also write one JSON object per axis and"
+	<< " measure to <file>\n";
+	std::exit(1);
+}
+
+// One way a program can grow. Each family starts from the same
+// small program, and grows only along its axis, so the fitted
+// exponent belongs to that axis alone.
+class Axis{
+public:
+	const char * name;
+	const char * grows;
+	size_t n;
+	void (*set)(CorpusShape& shape, size_t n);
+};
+
+//The functions are there only to use the globals, so a few do
+static void moreGlobals(CorpusShape& shape, size_t n){
+	shape.globals = n;
+	shape.functions = 4;
+}
+
+static void deeperNesting(CorpusShape& shape, size_t n){
+	shape.spine = n;
+}
+
+static void moreArrayTypes(CorpusShape& shape, size_t n){
+	shape.globals = n;
+	shape.functions = 4;
+	shape.arrays = 100;
+	shape.lengths = n;
+}
+
+static void longerExpressions(CorpusShape& shape, size_t n){
+	shape.operands = n;
+}
+
+//Arguments are then all names and literals, as a call in an
+// argument would make the program grow as the square of n
+static void moreFormals(CorpusShape& shape, size_t n){
+	shape.formals = n;
+	shape.depth = 1;
+}
+
+static const Axis AXES[] = {
+	{ "globals", "global variables", 2048, moreGlobals },
+	{ "nesting", "whiles nested in each function", 32, deeperNesting },
+	{ "arrays", "globals, each of its own array type", 1024,
+	  moreArrayTypes },
+	{ "operands", "operands chained in one expression of each function",
+	  256, longerExpressions },
+	{ "formals", "formals of each function", 64, moreFormals },
+};
+
+//What is measured of each run. Times are the CPU time of a phase
+// from --time-report, and vary from run to run; counts are from
+// --stats, and are the same on every run.
+class Measure{
+public:
+	const char * name;
+	bool isTime;
+	//The key of the phase in the time report, or the line of the
+	// census that the count is on
+	const char * key;
+	//What the count follows on that line, if not the key itself
+	const char * after;
+	//Whether the measure is a cost, which is judged, or a depth,
+	// which is only shown to explain the costs
+	bool judged;
+};
+
+static const Measure MEASURES[] = {
+	{ "parse", true, "parse", nullptr, true },
+	{ "name analysis", true, "name analysis", nullptr, true },
+	{ "type analysis", true, "type analysis", nullptr, true },
+	{ "total", true, nullptr, nullptr, true },
+	{ "nodes", false, "all nodes", nullptr, true },
+	{ "scopes walked", false, "lookups: ", "not found, ", true },
+	{ "basic type scans", false, "basic type flyweight scans: ", "scans, ",
+	  true },
+	{ "array type scans", false, "array type flyweight scans: ", "scans, ",
+	  true },
+	{ "expression depth", false, "deepest expression nesting: ", nullptr,
+	  false },
+	{ "block depth", false, "deepest block nesting: ", nullptr, false },
+};
+static const size_t MEASURE_COUNT = sizeof(MEASURES) / sizeof(MEASURES[0]);
+
+// Where an axis is known to cost more than linear time, by how
+// the data structures are built, the measures it shows in and the
+// exponent they grow at. Any other measure of any axis is expected
+// to grow at most linearly. A change that makes one of these
+// linear should remove it here, so that it stays so.
+class Known{
+public:
+	const char * axis;
+	const char * measures[4];
+	double exponent;
+	const char * why;
+};
+
+static const Known KNOWN[] = {
+	{ "nesting", { "scopes walked", "name analysis", "total", nullptr }, 2,
+	  "SymbolTable::find walks the scope chain from the innermost out" },
+	{ "arrays", { "array type scans", "name analysis", "total", nullptr }, 2,
+	  "ArrayType::produce scans a list of every array type made" },
+};
+
+//Counts are the same on every run, so only the part of the
+// program that does not grow, and the randomness of the rest,
+// keep them off their exponent. Times also grow faster as the
+// data outgrows the caches, and so are allowed more by default.
+static const double COUNT_TOLERANCE = 0.2;
+
+static const size_t POINTS = 4;
+
+static const Known * knownCost(const char * axis, const char * measure){
+	for (const Known& known : KNOWN){
+		if (strcmp(known.axis, axis) != 0){ continue; }
+		for (size_t k = 0; k < 4 && known.measures[k] != nullptr; k++){
+			if (strcmp(known.measures[k], measure) == 0){ return &known; }
+		}
+	}
+	return nullptr;
+}
+
+static std::string readFile(const std::string& path){
+	std::ifstream in(path);
+	return std::string(std::istreambuf_iterator<char>(in),
+		std::istreambuf_iterator<char>());
+}
+
+//The number after "key": in one line of JSON, looking only
+// between from and the end of the object it starts in
+static bool jsonNumber(const std::string& json, size_t from,
+	const char * key, double& value){
+	size_t end = json.find('}', from);
+	size_t at = json.find("\"" + std::string(key) + "\":", from);
+	if (at == std::string::npos || at > end){ return false; }
+	value = strtod(json.c_str() + at + strlen(key) + 3, nullptr);
+	return true;
+}
+
+//The count that follows key in the census, or follows after on
+// the line of key, skipping any spaces
+static bool censusCount(const std::string& census, const char * key,
+	const char * after, double& value){
+	size_t at = census.find(key);
+	if (at == std::string::npos){ return false; }
+	at += strlen(key);
+	if (after != nullptr){
+		size_t end = census.find('\n', at);
+		at = census.find(after, at);
+		if (at == std::string::npos || at > end){ return false; }
+		at += strlen(after);
+	}
+	const char * start = census.c_str() + at;
+	char * end = nullptr;
+	value = strtod(start, &end);
+	return end != start;
+}
+
+//The least-squares slope of log y against log x: the exponent k
+// of y = c * x^k that fits the points best
+static double logSlope(const std::vector<double>& x,
+	const std::vector<double>& y){
+	double n = static_cast<double>(x.size());
+	double meanX = 0;
+	double meanY = 0;
+	for (size_t k = 0; k < x.size(); k++){
+		meanX += std::log(x[k]) / n;
+		meanY += std::log(y[k]) / n;
+	}
+	double cov = 0;
+	double var = 0;
+	for (size_t k = 0; k < x.size(); k++){
+		double dx = std::log(x[k]) - meanX;
+		cov += dx * (std::log(y[k]) - meanY);
+		var += dx * dx;
+	}
+	return var > 0 ? cov / var : 0;
+}
+
+// The runs of one family: a program at each of n, 2n, 4n and 8n,
+// and what each measure came to on it
+class Family{
+public:
+	Family(const Axis& axisIn) : axis(axisIn), failed(false){ }
+	const Axis& axis;
+	std::vector<size_t> ns;
+	std::vector<std::string> inputs;
+	std::vector<double> tokens;
+	//By measure, then by point; times keep the least seen
+	std::vector<double> values[MEASURE_COUNT];
+	bool failed;
+	std::string why;
+};
+
+class Options{
+public:
+	Options() : cronac("../cronac"), scale(1), reps(5), tolerance(0.5),
+	  minMs(1), seed(1), corpusDir("corpus"), jsonPath(nullptr){ }
+	std::string cronac;
+	size_t scale;
+	size_t reps;
+	double tolerance;
+	double minMs;
+	unsigned long long seed;
+	std::string corpusDir;
+	const char * jsonPath;
+	Runner runner;
+};
+
+static bool censusOf(Family& family, size_t point, const Options& opts,
+	const std::string& scratch){
+	Runner runner = opts.runner;
+	runner.output = scratch + ".stats";
+	RunResult run = runner.run({ opts.cronac, family.inputs[point], "-c",
+		"--stats" });
+	if (run.timedOut || run.status != 0){
+		family.failed = true;
+		family.why = std::string(run.timedOut ? "timed out" : "failed")
+		  + " on " + family.inputs[point];
+		return false;
+	}
+	std::string census = readFile(runner.output);
+	for (size_t m = 0; m < MEASURE_COUNT; m++){
+		if (MEASURES[m].isTime){ continue; }
+		double count = 0;
+		censusCount(census, MEASURES[m].key, MEASURES[m].after, count);
+		family.values[m][point] = count;
+	}
+	return true;
+}
+
+static bool timeOf(Family& family, size_t point, const Options& opts,
+	const std::string& scratch){
+	std::string reportPath = scratch + ".json";
+	RunResult run = opts.runner.run({ opts.cronac, family.inputs[point],
+		"-c", "--time-report=" + reportPath });
+	if (run.timedOut || run.status != 0){
+		family.failed = true;
+		family.why = std::string(run.timedOut ? "timed out" : "failed")
+		  + " on " + family.inputs[point];
+		return false;
+	}
+	std::string report = readFile(reportPath);
+	double tokens = 0;
+	jsonNumber(report, 0, "tokens", tokens);
+	family.tokens[point] = tokens;
+	for (size_t m = 0; m < MEASURE_COUNT; m++){
+		if (!MEASURES[m].isTime){ continue; }
+		double us = 0;
+		if (MEASURES[m].key == nullptr){
+			jsonNumber(report, 0, "cpu_us", us);
+		} else {
+			std::string tag = "{\"name\":\"" + std::string(MEASURES[m].key)
+			  + "\"";
+			size_t at = report.find(tag);
+			if (at == std::string::npos){ continue; }
+			jsonNumber(report, at, "cpu_us", us);
+		}
+		double& least = family.values[m][point];
+		if (least < 0 || us < least){ least = us; }
+	}
+	return true;
+}
+
+//Generate and run one family. Every rep runs each program once,
+// so that a change in the machine's speed falls on all of them.
+static void runFamily(Family& family, const Options& opts){
+	const Axis& axis = family.axis;
+	for (size_t k = 0; k < POINTS; k++){
+		size_t n = (axis.n * opts.scale) << k;
+		CorpusShape shape;
+		shape.seed = opts.seed;
+		//Little but the axis grows, so the rest of the program
+		// should be small beside it. Axes that grow each function
+		// have a few of them, so that their randomness evens out.
+		shape.functions = 16;
+		shape.body = 2;
+		shape.depth = 2;
+		shape.nesting = 1;
+		axis.set(shape, n);
+		family.ns.push_back(n);
+		family.inputs.push_back(Runner::corpusFile(opts.corpusDir,
+			"scale-" + std::string(axis.name) + "-" + std::to_string(n)
+			+ "-seed-" + std::to_string(opts.seed), shape));
+	}
+	family.tokens.assign(POINTS, 0);
+	for (size_t m = 0; m < MEASURE_COUNT; m++){
+		family.values[m].assign(POINTS, -1);
+	}
+	std::string scratch = opts.corpusDir + "/scale-run-"
+	  + std::to_string(getpid());
+	std::cerr << "scaling " << axis.name << ": " << axis.grows << ", n = "
+	  << family.ns.front() << std::endl;
+	for (size_t k = 0; k < POINTS && !family.failed; k++){
+		censusOf(family, k, opts, scratch);
+	}
+	for (size_t rep = 0; rep < opts.reps && !family.failed; rep++){
+		for (size_t k = 0; k < POINTS && !family.failed; k++){
+			timeOf(family, k, opts, scratch);
+		}
+	}
+	unlink((scratch + ".stats").c_str());
+	unlink((scratch + ".json").c_str());
+}
+
+// How one measure of a family grew, and whether that was more
+// than it should
+class Verdict{
+public:
+	Verdict() : slope(0), expected(1), limit(1), fitted(false),
+	  judged(false), superLinear(false), known(nullptr){ }
+	double slope;
+	double expected;
+	double limit;
+	//Whether there was enough to fit an exponent to
+	bool fitted;
+	//Whether that exponent counts against the axis
+	bool judged;
+	bool superLinear;
+	const Known * known;
+};
+
+static Verdict judge(const Family& family, size_t m, const Options& opts){
+	Verdict verdict;
+	const Measure& measure = MEASURES[m];
+	const std::vector<double>& values = family.values[m];
+	verdict.known = knownCost(family.axis.name, measure.name);
+	if (verdict.known != nullptr){ verdict.expected = verdict.known->exponent; }
+	verdict.limit = verdict.expected
+	  + (measure.isTime ? opts.tolerance : COUNT_TOLERANCE);
+	for (size_t k = 0; k < POINTS; k++){
+		if (values[k] <= 0 || family.tokens[k] <= 0){ return verdict; }
+	}
+	//Times too short to measure are all noise
+	if (measure.isTime && values.front() < opts.minMs * 1e3){
+		return verdict;
+	}
+	verdict.fitted = true;
+	verdict.slope = logSlope(family.tokens, values);
+	verdict.judged = measure.judged;
+	verdict.superLinear = verdict.judged && verdict.slope > verdict.limit;
+	return verdict;
+}
+
+static void writeFamily(const Family& family, const Options& opts,
+	std::ostream * json, bool& anyFailed){
+	const Axis& axis = family.axis;
+	std::cout << "\n" << axis.name << ": " << axis.grows << "\n";
+	if (family.failed){
+		std::cout << "  FAILED: " << family.why << "\n";
+		anyFailed = true;
+		if (json != nullptr){
+			*json << "{\"axis\":\"" << axis.name
+			  << "\",\"result\":\"failed\"}\n";
+		}
+		return;
+	}
+	std::cout << std::left << std::setw(20) << "  n" << std::right;
+	for (size_t n : family.ns){ std::cout << std::setw(12) << n; }
+	std::cout << "\n" << std::left << std::setw(20) << "  tokens"
+	  << std::right;
+	for (double tokens : family.tokens){
+		std::cout << std::setw(12) << static_cast<long long>(tokens);
+	}
+	std::cout << std::setw(10) << "exponent" << "\n";
+	for (size_t m = 0; m < MEASURE_COUNT; m++){
+		const Measure& measure = MEASURES[m];
+		Verdict verdict = judge(family, m, opts);
+		std::string label = std::string("  ") + measure.name
+		  + (measure.isTime ? " ms" : "");
+		std::cout << std::left << std::setw(20) << label << std::right;
+		for (double value : family.values[m]){
+			if (measure.isTime){
+				std::cout << std::fixed << std::setprecision(2) << std::setw(12)
+				  << value / 1e3;
+			} else {
+				std::cout << std::setw(12) << static_cast<long long>(value);
+			}
+		}
+		const char * result = "skipped";
+		if (verdict.fitted){
+			result = !verdict.judged ? "shown"
+			  : verdict.superLinear ? "superlinear" : "ok";
+			std::cout << std::fixed << std::setprecision(2) << std::setw(10)
+			  << verdict.slope;
+			if (verdict.superLinear){
+				std::cout << "  SUPERLINEAR, expected at most "
+				  << verdict.expected;
+				anyFailed = true;
+			} else if (verdict.known != nullptr){
+				std::cout << "  known: " << verdict.known->why;
+			}
+		} else {
+			std::cout << std::setw(10) << "-";
+		}
+		std::cout << "\n";
+		if (json == nullptr){ continue; }
+		*json << "{\"axis\":\"" << axis.name << "\",\"measure\":\""
+		  << measure.name << "\",\"n\":[";
+		for (size_t k = 0; k < POINTS; k++){
+			*json << (k > 0 ? "," : "") << family.ns[k];
+		}
+		*json << "],\"tokens\":[";
+		for (size_t k = 0; k < POINTS; k++){
+			*json << (k > 0 ? "," : "")
+			  << static_cast<long long>(family.tokens[k]);
+		}
+		*json << "],\"values\":[" << std::fixed << std::setprecision(0);
+		for (size_t k = 0; k < POINTS; k++){
+			*json << (k > 0 ? "," : "") << family.values[m][k];
+		}
+		*json << "],\"unit\":\"" << (measure.isTime ? "us" : "count")
+		  << "\"," << std::setprecision(3);
+		if (verdict.fitted){
+			*json << "\"exponent\":" << verdict.slope << ",";
+		}
+		*json << "\"expected\":" << verdict.expected << ",\"result\":\""
+		  << result << "\"}\n";
+	}
+	std::cout.flush();
+}
+
+int main(int argc, char * argv[]){
+	Options opts;
+	opts.runner.timeout = 300;
+	opts.runner.cpu = Runner::lastCPU();
+	const char * axisList = nullptr;
+	for (int i = 1; i < argc; i++){
+		if (i + 1 >= argc){ usageAndDie(); }
+		const char * arg = argv[i];
+		const char * value = argv[++i];
+		if (strcmp(arg, "--cronac") == 0){
+			opts.cronac = value;
+		} else if (strcmp(arg, "--axes") == 0){
+			axisList = value;
+		} else if (strcmp(arg, "--scale") == 0){
+			opts.scale = strtoul(value, nullptr, 10);
+			if (opts.scale == 0){ usageAndDie(); }
+		} else if (strcmp(arg, "--reps") == 0){
+			opts.reps = strtoul(value, nullptr, 10);
+			if (opts.reps == 0){ usageAndDie(); }
+		} else if (strcmp(arg, "--tolerance") == 0){
+			opts.tolerance = strtod(value, nullptr);
+		} else if (strcmp(arg, "--min-ms") == 0){
+			opts.minMs = strtod(value, nullptr);
+		} else if (strcmp(arg, "--cpu") == 0){
+			opts.runner.cpu = atoi(value);
+		} else if (strcmp(arg, "--seed") == 0){
+			opts.seed = strtoull(value, nullptr, 10);
+		} else if (strcmp(arg, "--corpus") == 0){
+			opts.corpusDir = value;
+		} else if (strcmp(arg, "--timeout") == 0){
+			opts.runner.timeout = static_cast<unsigned>(
+				strtoul(value, nullptr, 10));
+		} else if (strcmp(arg, "--json") == 0){
+			opts.jsonPath = value;
+		} else {
+			usageAndDie();
+		}
+	}
+
+	std::vector<const Axis *> axes;
+	if (axisList == nullptr){
+		for (const Axis& axis : AXES){ axes.push_back(&axis); }
+	} else {
+		for (auto& name : Runner::splitList(axisList)){
+			const Axis * found = nullptr;
+			for (const Axis& axis : AXES){
+				if (name == axis.name){ found = &axis; }
+			}
+			if (found == nullptr){ usageAndDie(); }
+			axes.push_back(found);
+		}
+	}
+	if (access(opts.cronac.c_str(), X_OK) != 0){
+		std::cerr << "No compiler at " << opts.cronac << std::endl;
+		return 1;
+	}
+	std::ofstream jsonFile;
+	if (opts.jsonPath != nullptr){
+		jsonFile.open(opts.jsonPath);
+		if (!jsonFile.good()){
+			std::cerr << "Bad output file " << opts.jsonPath << std::endl;
+			return 1;
+		}
+	}
+
+	bool anyFailed = false;
+	for (const Axis * axis : axes){
+		Family family(*axis);
+		runFamily(family, opts);
+		writeFamily(family, opts, opts.jsonPath ? &jsonFile : nullptr,
+			anyFailed);
+	}
+	std::cout << (anyFailed ? "\nsome costs grew faster than expected\n"
+	  : "\nevery cost grew as expected\n");
+	return anyFailed ? 2 : 0;
+}
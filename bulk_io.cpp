@@ -0,0 +1,430 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "errors.hpp"
+#include "bulk_io.hpp"
+
+namespace crona{
+
+BulkIO * BulkIO::activeIO = nullptr;
+
+// A single io_uring, driven through the raw system calls. Only
+// the I/O thread touches it, so the one ordering that matters is
+// that with the kernel, on the ring heads and tails.
+class Ring{
+public:
+	static Ring * create(unsigned entries){
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		long fd = syscall(__NR_io_uring_setup, entries, &params);
+		if (fd < 0){ return nullptr; }
+		Ring * ring = new Ring(static_cast<int>(fd), params);
+		if (!ring->mapped()){
+			delete ring;
+			return nullptr;
+		}
+		return ring;
+	}
+
+	~Ring(){
+		if (sqes != MAP_FAILED){ munmap(sqes, sqesSize); }
+		if (cqBase != MAP_FAILED && cqBase != sqBase){
+			munmap(cqBase, cqSize);
+		}
+		if (sqBase != MAP_FAILED){ munmap(sqBase, sqSize); }
+		close(fd);
+	}
+
+	//Queue a read or write of len bytes at the given offset
+	// of fd into or from buf. Returns false if the ring is full.
+	bool push(unsigned char opcode, int fileFd, char * buf,
+		size_t len, size_t offset, void * data){
+		unsigned tail = *sqTail;
+		if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries){
+			return false;
+		}
+		unsigned index = tail & sqMask;
+		io_uring_sqe * sqe = &sqes[index];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = opcode;
+		sqe->fd = fileFd;
+		sqe->addr = reinterpret_cast<uint64_t>(buf);
+		sqe->len = static_cast<uint32_t>(len);
+		sqe->off = offset;
+		sqe->user_data = reinterpret_cast<uint64_t>(data);
+		sqArray[index] = index;
+		__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+		unsubmitted++;
+		return true;
+	}
+
+	//Hand every queued op to the kernel, and wait until at
+	// least one has completed
+	bool submitAndWait(){
+		while (true){
+			long res = syscall(__NR_io_uring_enter, fd, unsubmitted, 1,
+				IORING_ENTER_GETEVENTS, nullptr, 0);
+			if (res >= 0){
+				unsubmitted -= static_cast<unsigned>(res);
+				return true;
+			}
+			if (errno != EINTR){ return false; }
+		}
+	}
+
+	//Take the next completion, if there is one
+	bool reap(void *& data, int& res){
+		unsigned head = *cqHead;
+		if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)){
+			return false;
+		}
+		io_uring_cqe * cqe = &cqes[head & cqMask];
+		data = reinterpret_cast<void *>(cqe->user_data);
+		res = cqe->res;
+		__atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+		return true;
+	}
+
+private:
+	Ring(int fdIn, const io_uring_params& params)
+	: fd(fdIn), unsubmitted(0){
+		sqEntries = params.sq_entries;
+		sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cqSize = params.cq_off.cqes
+		  + params.cq_entries * sizeof(io_uring_cqe);
+		bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (single && cqSize > sqSize){ sqSize = cqSize; }
+		sqBase = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+		cqBase = sqBase;
+		if (!single && sqBase != MAP_FAILED){
+			cqBase = mmap(nullptr, cqSize, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		}
+		sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+		void * sqeBase = MAP_FAILED;
+		if (sqBase != MAP_FAILED && cqBase != MAP_FAILED){
+			sqeBase = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+		}
+		sqes = static_cast<io_uring_sqe *>(sqeBase);
+		if (!mapped()){ return; }
+
+		char * sq = static_cast<char *>(sqBase);
+		sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+		sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+		sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+		sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+		char * cq = static_cast<char *>(cqBase);
+		cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+		cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+		cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+		cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+	}
+
+	bool mapped(){
+		return sqBase != MAP_FAILED && cqBase != MAP_FAILED
+		  && sqes != MAP_FAILED;
+	}
+
+	int fd;
+	unsigned unsubmitted;
+	unsigned sqEntries;
+	size_t sqSize;
+	size_t cqSize;
+	size_t sqesSize;
+	void * sqBase;
+	void * cqBase;
+	io_uring_sqe * sqes;
+	unsigned * sqHead;
+	unsigned * sqTail;
+	unsigned sqMask;
+	unsigned * sqArray;
+	unsigned * cqHead;
+	unsigned * cqTail;
+	unsigned cqMask;
+	io_uring_cqe * cqes;
+};
+
+BulkIO::BulkIO(bool useRing)
+: mode(THREAD), ring(nullptr), stopping(false), nextRead(0),
+  released(0), wanted(0), writesPending(0){
+	if (useRing){
+		ring = Ring::create(DEPTH);
+		if (ring != nullptr){ mode = RING; }
+	}
+	ioThread = std::thread([this](){ serve(); });
+}
+
+BulkIO::~BulkIO(){
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		stopping = true;
+	}
+	changed.notify_all();
+	ioThread.join();
+	delete ring;
+	for (auto bytes : inputs){
+		delete bytes;
+	}
+}
+
+void BulkIO::prefetch(const std::vector<const char *>& pathsIn){
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		paths = pathsIn;
+		inputs.assign(paths.size(), nullptr);
+		states.assign(paths.size(), WAITING);
+	}
+	changed.notify_all();
+}
+
+const std::string * BulkIO::input(size_t k){
+	std::unique_lock<std::mutex> guard(lock);
+	if (k + 1 > wanted){
+		wanted = k + 1;
+		changed.notify_all();
+	}
+	changed.wait(guard, [&](){ return states[k] != WAITING; });
+	return states[k] == READY ? inputs[k] : nullptr;
+}
+
+void BulkIO::release(size_t k){
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		delete inputs[k];
+		inputs[k] = nullptr;
+		states[k] = RELEASED;
+		released++;
+	}
+	changed.notify_all();
+}
+
+void BulkIO::write(const char * path, const std::string& bytes){
+	Op * op = new Op(false, 0, path);
+	op->bytes = bytes;
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		writes.push_back(op);
+		writesPending++;
+	}
+	changed.notify_all();
+}
+
+bool BulkIO::finish(std::ostream& err){
+	std::unique_lock<std::mutex> guard(lock);
+	changed.wait(guard, [&](){ return writesPending == 0; });
+	if (!ringFailure.empty()){
+		err << ringFailure << "\n";
+		ringFailure.clear();
+	}
+	for (auto& path : failedWrites){
+		err << "Bad output file " << path << "\n";
+	}
+	bool ok = failedWrites.empty();
+	failedWrites.clear();
+	return ok;
+}
+
+//Take up to room new ops: queued writes first, since something
+// is done with their bytes, and then the next reads that fit in
+// the window. If block is set, waits until there is at least one.
+// Returns false once the thread should stop.
+bool BulkIO::nextOps(std::vector<Op *>& ops, size_t room, bool block){
+	std::unique_lock<std::mutex> guard(lock);
+	while (true){
+		while (ops.size() < room){
+			if (!writes.empty()){
+				ops.push_back(writes.front());
+				writes.pop_front();
+				continue;
+			}
+			size_t limit = released + WINDOW;
+			if (wanted > limit){ limit = wanted; }
+			if (!stopping && nextRead < paths.size() && nextRead < limit){
+				ops.push_back(new Op(true, nextRead, paths[nextRead]));
+				nextRead++;
+				continue;
+			}
+			break;
+		}
+		if (!ops.empty() || !block){ return true; }
+		if (stopping){ return false; }
+		changed.wait(guard);
+	}
+}
+
+bool BulkIO::open(Op * op){
+	if (op->isRead){
+		op->fd = ::open(op->path.c_str(), O_RDONLY | O_CLOEXEC);
+		struct stat info;
+		if (op->fd < 0 || fstat(op->fd, &info) != 0 
+		  || S_ISDIR(info.st_mode)){
+			return false;
+		}
+		if (S_ISREG(info.st_mode)){
+			op->bytes.resize(static_cast<size_t>(info.st_size));
+		} else {
+			op->toEnd = true;
+		}
+	} else {
+		op->fd = ::open(op->path.c_str(),
+			O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	}
+	return op->fd >= 0;
+}
+
+void BulkIO::runBlocking(Op * op){
+	if (op->toEnd){
+		readToEnd(op);
+		return;
+	}
+	while (op->done < op->bytes.size()){
+		char * at = &op->bytes[op->done];
+		size_t len = op->bytes.size() - op->done;
+		ssize_t res;
+		if (op->isRead){
+			res = pread(op->fd, at, len, static_cast<off_t>(op->done));
+		} else {
+			res = pwrite(op->fd, at, len, static_cast<off_t>(op->done));
+		}
+		if (res < 0 && errno == EINTR){ continue; }
+		if (res < 0){
+			op->failed = true;
+			return;
+		}
+		if (res == 0){ break; }
+		op->done += static_cast<size_t>(res);
+	}
+}
+
+void BulkIO::readToEnd(Op * op){
+	static const size_t CHUNK = 64 * 1024;
+	while (true){
+		if (op->bytes.size() - op->done < CHUNK){
+			op->bytes.resize(op->done + CHUNK);
+		}
+		ssize_t res = read(op->fd, &op->bytes[op->done], 
+			op->bytes.size() - op->done);
+		if (res < 0 && errno == EINTR){ continue; }
+		if (res < 0){
+			op->failed = true;
+			return;
+		}
+		if (res == 0){ break; }
+		op->done += static_cast<size_t>(res);
+	}
+	op->bytes.resize(op->done);
+}
+
+//Queue the rest of an op on the ring. Returns false if there
+// is nothing left of it to do, or it can't be done there.
+bool BulkIO::submit(Op * op){
+	if (op->toEnd || op->done >= op->bytes.size()){ return false; }
+	unsigned char opcode = op->isRead ? IORING_OP_READ : IORING_OP_WRITE;
+	return ring->push(opcode, op->fd, &op->bytes[op->done],
+		op->bytes.size() - op->done, op->done, op);
+}
+
+//Report the outcome of an op to whoever waits on it
+void BulkIO::settle(Op * op){
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		if (op->isRead){
+			if (op->failed){
+				states[op->index] = FAILED;
+			} else {
+				op->bytes.resize(op->done);
+				inputs[op->index] = new std::string();
+				inputs[op->index]->swap(op->bytes);
+				states[op->index] = READY;
+			}
+		} else {
+			if (op->failed){ failedWrites.push_back(op->path); }
+			writesPending--;
+		}
+	}
+	changed.notify_all();
+}
+
+void BulkIO::complete(Op * op){
+	if (op->fd >= 0){ close(op->fd); }
+	settle(op);
+	delete op;
+}
+
+//The ring can no longer be waited on. What was in flight on it
+// is reported as failed, but its buffers are never freed, since
+// the kernel may still be using them. Later ops are done on the
+// I/O thread alone.
+void BulkIO::abandonRing(){
+	std::string why = strerror(errno);
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		ringFailure = "io_uring_enter failed: " + why 
+		  + "; finished without io_uring";
+	}
+	for (auto op : inFlight){
+		op->failed = true;
+		settle(op);
+	}
+	inFlight.clear();
+}
+
+void BulkIO::serve(){
+	bool useRing = mode == RING;
+	while (true){
+		std::vector<Op *> ops;
+		size_t room = useRing ? DEPTH - inFlight.size() : 1;
+		if (!nextOps(ops, room, inFlight.empty())){ return; }
+		for (auto op : ops){
+			if (!open(op)){
+				op->failed = true;
+				complete(op);
+			} else if (useRing && submit(op)){
+				inFlight.insert(op);
+			} else {
+				runBlocking(op);
+				complete(op);
+			}
+		}
+		if (inFlight.empty()){ continue; }
+		if (!ring->submitAndWait()){
+			abandonRing();
+			useRing = false;
+			continue;
+		}
+		void * data;
+		int res;
+		while (ring->reap(data, res)){
+			Op * op = static_cast<Op *>(data);
+			inFlight.erase(op);
+			if (res < 0){
+				//An op the kernel won't do through the ring is
+				// finished the ordinary way
+				runBlocking(op);
+			} else if (res == 0){
+				//The end of a file that shrank since it was opened
+				op->failed = !op->isRead;
+				op->bytes.resize(op->done);
+			} else {
+				op->done += static_cast<size_t>(res);
+			}
+			//A failed op is not retried, and the rest of one the
+			// ring is too full to take is done here
+			if (!op->failed && submit(op)){
+				inFlight.insert(op);
+			} else {
+				if (!op->failed){ runBlocking(op); }
+				complete(op);
+			}
+		}
+	}
+}
+
+}
@@ -0,0 +1,206 @@
+#ifndef CRONA_BULK_IO
+#define CRONA_BULK_IO
+
+#include <condition_variable>
+#include <deque>
+#include <istream>
+#include <fstream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "decompress.hpp"
+
+namespace crona{
+
+class Ring;
+
+// File I/O for a batch, done on a thread of its own so that it
+// overlaps compilation. Inputs are read ahead into memory in the
+// order they will be compiled, keeping at most WINDOW files read
+// but not yet released. Output files are written in the background
+// from text already rendered in memory.
+//
+// Where the kernel provides io_uring, up to DEPTH reads and writes
+// are kept in flight at once through a single ring. Otherwise the
+// I/O thread does them one at a time with plain system calls,
+// which still keeps them off the compiling threads. Inputs that
+// are not regular files (pipes, /dev/stdin) have no size to read
+// up to, and are read to their end with plain system calls. If
+// the ring itself fails, the ops in flight on it are reported as
+// failed and the rest are done without it.
+class BulkIO{
+public:
+	enum Mode{ THREAD, RING };
+
+	//Use the ring if asked and the kernel allows it, and the
+	// I/O thread alone otherwise
+	BulkIO(bool useRing);
+	//Finishes any pending writes
+	~BulkIO();
+
+	Mode getMode(){ return mode; }
+	static const char * modeName(Mode mode){
+		return mode == RING ? "io_uring" : "thread";
+	}
+
+	//Start reading the given files, in the order given. Must be
+	// called at most once, before any input is asked for.
+	void prefetch(const std::vector<const char *>& paths);
+
+	//Wait for the k-th prefetched file and return its bytes, or
+	// nullptr if it couldn't be read. The bytes stay valid until
+	// the file is released.
+	const std::string * input(size_t k);
+	void release(size_t k);
+
+	//Queue the bytes to be written to the file at path
+	void write(const char * path, const std::string& bytes);
+
+	//Wait for every queued write, reporting any that failed to
+	// err. Returns false if any did.
+	bool finish(std::ostream& err);
+
+	//The instance that output should be queued on, if any. There
+	// is none on a thread that holds a Bypass.
+	static BulkIO * active(){ return *bypassed() ? nullptr : activeIO; }
+	static void setActive(BulkIO * io){ activeIO = io; }
+
+	//While one is held, output from the calling thread is written
+	// directly rather than queued, for output that is read back
+	// as soon as it has been written
+	class Bypass{
+	public:
+		Bypass() : prev(*bypassed()){ *bypassed() = true; }
+		~Bypass(){ *bypassed() = prev; }
+		Bypass(const Bypass&) = delete;
+		Bypass& operator=(const Bypass&) = delete;
+	private:
+		bool prev;
+	};
+
+	static const size_t DEPTH = 32;
+	static const size_t WINDOW = 256;
+
+private:
+	class Op{
+	public:
+		Op(bool isReadIn, size_t indexIn, std::string pathIn)
+		: isRead(isReadIn), index(indexIn), path(pathIn), fd(-1),
+		  done(0), failed(false), toEnd(false){ }
+		bool isRead;
+		//The input an op reads
+		size_t index;
+		std::string path;
+		//What is read, or what is to be written
+		std::string bytes;
+		int fd;
+		size_t done;
+		bool failed;
+		//Whether a read goes on until the end of input rather
+		// than to a size known up front
+		bool toEnd;
+	};
+
+	enum InputState{ WAITING, READY, FAILED, RELEASED };
+
+	void serve();
+	bool nextOps(std::vector<Op *>& ops, size_t room, bool block);
+	bool open(Op * op);
+	void runBlocking(Op * op);
+	void readToEnd(Op * op);
+	bool submit(Op * op);
+	void settle(Op * op);
+	void complete(Op * op);
+	void abandonRing();
+
+	Mode mode;
+	Ring * ring;
+	std::thread ioThread;
+	std::mutex lock;
+	std::condition_variable changed;
+	bool stopping;
+
+	std::vector<const char *> paths;
+	std::vector<std::string *> inputs;
+	std::vector<InputState> states;
+	size_t nextRead;
+	size_t released;
+	//One past the highest input asked for
+	size_t wanted;
+
+	std::deque<Op *> writes;
+	size_t writesPending;
+	std::vector<std::string> failedWrites;
+	//Ops handed to the ring and not yet reaped
+	std::unordered_set<Op *> inFlight;
+	//Why the ring was given up on, if it was
+	std::string ringFailure;
+
+	static BulkIO * activeIO;
+	static bool * bypassed(){
+		static thread_local bool bypass = false;
+		return &bypass;
+	}
+};
+
+//A read-only stream buffer over bytes already in memory
+class MemoryBuf : public std::streambuf{
+public:
+	MemoryBuf(const std::string& bytes){
+		char * begin = const_cast<char *>(bytes.data());
+		setg(begin, begin, begin + bytes.size());
+	}
+};
+
+// The source of an input file, read from the bytes given if
+// they have been read already, and from the file otherwise. A
+// compressed source is decompressed as it is read.
+class SourceStream : public std::istream{
+public:
+	SourceStream(const char * path, const std::string * bytes)
+	: std::istream(nullptr), memory(bytes ? *bytes : empty),
+	  decompressor(nullptr){
+		if (bytes != nullptr){
+			DecompressBuf::Format format = 
+				DecompressBuf::sniff(bytes->data(), bytes->size());
+			if (format == DecompressBuf::PLAIN){
+				rdbuf(&memory);
+			} else {
+				decompressor = new DecompressBuf(&memory);
+				useDecompressor();
+			}
+		} else if (file.open(path, std::ios::in | std::ios::binary)){
+			//The file may not be seekable, so its format is
+			// found by the decompressor, which passes plain
+			// text straight through
+			decompressor = new DecompressBuf(&file);
+			useDecompressor();
+		}
+	}
+	//A source read from raw, such as standard input's buffer
+	explicit SourceStream(std::streambuf * raw)
+	: std::istream(nullptr), memory(empty),
+	  decompressor(new DecompressBuf(raw)){
+		useDecompressor();
+	}
+	~SourceStream(){ delete decompressor; }
+private:
+	void useDecompressor(){
+		rdbuf(decompressor);
+		//A stream would otherwise swallow the error thrown
+		// for a corrupt input, and just stop reading
+		exceptions(std::ios::badbit);
+	}
+
+	const std::string empty;
+	MemoryBuf memory;
+	std::filebuf file;
+	DecompressBuf * decompressor;
+};
+
+}
+
+#endif
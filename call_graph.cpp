@@ -0,0 +1,343 @@
+#include <vector>
+#include "ast.hpp"
+#include "symbol_table.hpp"
+#include "errors.hpp"
+#include "name_analysis.hpp"
+#include "call_graph.hpp"
+
+namespace crona{
+
+CallGraph * CallGraph::build(NameAnalysis * nameAnalysis){
+	//Edges come from the symbols attached to each call, so
+	// a successful name analysis must be supplied
+	TimeReport::PhaseTimer timer("call graph");
+	CallGraph * graph = new CallGraph();
+	auto ast = nameAnalysis->ast;
+	graph->ast = ast;
+
+	ast->callGraph(graph);
+	graph->findSCCs();
+	if (Census * census = Census::current()){
+		census->hashMap("call graph functions", graph->fnInfos);
+	}
+	return graph;
+}
+
+CallGraph::FnInfo * CallGraph::info(FnSymbol * fn){
+	auto found = fnInfos.find(fn);
+	if (found == fnInfos.end()){
+		throw new InternalError("Function missing from call graph");
+	}
+	return found->second;
+}
+
+void CallGraph::enterFn(FnSymbol * fn){
+	currentFn = new FnInfo(fn);
+	fnInfos[fn] = currentFn;
+	fns.push_back(fn);
+}
+
+void CallGraph::addGlobal(VarSymbol * global){
+	globals.insert(global);
+}
+
+void CallGraph::addUse(SemSymbol * sym){
+	if (currentFn == nullptr){ return; }
+	FnSymbol * fn = sym->asFn();
+	if (fn != nullptr){
+		//Imported functions are defined in another module,
+		// so they have no node in this graph
+		if (fnInfos.find(fn) == fnInfos.end()){
+			if (currentFn->importedSet.insert(fn).second){
+				currentFn->imported.push_back(fn);
+			}
+			return;
+		}
+		if (currentFn->calleeSet.insert(fn).second){
+			currentFn->callees.push_back(fn);
+		}
+		return;
+	}
+	VarSymbol * var = sym->asVar();
+	if (var != nullptr && globals.count(var) > 0){
+		if (currentFn->globalsUsedSet.insert(var).second){
+			currentFn->globalsUsed.push_back(var);
+		}
+	}
+}
+
+const std::list<FnSymbol *> * CallGraph::callees(FnSymbol * fn){
+	return &info(fn)->callees;
+}
+
+const std::list<FnSymbol *> * CallGraph::importedCallees(FnSymbol * fn){
+	return &info(fn)->imported;
+}
+
+CallGraph::SCC * CallGraph::sccOf(FnSymbol * fn){
+	return info(fn)->scc;
+}
+
+FnSymbol * CallGraph::findFn(std::string name){
+	for (auto fn : fns){
+		if (fn->getName() == name){ return fn; }
+	}
+	return nullptr;
+}
+
+//Tarjan's algorithm, which finds every component in a
+// single depth-first pass and emits each one only after
+// all of the components it calls
+void CallGraph::findSCCs(){
+	for (auto fn : fns){
+		FnInfo * fnInfo = info(fn);
+		if (fnInfo->index < 0){
+			strongConnect(fnInfo);
+		}
+	}
+}
+
+//Depth-first from fnInfo, with the path kept in an explicit
+// stack of frames rather than on the call stack, since generated
+// programs may have call chains far deeper than the call stack
+void CallGraph::strongConnect(FnInfo * root){
+	class Frame{
+	public:
+		Frame(FnInfo * fnIn)
+		: fn(fnIn), next(fnIn->callees.begin()){ }
+		FnInfo * fn;
+		std::list<FnSymbol *>::iterator next;
+	};
+	std::vector<Frame> path;
+	visit(root);
+	path.push_back(Frame(root));
+	while (!path.empty()){
+		Frame& frame = path.back();
+		FnInfo * fnInfo = frame.fn;
+		if (frame.next != fnInfo->callees.end()){
+			FnInfo * calleeInfo = info(*frame.next);
+			frame.next++;
+			if (calleeInfo->index < 0){
+				visit(calleeInfo);
+				path.push_back(Frame(calleeInfo));
+			} else if (calleeInfo->onStack){
+				if (calleeInfo->index < fnInfo->lowLink){
+					fnInfo->lowLink = calleeInfo->index;
+				}
+			}
+			continue;
+		}
+
+		//Every callee is done, so the function's low link is
+		// final and passes up to its caller
+		path.pop_back();
+		if (!path.empty() && fnInfo->lowLink < path.back().fn->lowLink){
+			path.back().fn->lowLink = fnInfo->lowLink;
+		}
+		if (fnInfo->lowLink == fnInfo->index){ emitSCC(fnInfo); }
+	}
+}
+
+void CallGraph::visit(FnInfo * fnInfo){
+	fnInfo->index = nextIndex;
+	fnInfo->lowLink = nextIndex;
+	nextIndex++;
+	tarjanStack.push_front(fnInfo);
+	fnInfo->onStack = true;
+}
+
+//Pop the component whose root is fnInfo off the Tarjan stack
+void CallGraph::emitSCC(FnInfo * fnInfo){
+	SCC * scc = new SCC();
+	FnInfo * member = nullptr;
+	while (member != fnInfo){
+		member = tarjanStack.front();
+		tarjanStack.pop_front();
+		member->onStack = false;
+		member->scc = scc;
+		scc->members.push_front(member->fn);
+	}
+	if (scc->members.size() > 1){
+		scc->recursive = true;
+	} else if (fnInfo->calleeSet.count(fnInfo->fn) > 0){
+		scc->recursive = true;
+	}
+	sccs.push_back(scc);
+}
+
+bool CallGraph::markLive(std::string entry){
+	FnSymbol * entryFn = findFn(entry);
+	if (entryFn == nullptr){ return false; }
+
+	std::list<FnSymbol *> worklist;
+	worklist.push_back(entryFn);
+	live.insert(entry);
+	while (!worklist.empty()){
+		FnInfo * fnInfo = info(worklist.front());
+		worklist.pop_front();
+		for (auto global : fnInfo->globalsUsed){
+			live.insert(global->getName());
+		}
+		for (auto callee : fnInfo->callees){
+			if (live.insert(callee->getName()).second){
+				worklist.push_back(callee);
+			}
+		}
+	}
+	return true;
+}
+
+void CallGraph::prune(ProgramNode * program){
+	std::list<DeclNode *> * decls = program->getGlobals();
+	auto itr = decls->begin();
+	while (itr != decls->end()){
+		if (isLive((*itr)->ID()->getName())){
+			itr++;
+		} else {
+			//Nothing outside the tree points at a declaration,
+			// so a dropped one is freed here
+			delete *itr;
+			itr = decls->erase(itr);
+		}
+	}
+}
+
+void CallGraph::report(std::ostream& out){
+	for (auto fn : fns){
+		out << fn->getName() << ":";
+		for (auto callee : info(fn)->callees){
+			out << " " << callee->getName();
+		}
+		for (auto callee : info(fn)->imported){
+			out << " " << callee->getName() << " (imported)";
+		}
+		out << "\n";
+	}
+	out << "sccs:\n";
+	for (auto scc : sccs){
+		out << "\t";
+		bool first = true;
+		for (auto member : scc->members){
+			if (first){ first = false; }
+			else { out << " "; }
+			out << member->getName();
+		}
+		if (scc->recursive){ out << " (recursive)"; }
+		out << "\n";
+	}
+}
+
+void ProgramNode::callGraph(CallGraph * graph){
+	for (auto global : *myGlobals){
+		global->callGraph(graph);
+	}
+}
+
+void VarDeclNode::callGraph(CallGraph * graph){
+	if (!graph->inFunction()){
+		graph->addGlobal(myID->getSymbol()->asVar());
+	}
+}
+
+void FnDeclNode::callGraph(CallGraph * graph){
+	graph->enterFn(myID->getSymbol()->asFn());
+	for (auto stmt : *myBody){
+		stmt->callGraph(graph);
+	}
+	graph->leaveFn();
+}
+
+void StmtNode::callGraph(CallGraph * graph){
+	TODO("Override me in the subclass");
+}
+
+void AssignStmtNode::callGraph(CallGraph * graph){
+	myExp->callGraph(graph);
+}
+
+void ReadStmtNode::callGraph(CallGraph * graph){
+	myDst->callGraph(graph);
+}
+
+void WriteStmtNode::callGraph(CallGraph * graph){
+	mySrc->callGraph(graph);
+}
+
+void PostDecStmtNode::callGraph(CallGraph * graph){
+	myLVal->callGraph(graph);
+}
+
+void PostIncStmtNode::callGraph(CallGraph * graph){
+	myLVal->callGraph(graph);
+}
+
+void IfStmtNode::callGraph(CallGraph * graph){
+	myCond->callGraph(graph);
+	for (auto stmt : *myBody){
+		stmt->callGraph(graph);
+	}
+}
+
+void IfElseStmtNode::callGraph(CallGraph * graph){
+	myCond->callGraph(graph);
+	for (auto stmt : *myBodyTrue){
+		stmt->callGraph(graph);
+	}
+	for (auto stmt : *myBodyFalse){
+		stmt->callGraph(graph);
+	}
+}
+
+void WhileStmtNode::callGraph(CallGraph * graph){
+	myCond->callGraph(graph);
+	for (auto stmt : *myBody){
+		stmt->callGraph(graph);
+	}
+}
+
+void ReturnStmtNode::callGraph(CallGraph * graph){
+	if (myExp != nullptr){
+		myExp->callGraph(graph);
+	}
+}
+
+void CallStmtNode::callGraph(CallGraph * graph){
+	myCallExp->callGraph(graph);
+}
+
+void ExpNode::callGraph(CallGraph * graph){
+	//Literals name no symbols, so there is
+	// nothing to do by default
+}
+
+void IDNode::callGraph(CallGraph * graph){
+	graph->addUse(mySymbol);
+}
+
+void IndexNode::callGraph(CallGraph * graph){
+	myBase->callGraph(graph);
+	myOffset->callGraph(graph);
+}
+
+void CallExpNode::callGraph(CallGraph * graph){
+	myID->callGraph(graph);
+	for (auto arg : *myArgs){
+		arg->callGraph(graph);
+	}
+}
+
+void BinaryExpNode::callGraph(CallGraph * graph){
+	myExp1->callGraph(graph);
+	myExp2->callGraph(graph);
+}
+
+void UnaryExpNode::callGraph(CallGraph * graph){
+	myExp->callGraph(graph);
+}
+
+void AssignExpNode::callGraph(CallGraph * graph){
+	myDst->callGraph(graph);
+	mySrc->callGraph(graph);
+}
+
+}
@@ -0,0 +1,114 @@
+#ifndef CRONA_CALL_GRAPH
+#define CRONA_CALL_GRAPH
+
+#include <ostream>
+#include <list>
+#include <set>
+#include "ast.hpp"
+#include "symbol_table.hpp"
+
+namespace crona{
+
+class NameAnalysis;
+
+// The call graph has an edge from each function to every
+// function it names (as resolved by name analysis), and
+// records which globals each function uses. Functions imported
+// from other modules have no node; the calls each function
+// makes to them are kept apart from its edges. Functions are
+// grouped into strongly connected components, which are kept
+// callees-first: every function a component calls belongs
+// either to that component or to one listed before it.
+class CallGraph {
+
+private:
+	CallGraph(){
+		currentFn = nullptr;
+		nextIndex = 0;
+	}
+
+public:
+	static CallGraph * build(NameAnalysis * nameAnalysis);
+
+	class SCC{
+	public:
+		SCC() : recursive(false){ }
+		std::list<FnSymbol *> members;
+		//True if some member can call itself, either
+		// directly or through the other members
+		bool recursive;
+	};
+
+	bool inFunction(){ return currentFn != nullptr; }
+	void enterFn(FnSymbol * fn);
+	void leaveFn(){ currentFn = nullptr; }
+	void addGlobal(VarSymbol * global);
+	//Record that the current function names the given
+	// symbol: an edge if it is a function, a use if it is
+	// a global variable
+	void addUse(SemSymbol * sym);
+
+	const std::list<FnSymbol *> * callees(FnSymbol * fn);
+	//The imported functions that fn names
+	const std::list<FnSymbol *> * importedCallees(FnSymbol * fn);
+	const std::list<SCC *> * getSCCs(){ return &sccs; }
+	SCC * sccOf(FnSymbol * fn);
+	FnSymbol * findFn(std::string name);
+
+	//Mark everything reachable from the named function as
+	// live. Returns false if there is no such function.
+	bool markLive(std::string entry);
+	bool isLive(std::string name){
+		return live.find(name) != live.end();
+	}
+	//Drop and delete every global declaration that is not
+	// live. Live declarations are matched by name, so the
+	// program need not be the one the graph was built from;
+	// it may be a fresh parse of the same source.
+	void prune(ProgramNode * program);
+
+	//Write each function's callees and the list of
+	// components to out
+	void report(std::ostream& out);
+
+	ProgramNode * ast;
+
+private:
+	class FnInfo{
+	public:
+		FnInfo(FnSymbol * fnIn)
+		: fn(fnIn), index(-1), lowLink(0), onStack(false),
+		  scc(nullptr){ }
+		FnSymbol * fn;
+		std::list<FnSymbol *> callees;
+		std::set<FnSymbol *> calleeSet;
+		std::list<FnSymbol *> imported;
+		std::set<FnSymbol *> importedSet;
+		std::list<VarSymbol *> globalsUsed;
+		std::set<VarSymbol *> globalsUsedSet;
+		int index;
+		int lowLink;
+		bool onStack;
+		SCC * scc;
+	};
+
+	FnInfo * info(FnSymbol * fn);
+	void findSCCs();
+	void strongConnect(FnInfo * root);
+	void visit(FnInfo * fnInfo);
+	void emitSCC(FnInfo * fnInfo);
+
+	HashMap<FnSymbol *, FnInfo *> fnInfos;
+	//Functions in declaration order
+	std::list<FnSymbol *> fns;
+	std::set<VarSymbol *> globals;
+	std::list<SCC *> sccs;
+	std::list<FnInfo *> tarjanStack;
+	std::set<std::string> live;
+	FnInfo * currentFn;
+	int nextIndex;
+};
+
+}
+
+#endif
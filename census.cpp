@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <iomanip>
+#include <vector>
+#include "ast.hpp"
+#include "census.hpp"
+
+namespace crona{
+
+Census::Census(std::string subjectIn)
+: subject(subjectIn), shapeTaken(false), expDepth(0), maxExpDepth(0),
+  blockDepth(0), maxBlockDepth(0), scopesEntered(0), lookups(0),
+  misses(0), walked(0), arrayFlyweights(0), fnTypes(0){
+	for (size_t k = 0; k < WALK_BUCKETS; k++){ walks[k] = 0; }
+}
+
+void Census::takeShape(ProgramNode * program){
+	if (shapeTaken){ return; }
+	shapeTaken = true;
+	program->census(this);
+}
+
+void Census::takeShape(ASTNode * decl){
+	decl->census(this);
+}
+
+void Census::node(const ASTNode * node, size_t bytes){
+	NodeClass& nodeClass = nodeClasses[std::type_index(typeid(*node))];
+	nodeClass.count++;
+	nodeClass.bytes += bytes;
+}
+
+void Census::enterExp(){
+	expDepth++;
+	if (expDepth > maxExpDepth){ maxExpDepth = expDepth; }
+}
+
+void Census::enterBlock(){
+	blockDepth++;
+	if (blockDepth > maxBlockDepth){ maxBlockDepth = blockDepth; }
+}
+
+void Census::scopesWalked(size_t scopes, bool found){
+	lookups++;
+	walked += scopes;
+	if (!found){ misses++; }
+	size_t bucket = 0;
+	size_t limit = 1;
+	while (scopes > limit && bucket + 1 < WALK_BUCKETS){
+		bucket++;
+		limit = bucket < 4 ? bucket + 1 : limit * 2;
+	}
+	walks[bucket]++;
+}
+
+void Census::basicScan(size_t looked){
+	basicScans.add(looked);
+}
+
+void Census::arrayScan(size_t looked, size_t flyweights){
+	arrayScans.add(looked);
+	if (flyweights > arrayFlyweights){ arrayFlyweights = flyweights; }
+}
+
+void Census::fnTypeMade(const std::string& signature){
+	fnTypes++;
+	fnSignatures.insert(signature);
+}
+
+void Census::addMap(const char * kind, size_t elements, size_t buckets,
+	size_t longest){
+	MapKind& maps = mapKinds[kind];
+	maps.maps++;
+	maps.elements += elements;
+	maps.buckets += buckets;
+	if (longest > maps.longest){ maps.longest = longest; }
+	double load = buckets == 0 ? 0 : static_cast<double>(elements)
+	  / static_cast<double>(buckets);
+	if (load > maps.maxLoad){ maps.maxLoad = load; }
+}
+
+//A node class's name, without the namespace
+static std::string className(const std::type_index& type){
+	int status = 0;
+	char * demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr,
+		&status);
+	std::string name = status == 0 ? demangled : type.name();
+	free(demangled);
+	const std::string prefix = "crona::";
+	if (name.compare(0, prefix.size(), prefix) == 0){
+		name = name.substr(prefix.size());
+	}
+	return name;
+}
+
+static void putScans(std::ostream& out, const char * what, size_t scans,
+	size_t looked, size_t longest){
+	out << what << ": " << scans << " scans, ";
+	if (scans == 0){
+		out << "none\n";
+		return;
+	}
+	out << looked << " entries looked at, " << std::fixed
+	  << std::setprecision(2)
+	  << static_cast<double>(looked) / static_cast<double>(scans)
+	  << " on average, at most " << longest << "\n";
+}
+
+void Census::write(std::ostream& out){
+	out << "stats: " << subject << "\n";
+
+	//Node classes, largest total first
+	std::vector<std::pair<std::string, NodeClass>> classes;
+	size_t nodes = 0;
+	size_t nodeBytes = 0;
+	for (auto& entry : nodeClasses){
+		classes.push_back(std::make_pair(className(entry.first), entry.second));
+		nodes += entry.second.count;
+		nodeBytes += entry.second.bytes;
+	}
+	std::sort(classes.begin(), classes.end(),
+		[](const std::pair<std::string, NodeClass>& a,
+		   const std::pair<std::string, NodeClass>& b){
+			if (a.second.bytes != b.second.bytes){
+				return a.second.bytes > b.second.bytes;
+			}
+			return a.first < b.first;
+		});
+	out << std::left << std::setw(20) << "node class" << std::right
+	  << std::setw(12) << "count" << std::setw(14) << "bytes" << "\n";
+	for (auto& entry : classes){
+		out << std::left << std::setw(20) << entry.first << std::right
+		  << std::setw(12) << entry.second.count
+		  << std::setw(14) << entry.second.bytes << "\n";
+	}
+	out << std::left << std::setw(20) << "all nodes" << std::right
+	  << std::setw(12) << nodes << std::setw(14) << nodeBytes << "\n";
+	out << "deepest expression nesting: " << maxExpDepth << "\n";
+	out << "deepest block nesting: " << maxBlockDepth << "\n";
+
+	out << "scopes entered: " << scopesEntered << "\n";
+	out << "lookups: " << lookups << ", " << misses << " not found, "
+	  << walked << " scopes walked\n";
+	out << "scopes walked per lookup:";
+	static const char * walkNames[WALK_BUCKETS] = {
+		"1", "2", "3", "4", "<=8", "<=16", "<=32", ">32"
+	};
+	for (size_t k = 0; k < WALK_BUCKETS; k++){
+		if (walks[k] == 0){ continue; }
+		out << " " << walkNames[k] << ":" << walks[k];
+	}
+	out << "\n";
+
+	out << std::left << std::setw(24) << "hash maps" << std::right
+	  << std::setw(9) << "maps" << std::setw(12) << "elements"
+	  << std::setw(12) << "buckets" << std::setw(10) << "load"
+	  << std::setw(10) << "max load" << std::setw(14) << "longest chain"
+	  << "\n";
+	for (auto& entry : mapKinds){
+		const MapKind& maps = entry.second;
+		double load = maps.buckets == 0 ? 0 : static_cast<double>(
+			maps.elements) / static_cast<double>(maps.buckets);
+		out << std::left << std::setw(24) << entry.first << std::right
+		  << std::setw(9) << maps.maps << std::setw(12) << maps.elements
+		  << std::setw(12) << maps.buckets << std::fixed
+		  << std::setprecision(2) << std::setw(10) << load
+		  << std::setw(10) << maps.maxLoad << std::setw(14)
+		  << maps.longest << "\n";
+	}
+
+	putScans(out, "basic type flyweight scans", basicScans.scans,
+		basicScans.looked, basicScans.longest);
+	putScans(out, "array type flyweight scans", arrayScans.scans,
+		arrayScans.looked, arrayScans.longest);
+	out << "array type flyweights: " << arrayFlyweights << "\n";
+	out << "function types made: " << fnTypes << ", "
+	  << fnSignatures.size() << " distinct, "
+	  << fnTypes - fnSignatures.size() << " duplicates\n";
+	out.flush();
+}
+
+//Each node counts itself and then its children. Nodes with no
+// pass of their own add no fields to the class whose pass they
+// use, so the bytes counted are those of their own class.
+
+void ImportNode::census(Census * census){
+	census->node(this, sizeof(*this));
+}
+
+void ProgramNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	for (auto import : *myImports){
+		import->census(census);
+	}
+	for (auto global : *myGlobals){
+		global->census(census);
+	}
+}
+
+void ExpNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	census->enterExp();
+	census->leaveExp();
+}
+
+void IDNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	census->enterExp();
+	census->leaveExp();
+}
+
+void IndexNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	census->enterExp();
+	myBase->census(census);
+	myOffset->census(census);
+	census->leaveExp();
+}
+
+void TypeNode::census(Census * census){
+	census->node(this, sizeof(*this));
+}
+
+void ArrayTypeNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	myBase->census(census);
+}
+
+void VarDeclNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	myType->census(census);
+	myID->census(census);
+}
+
+static void blockCensus(Census * census, std::list<StmtNode *> * stmts){
+	census->enterBlock();
+	for (auto stmt : *stmts){
+		stmt->census(census);
+	}
+	census->leaveBlock();
+}
+
+void FnDeclNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	myID->census(census);
+	myRetType->census(census);
+	for (auto formal : *myFormals){
+		formal->census(census);
+	}
+	blockCensus(census, myBody);
+}
+
+void AssignStmtNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	myExp->census(census);
+}
+
+void ReadStmtNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	myDst->census(census);
+}
+
+void WriteStmtNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	mySrc->census(census);
+}
+
+void PostDecStmtNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	myLVal->census(census);
+}
+
+void PostIncStmtNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	myLVal->census(census);
+}
+
+void IfStmtNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	myCond->census(census);
+	blockCensus(census, myBody);
+}
+
+void IfElseStmtNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	myCond->census(census);
+	blockCensus(census, myBodyTrue);
+	blockCensus(census, myBodyFalse);
+}
+
+void WhileStmtNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	myCond->census(census);
+	blockCensus(census, myBody);
+}
+
+void ReturnStmtNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	if (myExp != nullptr){ myExp->census(census); }
+}
+
+void CallStmtNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	myCallExp->census(census);
+}
+
+void CallExpNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	census->enterExp();
+	myID->census(census);
+	for (auto arg : *myArgs){
+		arg->census(census);
+	}
+	census->leaveExp();
+}
+
+void BinaryExpNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	census->enterExp();
+	myExp1->census(census);
+	myExp2->census(census);
+	census->leaveExp();
+}
+
+void UnaryExpNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	census->enterExp();
+	myExp->census(census);
+	census->leaveExp();
+}
+
+void AssignExpNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	census->enterExp();
+	myDst->census(census);
+	mySrc->census(census);
+	census->leaveExp();
+}
+
+void IntLitNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	census->enterExp();
+	census->leaveExp();
+}
+
+void StrLitNode::census(Census * census){
+	census->node(this, sizeof(*this));
+	census->enterExp();
+	census->leaveExp();
+}
+
+}
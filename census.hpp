@@ -0,0 +1,140 @@
+#ifndef CRONA_CENSUS
+#define CRONA_CENSUS
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <typeindex>
+#include <unordered_set>
+
+namespace crona{
+
+class ASTNode;
+class ProgramNode;
+
+// The shape of the data a run built, for --stats: how many AST
+// nodes of each class there are and what they take up, how deep
+// expressions and blocks nest, how far symbol lookups walk up the
+// scope chain, how full every hash map is, how long the scans of
+// the type flyweight lists are, and how many function types are
+// made more than once. These tell which data structure a growing
+// input will strain first.
+//
+// Like a time report, a census is installed per thread, and
+// with none installed each hook costs one thread-local load.
+class Census{
+public:
+	Census(std::string subjectIn);
+
+	//The census of the calling thread, or null if none is
+	// being taken
+	static Census * current(){ return *slot(); }
+	//Make census the calling thread's census, and return the
+	// one it replaces
+	static Census * install(Census * census){
+		Census * prev = *slot();
+		*slot() = census;
+		return prev;
+	}
+
+	//Count the nodes of a program. Each stage parses the source
+	// again, so only the first program seen is counted.
+	void takeShape(ProgramNode * program);
+	//Count the nodes of one declaration of a stream
+	void takeShape(ASTNode * decl);
+
+	//Called by each node's census pass
+	void node(const ASTNode * node, size_t bytes);
+	void enterExp();
+	void leaveExp(){ expDepth--; }
+	void enterBlock();
+	void leaveBlock(){ blockDepth--; }
+
+	void scopeEntered(){ scopesEntered++; }
+	//A lookup that walked the given number of scopes, and
+	// whether it found the name
+	void scopesWalked(size_t scopes, bool found);
+	//A scan of a flyweight list that looked at the given number
+	// of entries, out of how many there were
+	void basicScan(size_t looked);
+	void arrayScan(size_t looked, size_t flyweights);
+	//A function type was made with the given signature
+	void fnTypeMade(const std::string& signature);
+
+	//The state of one hash map of the named kind
+	template <typename Map>
+	void hashMap(const char * kind, const Map& map){
+		size_t longest = 0;
+		for (size_t b = 0; b < map.bucket_count(); b++){
+			if (map.bucket_size(b) > longest){ longest = map.bucket_size(b); }
+		}
+		addMap(kind, map.size(), map.bucket_count(), longest);
+	}
+
+	void write(std::ostream& out);
+
+private:
+	static Census ** slot(){
+		static thread_local Census * census = nullptr;
+		return &census;
+	}
+	void addMap(const char * kind, size_t elements, size_t buckets,
+		size_t longest);
+
+	class NodeClass{
+	public:
+		NodeClass() : count(0), bytes(0){ }
+		size_t count;
+		size_t bytes;
+	};
+	class MapKind{
+	public:
+		MapKind() : maps(0), elements(0), buckets(0), longest(0),
+		  maxLoad(0){ }
+		size_t maps;
+		size_t elements;
+		size_t buckets;
+		size_t longest;
+		double maxLoad;
+	};
+	class Scans{
+	public:
+		Scans() : scans(0), looked(0), longest(0){ }
+		void add(size_t n){
+			scans++;
+			looked += n;
+			if (n > longest){ longest = n; }
+		}
+		size_t scans;
+		size_t looked;
+		size_t longest;
+	};
+
+	//Lookups are bucketed by scopes walked: 1, 2, 3, 4, up to
+	// 8, up to 16, up to 32, and more
+	static const size_t WALK_BUCKETS = 8;
+
+	std::string subject;
+	bool shapeTaken;
+	std::map<std::type_index, NodeClass> nodeClasses;
+	size_t expDepth;
+	size_t maxExpDepth;
+	size_t blockDepth;
+	size_t maxBlockDepth;
+	size_t scopesEntered;
+	size_t walks[WALK_BUCKETS];
+	size_t lookups;
+	size_t misses;
+	//Scopes walked by all lookups together
+	size_t walked;
+	std::map<std::string, MapKind> mapKinds;
+	Scans basicScans;
+	Scans arrayScans;
+	size_t arrayFlyweights;
+	size_t fnTypes;
+	std::unordered_set<std::string> fnSignatures;
+};
+
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef CRONA_CONTENT_HASH
+#define CRONA_CONTENT_HASH
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace crona{
+
+// A 64-bit FNV-1a hash, used to recognize inputs whose bytes
+// have not changed since they were last seen. Each piece added
+// is preceded by its length, so that different splits of the
+// same bytes hash differently.
+class ContentHash{
+public:
+	ContentHash() : state(14695981039346656037ULL){ }
+
+	void add(const std::string& bytes){
+		addRaw(std::to_string(bytes.size()));
+		addRaw(":");
+		addRaw(bytes);
+	}
+
+	uint64_t value() const { return state; }
+
+	//The hash as 16 lowercase hex digits
+	std::string hex() const {
+		char buf[17];
+		snprintf(buf, sizeof(buf), "%016llx", 
+			static_cast<unsigned long long>(state));
+		return buf;
+	}
+
+private:
+	void addRaw(const std::string& bytes){
+		for (char c : bytes){
+			state ^= static_cast<unsigned char>(c);
+			state *= 1099511628211ULL;
+		}
+	}
+
+	uint64_t state;
+};
+
+}
+
+#endif
@@ -14,6 +14,7 @@
 	#include "ast.hpp"
 	namespace crona {
 		class Scanner;
+		class DeclSink;
 	}
 
 //The following definition is required when 
@@ -31,6 +32,7 @@
 
 %parse-param { crona::Scanner &scanner }
 %parse-param { crona::ProgramNode** root }
+%parse-param { crona::DeclSink * sink }
 %code{
    // C std code for utility functions
    #include <iostream>
@@ -41,11 +43,17 @@
    #include "scanner.hpp"
    #include "ast.hpp"
    #include "tokens.hpp"
+   #include "stream.hpp"
 
   //Request tokens from our scanner member, not 
   // from a global function
   #undef yylex
-  #define yylex scanner.yylex
+  #define yylex scanner.lex
+
+  //How many AST nodes this thread had made when the global
+  // declaration being parsed began. Parsing is bottom up, so
+  // every node made since then is part of that declaration.
+  static thread_local size_t declStartNodes = 0;
 }
 
 %union {
@@ -55,6 +63,8 @@
    crona::IntLitToken*                   transIntToken;
    crona::StrToken*                      transStrToken;
    crona::ProgramNode*                   transProgram;
+   std::list<crona::ImportNode *> *      transImports;
+   crona::ImportNode *                   transImport;
    std::list<crona::DeclNode *> *        transDeclList;
    crona::DeclNode *                     transDecl;
    crona::VarDeclNode *                  transVarDecl;
@@ -93,6 +103,7 @@
 %token	<transToken>     HAVOC
 %token	<transIDToken>   ID
 %token	<transToken>     IF
+%token	<transToken>     IMPORT
 %token	<transToken>     INT
 %token	<transIntToken>  INTLITERAL
 %token	<transToken>     GREATER
@@ -121,6 +132,8 @@
 %token	<transToken>     WRITE
 
 %type <transProgram>    program
+%type <transImports>    imports
+%type <transImport>     import
 %type <transDeclList>   globals
 %type <transDecl>       decl
 %type <transVarDecl>    varDecl
@@ -153,21 +166,54 @@
 
 %%
 
-program 	: globals
+program 	: imports globals
 		  {
-		  $$ = new ProgramNode($1);
+		  $$ = new ProgramNode($1, $2);
 		  *root = $$;
 		  }
 
+imports 	: imports import
+		  {
+		  $$ = $1;
+		  if (sink == nullptr){
+			$$->push_back($2);
+		  } else {
+			sink->take($2);
+		  }
+		  }
+		| /* epsilon */
+		  {
+		  $$ = new std::list<ImportNode *>();
+		  }
+
+import 		: IMPORT STRLITERAL SEMICOLON
+		  {
+		  //The module is named without the quotes
+		  std::string quoted = $2->str();
+		  $$ = new ImportNode($1->line(), $1->col(), 
+		    quoted.substr(1, quoted.size() - 2));
+		  }
+
 globals 	: globals decl 
 	  	  { 
 	  	  $$ = $1; 
 	  	  DeclNode * declNode = $2;
-		  $$->push_back(declNode);
+		  if (sink == nullptr){
+			$$->push_back(declNode);
+		  } else {
+			//Hand each declaration off as soon as it is
+			// complete, rather than keeping the program
+			sink->take(declNode);
+		  }
+		  //Whether or not the declaration is kept, its nodes
+		  // have copied what they need from its tokens
+		  scanner.releaseTokens();
+		  declStartNodes = TimeReport::counts().nodes;
 	  	  }
 		| /* epsilon */
 		  {
 		  $$ = new std::list<DeclNode * >();
+		  declStartNodes = TimeReport::counts().nodes;
 		  }
 
 decl 		: varDecl SEMICOLON
@@ -223,6 +269,7 @@ fnDecl 		: id COLON type formals fnBody
 		  {
 		  $$ = new FnDeclNode($1->line(), $1->col(), 
 		    $1, $3, $4, $5);
+		  $$->setSize(TimeReport::counts().nodes - declStartNodes);
 		  }
 
 formals 	: LPAREN RPAREN
@@ -442,6 +489,9 @@ id		: ID
 %%
 
 void crona::Parser::error(const std::string& msg){
-	std::cout << msg << std::endl;
-	std::cerr << "syntax error" << std::endl;
+	Report::out() << msg << std::endl;
+	//Placed where the scanner stopped, which is just past
+	// the token the parser could not accept
+	Report::record(DiagnosticEngine::PLAIN, 
+		scanner.getLine(), scanner.getCol(), "syntax error");
 }
@@ -0,0 +1,204 @@
+#include <cstring>
+#ifdef CRONA_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CRONA_ZSTD
+#include <zstd.h>
+#endif
+#include "errors.hpp"
+#include "decompress.hpp"
+
+namespace crona{
+
+// One compressed format. Each step decodes what it can of the
+// given input into the given output, and says how much of each
+// it used and whether it reached the end of a compressed member.
+class DecompressBuf::Decoder{
+public:
+	virtual ~Decoder(){ }
+	virtual bool step(const char * src, size_t srcLen, size_t& used,
+		char * dst, size_t dstLen, size_t& made, bool& ended) = 0;
+	//Get ready for another member following the last one
+	virtual void restart() = 0;
+	virtual std::string error() = 0;
+};
+
+#ifdef CRONA_ZLIB
+class GzipDecoder : public DecompressBuf::Decoder{
+public:
+	GzipDecoder(){
+		memset(&zs, 0, sizeof(zs));
+		//A window of 15 bits, and 16 more to expect a gzip header
+		if (inflateInit2(&zs, 15 + 16) != Z_OK){
+			throw new InternalError("Could not start zlib");
+		}
+	}
+	~GzipDecoder(){ inflateEnd(&zs); }
+
+	bool step(const char * src, size_t srcLen, size_t& used,
+		char * dst, size_t dstLen, size_t& made, bool& ended) override{
+		zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(src));
+		zs.avail_in = static_cast<uInt>(srcLen);
+		zs.next_out = reinterpret_cast<Bytef *>(dst);
+		zs.avail_out = static_cast<uInt>(dstLen);
+		int res = inflate(&zs, Z_NO_FLUSH);
+		used = srcLen - zs.avail_in;
+		made = dstLen - zs.avail_out;
+		ended = res == Z_STREAM_END;
+		return res == Z_OK || res == Z_STREAM_END || res == Z_BUF_ERROR;
+	}
+	void restart() override{ inflateReset(&zs); }
+	std::string error() override{
+		return zs.msg != nullptr ? zs.msg : "corrupt gzip data";
+	}
+private:
+	z_stream zs;
+};
+#endif
+
+#ifdef CRONA_ZSTD
+class ZstdDecoder : public DecompressBuf::Decoder{
+public:
+	ZstdDecoder() : lastError(0){
+		ds = ZSTD_createDStream();
+		if (ds == nullptr){
+			throw new InternalError("Could not start zstd");
+		}
+		ZSTD_initDStream(ds);
+	}
+	~ZstdDecoder(){ ZSTD_freeDStream(ds); }
+
+	bool step(const char * src, size_t srcLen, size_t& used,
+		char * dst, size_t dstLen, size_t& made, bool& ended) override{
+		ZSTD_inBuffer input = { src, srcLen, 0 };
+		ZSTD_outBuffer output = { dst, dstLen, 0 };
+		size_t res = ZSTD_decompressStream(ds, &output, &input);
+		used = input.pos;
+		made = output.pos;
+		if (ZSTD_isError(res)){
+			lastError = res;
+			return false;
+		}
+		//Zero means a frame is decoded and fully flushed; the
+		// next one, if any, follows on with no reset
+		ended = res == 0;
+		return true;
+	}
+	void restart() override{ }
+	std::string error() override{ return ZSTD_getErrorName(lastError); }
+private:
+	ZSTD_DStream * ds;
+	size_t lastError;
+};
+#endif
+
+DecompressBuf::Format DecompressBuf::sniff(const char * bytes, size_t len){
+	static const unsigned char gzipMagic[] = { 0x1f, 0x8b };
+	static const unsigned char zstdMagic[] = { 0x28, 0xb5, 0x2f, 0xfd };
+	if (len >= sizeof(gzipMagic)
+	  && memcmp(bytes, gzipMagic, sizeof(gzipMagic)) == 0){
+		return GZIP;
+	}
+	if (len >= sizeof(zstdMagic)
+	  && memcmp(bytes, zstdMagic, sizeof(zstdMagic)) == 0){
+		return ZSTD;
+	}
+	return PLAIN;
+}
+
+DecompressBuf::DecompressBuf(std::streambuf * rawIn)
+: raw(rawIn), format(PLAIN), decoder(nullptr), in(CHUNK_BYTES),
+  inStart(0), inEnd(0), rawDone(false), midMember(false),
+  outputPending(false){
+	//The first chunk is read now, both to find the format and
+	// so that none of it has to be pushed back
+	refillInput();
+	format = sniff(in.data(), inEnd);
+	switch (format){
+	case PLAIN:
+		return;
+	case GZIP:
+#ifdef CRONA_ZLIB
+		decoder = new GzipDecoder();
+#endif
+		break;
+	case ZSTD:
+#ifdef CRONA_ZSTD
+		decoder = new ZstdDecoder();
+#endif
+		break;
+	}
+	if (decoder == nullptr){
+		std::string msg = std::string("Input is ") + formatName(format)
+		  + " compressed, but cronac was built without "
+		  + formatName(format) + " support";
+		throw new InternalError(msg.c_str());
+	}
+	out.resize(CHUNK_BYTES);
+}
+
+DecompressBuf::~DecompressBuf(){
+	delete decoder;
+}
+
+//Read the next chunk of raw bytes. Returns false at the end.
+bool DecompressBuf::refillInput(){
+	inStart = 0;
+	inEnd = 0;
+	if (rawDone){ return false; }
+	while (inEnd < in.size()){
+		std::streamsize got = raw->sgetn(in.data() + inEnd,
+			static_cast<std::streamsize>(in.size() - inEnd));
+		if (got <= 0){
+			rawDone = true;
+			break;
+		}
+		inEnd += static_cast<size_t>(got);
+	}
+	return inEnd > 0;
+}
+
+void DecompressBuf::fail(const std::string& why){
+	std::string msg = std::string("Bad ") + formatName(format)
+	  + " input: " + why;
+	throw new InternalError(msg.c_str());
+}
+
+//Make the next text available to read. Returns false at the end.
+bool DecompressBuf::fill(){
+	if (format == PLAIN){
+		if (inStart == inEnd && !refillInput()){ return false; }
+		setg(in.data() + inStart, in.data() + inStart, in.data() + inEnd);
+		inStart = inEnd;
+		return true;
+	}
+	while (true){
+		if (inStart == inEnd && !outputPending && !refillInput()){
+			if (midMember){ fail("truncated"); }
+			return false;
+		}
+		size_t used = 0;
+		size_t made = 0;
+		bool ended = false;
+		bool ok = decoder->step(in.data() + inStart, inEnd - inStart, used,
+			out.data(), out.size(), made, ended);
+		if (!ok){ fail(decoder->error()); }
+		inStart += used;
+		midMember = !ended && (midMember || used > 0);
+		outputPending = made == out.size();
+		if (ended){ decoder->restart(); }
+		if (made > 0){
+			setg(out.data(), out.data(), out.data() + made);
+			return true;
+		}
+		if (used == 0 && !ended && inStart < inEnd){ fail("no progress"); }
+	}
+}
+
+DecompressBuf::int_type DecompressBuf::underflow(){
+	if (gptr() < egptr()){ return traits_type::to_int_type(*gptr()); }
+	if (!fill()){ return traits_type::eof(); }
+	return traits_type::to_int_type(*gptr());
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef CRONA_DECOMPRESS
+#define CRONA_DECOMPRESS
+
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace crona{
+
+// A stream buffer that decompresses the bytes of another one as
+// they are read, a chunk at a time, so a compressed source can be
+// scanned without a temporary file and without ever holding all
+// of its text. The format is found from the first bytes: gzip or
+// zstd if they carry that format's magic number, and otherwise
+// plain text, which is passed through as it is.
+//
+// gzip needs zlib and zstd needs libzstd; the build enables each
+// one (CRONA_ZLIB, CRONA_ZSTD) when the library is installed. An
+// input in a format that isn't built in, or one that is corrupt,
+// is an InternalError at the point it is read.
+class DecompressBuf : public std::streambuf{
+public:
+	enum Format{ PLAIN, GZIP, ZSTD };
+
+	//The format of a text that starts with the given bytes
+	static Format sniff(const char * bytes, size_t len);
+	//The most bytes sniff needs to see
+	static const size_t MAGIC_BYTES = 4;
+
+	static const char * formatName(Format format){
+		switch (format){
+		case PLAIN: return "plain";
+		case GZIP: return "gzip";
+		case ZSTD: return "zstd";
+		}
+		return "unknown";
+	}
+
+	//Decompress what is read from raw, which must outlive this
+	explicit DecompressBuf(std::streambuf * raw);
+	~DecompressBuf();
+
+	static const size_t CHUNK_BYTES = 1 << 16;
+
+	//One compressed format, defined with the library it uses
+	class Decoder;
+
+protected:
+	int_type underflow() override;
+
+private:
+	bool fill();
+	bool refillInput();
+	void fail(const std::string& why);
+
+	std::streambuf * raw;
+	Format format;
+	Decoder * decoder;
+	std::vector<char> in;
+	std::vector<char> out;
+	//The unread part of in
+	size_t inStart;
+	size_t inEnd;
+	bool rawDone;
+	//Whether a compressed member has been started but not ended
+	bool midMember;
+	//Whether the decoder may have more output before it needs
+	// more input
+	bool outputPending;
+};
+
+}
+
+#endif
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include "out_buffer.hpp"
+#include "diagnostics.hpp"
+
+namespace crona{
+
+static uint32_t narrow(size_t val){
+	return static_cast<uint32_t>(val);
+}
+
+void DiagnosticEngine::record(Kind kind, size_t line, size_t col, 
+	const std::string& msg){
+	auto found = messageIds.find(msg);
+	uint32_t msgId;
+	if (found == messageIds.end()){
+		msgId = narrow(messages.size());
+		messages.push_back(msg);
+		messageIds[msg] = msgId;
+	} else {
+		msgId = found->second;
+	}
+	Diagnostic diag;
+	diag.line = narrow(line);
+	diag.col = narrow(col);
+	diag.msgId = msgId;
+	diag.kind = static_cast<uint32_t>(kind);
+	diags.push_back(diag);
+	if (line > lastLine || (line == lastLine && col > lastCol)){
+		lastLine = line;
+		lastCol = col;
+	}
+}
+
+void DiagnosticEngine::note(const std::string& msg){
+	record(PLAIN, lastLine, lastCol, msg);
+}
+
+static void writeText(OutBuffer& out, DiagnosticEngine::Kind kind,
+	size_t line, size_t col, const std::string& msg){
+	switch (kind){
+	case DiagnosticEngine::FATAL:
+	case DiagnosticEngine::WARNING:
+		out.put(kind == DiagnosticEngine::FATAL ? 
+			"FATAL [" : "*WARNING* [");
+		out.putUInt(line);
+		out.put(',');
+		out.putUInt(col);
+		out.put("]: ");
+		break;
+	case DiagnosticEngine::SCAN_ERROR:
+	case DiagnosticEngine::SCAN_WARNING:
+		out.putUInt(line);
+		out.put(':');
+		out.putUInt(col);
+		out.put(kind == DiagnosticEngine::SCAN_ERROR ? 
+			" ***ERROR*** " : " ***WARNING*** ");
+		break;
+	case DiagnosticEngine::PLAIN:
+		break;
+	}
+	out.put(msg);
+	out.put('\n');
+}
+
+static void writeJSON(OutBuffer& out, DiagnosticEngine::Kind kind,
+	size_t line, size_t col, const std::string& msg){
+	static const char * kindNames[] = {
+		"fatal", "warning", "scan-error", "scan-warning", "error"
+	};
+	out.put("{\"kind\":\"");
+	out.put(kindNames[kind]);
+	out.put("\",\"line\":");
+	out.putUInt(line);
+	out.put(",\"col\":");
+	out.putUInt(col);
+	out.put(",\"message\":");
+	out.putJSONString(msg);
+	out.put("}\n");
+}
+
+void DiagnosticEngine::writeText(std::ostream& out, Kind kind, 
+	size_t line, size_t col, const std::string& msg){
+	OutBuffer buf(&out);
+	crona::writeText(buf, kind, line, col, msg);
+}
+
+void DiagnosticEngine::emit(std::ostream& stream){
+	//Diagnostics at the same position stay in the order they
+	// were recorded
+	std::stable_sort(diags.begin(), diags.end(), 
+		[](const Diagnostic& a, const Diagnostic& b){
+			if (a.line != b.line){ return a.line < b.line; }
+			return a.col < b.col;
+		});
+
+	OutBuffer out(&stream);
+	size_t errors = 0;
+	size_t suppressed = 0;
+	//Where the diagnostics at the current position begin; a
+	// repeat is looked for among those only
+	size_t atPos = 0;
+	for (size_t k = 0; k < diags.size(); k++){
+		const Diagnostic& diag = diags[k];
+		if (diags[atPos].line != diag.line 
+		  || diags[atPos].col != diag.col){
+			atPos = k;
+		}
+		bool repeat = false;
+		for (size_t prev = atPos; prev < k && !repeat; prev++){
+			repeat = diags[prev].msgId == diag.msgId 
+			  && diags[prev].kind == diag.kind;
+		}
+		if (repeat){ continue; }
+		if (maxErrors > 0 && errors >= maxErrors){
+			suppressed++;
+			continue;
+		}
+		Kind kind = static_cast<Kind>(diag.kind);
+		if (isError(kind)){ errors++; }
+		if (format == JSON){
+			writeJSON(out, kind, diag.line, diag.col, 
+				messages[diag.msgId]);
+		} else {
+			crona::writeText(out, kind, diag.line, diag.col, 
+				messages[diag.msgId]);
+		}
+	}
+	if (suppressed > 0){
+		std::string note = "Too many errors; " 
+		  + std::to_string(suppressed) + " more diagnostics not shown";
+		if (format == JSON){
+			writeJSON(out, PLAIN, 0, 0, note);
+		} else {
+			out.put(note);
+			out.put('\n');
+		}
+	}
+	out.flush();
+	stream.flush();
+	diags.clear();
+	lastLine = 0;
+	lastCol = 0;
+}
+
+}
@@ -0,0 +1,92 @@
+#ifndef CRONA_DIAGNOSTICS
+#define CRONA_DIAGNOSTICS
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace crona{
+
+// Collects the diagnostics of one compilation instead of
+// printing each as it is found. Every diagnostic is kept as a
+// small record holding its kind, its position and the id of
+// its message text, which is stored once however often it
+// recurs. When the compilation is done, emit sorts them by
+// position, keeping those at one position in the order they
+// were recorded, drops exact repeats (as when two stages
+// re-analyze the same source) and writes them out in one pass.
+//
+// Each thread has its own current engine, so compilations
+// running side by side never share one and need no locking.
+class DiagnosticEngine{
+public:
+	enum Kind{
+		FATAL,         // FATAL [l,c]: msg
+		WARNING,       // *WARNING* [l,c]: msg
+		SCAN_ERROR,    // l:c ***ERROR*** msg
+		SCAN_WARNING,  // l:c ***WARNING*** msg
+		PLAIN          // msg, placed by its position
+	};
+	enum Format{ TEXT, JSON };
+
+	//A limit of zero means no limit
+	DiagnosticEngine(size_t maxErrorsIn, Format formatIn)
+	: maxErrors(maxErrorsIn), format(formatIn), lastLine(0), 
+	  lastCol(0){ }
+
+	//The engine of the calling thread, or null if diagnostics
+	// are to be written as they happen
+	static DiagnosticEngine * current(){ return *slot(); }
+	//Make engine the calling thread's engine, and return the
+	// one it replaces
+	static DiagnosticEngine * install(DiagnosticEngine * engine){
+		DiagnosticEngine * prev = *slot();
+		*slot() = engine;
+		return prev;
+	}
+
+	void record(Kind kind, size_t line, size_t col, 
+		const std::string& msg);
+	//Record a PLAIN message placed at the furthest position
+	// recorded so far, so that it is written after them all
+	void note(const std::string& msg);
+
+	//Write every diagnostic recorded so far to out, in order
+	// of position, and forget them
+	void emit(std::ostream& out);
+
+	static bool isError(Kind kind){
+		return kind == FATAL || kind == SCAN_ERROR || kind == PLAIN;
+	}
+	//Write one diagnostic in the text format
+	static void writeText(std::ostream& out, Kind kind, 
+		size_t line, size_t col, const std::string& msg);
+
+private:
+	class Diagnostic{
+	public:
+		uint32_t line;
+		uint32_t col;
+		uint32_t msgId;
+		uint32_t kind;
+	};
+	static DiagnosticEngine ** slot(){
+		static thread_local DiagnosticEngine * engine = nullptr;
+		return &engine;
+	}
+
+	std::vector<Diagnostic> diags;
+	std::vector<std::string> messages;
+	std::unordered_map<std::string, uint32_t> messageIds;
+	size_t maxErrors;
+	Format format;
+	//The furthest position recorded so far
+	size_t lastLine;
+	size_t lastCol;
+};
+
+}
+
+#endif
@@ -7,6 +7,8 @@
 #define TODO(x) throw new ToDoError(CODELOC #x);
 
 #include <iostream>
+#include "diagnostics.hpp"
+#include "probes.hpp"
 
 namespace crona{
 
@@ -28,13 +30,41 @@ private:
 
 class Report{
 public:
+	//Diagnostics are written to the error stream, and status
+	// messages to the output stream, of the current thread.
+	// These are std::cerr and std::cout unless redirected, which
+	// lets compilations running side by side each capture
+	// their own.
+	static std::ostream& err(){ return *errTarget(nullptr); }
+	static std::ostream& out(){ return *outTarget(nullptr); }
+	static void redirect(std::ostream * errIn, std::ostream * outIn){
+		errTarget(errIn);
+		outTarget(outIn);
+	}
+
+	//Diagnostics go to the calling thread's diagnostic
+	// engine if it has one, and are written out at once if not
+	static void record(
+		DiagnosticEngine::Kind kind,
+		size_t l,
+		size_t c,
+		const std::string& msg
+	){
+		DiagnosticEngine * engine = DiagnosticEngine::current();
+		if (engine != nullptr){
+			engine->record(kind, l, c, msg);
+		} else {
+			DiagnosticEngine::writeText(err(), kind, l, c, msg);
+		}
+	}
+
 	static void fatal(
 		size_t l, 
 		size_t c, 
 		const char * msg
 	){
-		std::cerr << "FATAL [" << l << "," << c << "]: " 
-		<< msg  << std::endl;
+		CRONA_PROBE3(diagnostic, l, c, msg);
+		record(DiagnosticEngine::FATAL, l, c, msg);
 	}
 
 	static void fatal(
@@ -50,8 +80,7 @@ public:
 		size_t c,
 		const char * msg
 	){
-		std::cerr << "*WARNING* [" << l << "," << c << "]: " 
-		<< msg  << std::endl;
+		record(DiagnosticEngine::WARNING, l, c, msg);
 	}
 
 	static void warn(
@@ -61,6 +90,30 @@ public:
 	){
 		warn(l,c,msg.c_str());
 	}
+
+	//A message about the run rather than a place in the source
+	// ("Parse failed"). With an engine it is kept as a plain
+	// diagnostic after everything recorded before it, so it is
+	// written out in the same order as without one.
+	static void note(const std::string& msg){
+		DiagnosticEngine * engine = DiagnosticEngine::current();
+		if (engine != nullptr){
+			engine->note(msg);
+		} else {
+			err() << msg << "\n";
+		}
+	}
+private:
+	static std::ostream * errTarget(std::ostream * newTarget){
+		static thread_local std::ostream * target = &std::cerr;
+		if (newTarget != nullptr){ target = newTarget; }
+		return target;
+	}
+	static std::ostream * outTarget(std::ostream * newTarget){
+		static thread_local std::ostream * target = &std::cout;
+		if (newTarget != nullptr){ target = newTarget; }
+		return target;
+	}
 };
 
 }
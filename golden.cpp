@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include "errors.hpp"
+#include "work_pool.hpp"
+#include "golden.hpp"
+
+namespace crona{
+
+static const std::string SOURCE_SUFFIX = ".crona";
+static const std::string EXPECTED_SUFFIX = ".err.expected";
+
+class TestResult{
+public:
+	TestResult() : hasExpected(false){ }
+	std::string err;
+	std::string expected;
+	bool hasExpected;
+};
+
+static bool readWhole(const std::string& path, std::string& text){
+	std::ifstream in(path, std::ios::binary);
+	if (!in.good()){ return false; }
+	std::ostringstream bytes;
+	bytes << in.rdbuf();
+	text = bytes.str();
+	return true;
+}
+
+bool GoldenRunner::listTests(const char * dir,
+	std::vector<std::string>& names){
+	DIR * listing = opendir(dir);
+	if (listing == nullptr){ return false; }
+	while (dirent * entry = readdir(listing)){
+		std::string name = entry->d_name;
+		if (name.size() <= SOURCE_SUFFIX.size()){ continue; }
+		size_t stem = name.size() - SOURCE_SUFFIX.size();
+		if (name.compare(stem, SOURCE_SUFFIX.size(), SOURCE_SUFFIX) == 0){
+			names.push_back(name.substr(0, stem));
+		}
+	}
+	closedir(listing);
+	std::sort(names.begin(), names.end());
+	return true;
+}
+
+int GoldenRunner::run(const char * dir, size_t workers,
+	std::ostream& out){
+	std::vector<std::string> names;
+	if (!listTests(dir, names)){
+		out << "Bad test directory " << dir << "\n";
+		return -1;
+	}
+	std::string prefix = std::string(dir) + "/";
+
+	std::vector<TestResult> results(names.size());
+	WorkPool pool(workers);
+	for (size_t k = 0; k < names.size(); k++){
+		pool.add([this, &names, &results, &prefix, k](){
+			TestResult& result = results[k];
+			std::string base = prefix + names[k];
+			result.hasExpected =
+				readWhole(base + EXPECTED_SUFFIX, result.expected);
+			std::ostringstream err;
+			std::ostringstream discarded;
+			Report::redirect(&err, &discarded);
+			std::string source = base + SOURCE_SUFFIX;
+			check(source.c_str());
+			Report::redirect(&std::cerr, &std::cout);
+			result.err = err.str();
+		});
+	}
+	pool.run();
+
+	int failed = 0;
+	for (size_t k = 0; k < names.size(); k++){
+		TestResult& result = results[k];
+		if (result.hasExpected && result.err == result.expected){
+			continue;
+		}
+		failed++;
+		out << "FAIL " << names[k] << SOURCE_SUFFIX << "\n";
+		if (!result.hasExpected){
+			out << "missing " << names[k] << EXPECTED_SUFFIX << "\n";
+			continue;
+		}
+		out << unifiedDiff(result.err, result.expected,
+			names[k] + ".err", names[k] + EXPECTED_SUFFIX);
+	}
+	size_t passed = names.size() - static_cast<size_t>(failed);
+	out << names.size() << " tests, " << passed << " passed, "
+	  << failed << " failed\n";
+	return failed;
+}
+
+//A text as lines, each without its newline. The last line
+// is marked if the text doesn't end in one.
+class Lines{
+public:
+	Lines(const std::string& text) : lastHasNewline(true){
+		size_t start = 0;
+		while (start < text.size()){
+			size_t end = text.find('\n', start);
+			if (end == std::string::npos){
+				lines.push_back(text.substr(start));
+				lastHasNewline = false;
+				break;
+			}
+			lines.push_back(text.substr(start, end - start));
+			start = end + 1;
+		}
+	}
+	std::vector<std::string> lines;
+	bool lastHasNewline;
+};
+
+//One line of an edit script: kept (' '), removed ('-') or added
+// ('+'), with the positions in each text at that point
+class Edit{
+public:
+	Edit(char kindIn, size_t fromPosIn, size_t toPosIn)
+	: kind(kindIn), fromPos(fromPosIn), toPos(toPosIn){ }
+	char kind;
+	size_t fromPos;
+	size_t toPos;
+};
+
+//Lines are the same if their text is, and either both or
+// neither end in a newline
+static bool sameLine(const Lines& from, size_t i, const Lines& to,
+	size_t j){
+	bool fromEnds = i + 1 < from.lines.size() || from.lastHasNewline;
+	bool toEnds = j + 1 < to.lines.size() || to.lastHasNewline;
+	return fromEnds == toEnds && from.lines[i] == to.lines[j];
+}
+
+//A shortest edit script from a longest common subsequence. The
+// table is quadratic, so texts too large for it are treated as
+// having nothing in common.
+static std::vector<Edit> editScript(const Lines& from, const Lines& to){
+	size_t n = from.lines.size();
+	size_t m = to.lines.size();
+	std::vector<Edit> script;
+	const size_t MAX_CELLS = 1 << 24;
+	if ((n + 1) * (m + 1) > MAX_CELLS){
+		for (size_t i = 0; i < n; i++){ script.push_back(Edit('-', i, 0)); }
+		for (size_t j = 0; j < m; j++){ script.push_back(Edit('+', n, j)); }
+		return script;
+	}
+	//common[i][j] is the length of the longest common
+	// subsequence of the lines from i and to j on
+	std::vector<std::vector<size_t>> common(n + 1,
+		std::vector<size_t>(m + 1, 0));
+	for (size_t i = n; i-- > 0;){
+		for (size_t j = m; j-- > 0;){
+			if (sameLine(from, i, to, j)){
+				common[i][j] = common[i + 1][j + 1] + 1;
+			} else {
+				common[i][j] = std::max(common[i + 1][j], common[i][j + 1]);
+			}
+		}
+	}
+	size_t i = 0;
+	size_t j = 0;
+	while (i < n || j < m){
+		if (i < n && j < m && sameLine(from, i, to, j)){
+			script.push_back(Edit(' ', i++, j++));
+		} else if (j == m || (i < n && common[i + 1][j] >= common[i][j + 1])){
+			script.push_back(Edit('-', i++, j));
+		} else {
+			script.push_back(Edit('+', i, j++));
+		}
+	}
+	return script;
+}
+
+static void putRange(std::ostream& out, size_t start, size_t count){
+	//An empty range is given by the line before it
+	out << (count == 0 ? start : start + 1);
+	if (count != 1){ out << "," << count; }
+}
+
+static void putLine(std::ostream& out, char kind, const Lines& text,
+	size_t pos){
+	out << kind << text.lines[pos] << "\n";
+	if (pos + 1 == text.lines.size() && !text.lastHasNewline){
+		out << "\\ No newline at end of file\n";
+	}
+}
+
+std::string GoldenRunner::unifiedDiff(const std::string& fromText,
+	const std::string& toText, const std::string& fromName,
+	const std::string& toName){
+	if (fromText == toText){ return ""; }
+	Lines from(fromText);
+	Lines to(toText);
+	std::vector<Edit> script = editScript(from, to);
+
+	std::ostringstream out;
+	out << "--- " << fromName << "\n";
+	out << "+++ " << toName << "\n";
+	size_t at = 0;
+	while (at < script.size()){
+		if (script[at].kind == ' '){
+			at++;
+			continue;
+		}
+		//A hunk runs from CONTEXT lines before this change to
+		// CONTEXT lines after the last change that is no more
+		// than 2 * CONTEXT kept lines from the one before it
+		size_t start = at > CONTEXT ? at - CONTEXT : 0;
+		size_t end = at;
+		size_t kept = 0;
+		for (size_t k = at; k < script.size(); k++){
+			if (script[k].kind != ' '){
+				end = k + 1;
+				kept = 0;
+			} else if (++kept > 2 * CONTEXT){
+				break;
+			}
+		}
+		size_t stop = std::min(script.size(), end + CONTEXT);
+
+		size_t fromCount = 0;
+		size_t toCount = 0;
+		for (size_t k = start; k < stop; k++){
+			if (script[k].kind != '+'){ fromCount++; }
+			if (script[k].kind != '-'){ toCount++; }
+		}
+		out << "@@ -";
+		putRange(out, script[start].fromPos, fromCount);
+		out << " +";
+		putRange(out, script[start].toPos, toCount);
+		out << " @@\n";
+		for (size_t k = start; k < stop; k++){
+			const Edit& edit = script[k];
+			if (edit.kind == '+'){
+				putLine(out, '+', to, edit.toPos);
+			} else {
+				putLine(out, edit.kind, from, edit.fromPos);
+			}
+		}
+		at = stop;
+	}
+	return out.str();
+}
+
+}
@@ -0,0 +1,54 @@
+#ifndef CRONA_GOLDEN
+#define CRONA_GOLDEN
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace crona{
+
+// Runs a directory of golden tests in this process. Each test is
+// a file <name>.crona, checked as by "cronac <name>.crona -c",
+// whose stderr must match <name>.err.expected byte for byte. That
+// is what p5_tests/Makefile does with a fresh cronac and diff per
+// test, so a test passes here exactly when it passes there: the
+// exit status and stdout are ignored, and a test with no expected
+// file fails.
+//
+// Tests are checked in parallel, each capturing its diagnostics
+// in memory. Only failures are reported, each with a unified diff
+// of what was written against what was expected, followed by a
+// one-line summary.
+class GoldenRunner{
+public:
+	//Check the source at path, writing diagnostics to the
+	// current thread's report streams
+	typedef std::function<int(const char * path)> Check;
+
+	GoldenRunner(Check checkIn) : check(checkIn){ }
+
+	//Run every test in dir with the given number of workers,
+	// reporting to out. Returns the number of tests that failed,
+	// or -1 if dir can't be read.
+	int run(const char * dir, size_t workers, std::ostream& out);
+
+	//The differences between two texts, as diff -u would give
+	// them, or the empty string if they are the same
+	static std::string unifiedDiff(const std::string& from,
+		const std::string& to, const std::string& fromName,
+		const std::string& toName);
+
+	//Lines of context around each change
+	static const size_t CONTEXT = 3;
+
+private:
+	static bool listTests(const char * dir,
+		std::vector<std::string>& names);
+
+	Check check;
+};
+
+}
+
+#endif
@@ -0,0 +1,237 @@
+#include "ast.hpp"
+#include "symbol_table.hpp"
+#include "errors.hpp"
+#include "types.hpp"
+#include "type_analysis.hpp"
+#include "layout.hpp"
+
+namespace crona{
+
+Layout * Layout::build(TypeAnalysis * typeAnalysis, 
+	const DataLayout * target){
+	//Sizes are only meaningful for a well-typed program, so
+	// a successful type analysis must be supplied
+	TimeReport::PhaseTimer timer("layout");
+	Layout * layout = new Layout(target);
+	auto ast = typeAnalysis->ast;
+	layout->ast = ast;
+
+	ast->layout(layout);
+	return layout;
+}
+
+void Layout::allocGlobal(VarDeclNode * decl){
+	VarSymbol * sym = decl->ID()->getSymbol()->asVar();
+	const DataType * type = sym->getDataType();
+	size_t offset = alignUp(globalsSize, type->alignIn(myTarget));
+	sym->setLocation(GLOBAL, offset);
+	globalsSize = offset + type->sizeIn(myTarget);
+	globals.push_back(decl);
+}
+
+void Layout::allocLocal(VarDeclNode * decl){
+	VarSymbol * sym = decl->ID()->getSymbol()->asVar();
+	const DataType * type = sym->getDataType();
+	size_t offset = alignUp(frameOffset, type->alignIn(myTarget));
+	sym->setLocation(FRAME, offset);
+	frameOffset = offset + type->sizeIn(myTarget);
+	if (frameOffset > frameHighWater){
+		frameHighWater = frameOffset;
+	}
+	currentFrame->slots.push_back(decl);
+}
+
+void Layout::enterFn(FnSymbol * fn){
+	currentFrame = new FrameInfo(fn);
+	frames.push_back(currentFrame);
+	frameOffset = 0;
+	frameHighWater = 0;
+}
+
+void Layout::leaveFn(){
+	currentFrame->size = alignUp(frameHighWater, myTarget->frameAlign());
+	currentFrame->fn->setFrameSize(currentFrame->size);
+	currentFrame = nullptr;
+}
+
+static void reportSlot(std::ostream& out, VarDeclNode * decl){
+	VarSymbol * sym = decl->ID()->getSymbol()->asVar();
+	out << "\t" << sym->getName()
+	  << "\t" << (sym->getStorage() == GLOBAL ? "global" : "frame")
+	  << "+" << sym->getOffset()
+	  << "\t" << sym->getDataType()->getString()
+	  << "\n";
+}
+
+size_t Layout::totalSize(){
+	size_t total = globalsSize;
+	for (auto frame : frames){
+		total += frame->size;
+	}
+	return total;
+}
+
+void Layout::report(std::ostream& out, Layout * compareTo){
+	out << "target: " << myTarget->getName() << "\n";
+	out << "globals: " << globalsSize << " bytes\n";
+	for (auto decl : globals){
+		reportSlot(out, decl);
+	}
+	for (auto frame : frames){
+		out << frame->fn->getName() << ": frame "
+		  << frame->size << " bytes\n";
+		for (auto decl : frame->slots){
+			reportSlot(out, decl);
+		}
+	}
+	size_t total = totalSize();
+	out << "total: " << total << " bytes";
+	if (compareTo != nullptr){
+		size_t other = compareTo->totalSize();
+		out << " (" << compareTo->myTarget->getName() 
+		  << ": " << other << " bytes, saved ";
+		if (other >= total){
+			out << other - total;
+		} else {
+			out << "-" << total - other;
+		}
+		out << ")";
+	}
+	out << "\n";
+}
+
+void ProgramNode::layout(Layout * layout){
+	for (auto global : *myGlobals){
+		global->layout(layout);
+	}
+}
+
+void VarDeclNode::layout(Layout * layout){
+	if (layout->inFunction()){
+		layout->allocLocal(this);
+	} else {
+		layout->allocGlobal(this);
+	}
+	myID->layout(layout);
+}
+
+void FnDeclNode::layout(Layout * layout){
+	FnSymbol * sym = myID->getSymbol()->asFn();
+	layout->enterFn(sym);
+	//Formals are placed first, in order, at the base
+	// of the frame
+	for (auto formal : *myFormals){
+		formal->layout(layout);
+	}
+	for (auto stmt : *myBody){
+		stmt->layout(layout);
+	}
+	layout->leaveFn();
+}
+
+void StmtNode::layout(Layout * layout){
+	TODO("Override me in the subclass");
+}
+
+void AssignStmtNode::layout(Layout * layout){
+	myExp->layout(layout);
+}
+
+void ReadStmtNode::layout(Layout * layout){
+	myDst->layout(layout);
+}
+
+void WriteStmtNode::layout(Layout * layout){
+	mySrc->layout(layout);
+}
+
+void PostDecStmtNode::layout(Layout * layout){
+	myLVal->layout(layout);
+}
+
+void PostIncStmtNode::layout(Layout * layout){
+	myLVal->layout(layout);
+}
+
+void IfStmtNode::layout(Layout * layout){
+	myCond->layout(layout);
+	size_t mark = layout->enterBlock();
+	for (auto stmt : *myBody){
+		stmt->layout(layout);
+	}
+	layout->leaveBlock(mark);
+}
+
+void IfElseStmtNode::layout(Layout * layout){
+	myCond->layout(layout);
+	//Both arms start at the same offset, so the
+	// false arm reuses the slots of the true arm
+	size_t mark = layout->enterBlock();
+	for (auto stmt : *myBodyTrue){
+		stmt->layout(layout);
+	}
+	layout->leaveBlock(mark);
+	mark = layout->enterBlock();
+	for (auto stmt : *myBodyFalse){
+		stmt->layout(layout);
+	}
+	layout->leaveBlock(mark);
+}
+
+void WhileStmtNode::layout(Layout * layout){
+	myCond->layout(layout);
+	size_t mark = layout->enterBlock();
+	for (auto stmt : *myBody){
+		stmt->layout(layout);
+	}
+	layout->leaveBlock(mark);
+}
+
+void ReturnStmtNode::layout(Layout * layout){
+	if (myExp != nullptr){
+		myExp->layout(layout);
+	}
+}
+
+void CallStmtNode::layout(Layout * layout){
+	myCallExp->layout(layout);
+}
+
+void ExpNode::layout(Layout * layout){
+	//Literals refer to no storage, so there is
+	// nothing to do by default
+}
+
+void IDNode::layout(Layout * layout){
+	VarSymbol * sym = mySymbol->asVar();
+	if (sym == nullptr){ return; }
+	attachLocation(sym->getStorage(), sym->getOffset());
+}
+
+void IndexNode::layout(Layout * layout){
+	myBase->layout(layout);
+	myOffset->layout(layout);
+}
+
+void CallExpNode::layout(Layout * layout){
+	myID->layout(layout);
+	for (auto arg : *myArgs){
+		arg->layout(layout);
+	}
+}
+
+void BinaryExpNode::layout(Layout * layout){
+	myExp1->layout(layout);
+	myExp2->layout(layout);
+}
+
+void UnaryExpNode::layout(Layout * layout){
+	myExp->layout(layout);
+}
+
+void AssignExpNode::layout(Layout * layout){
+	myDst->layout(layout);
+	mySrc->layout(layout);
+}
+
+}
@@ -0,0 +1,101 @@
+#ifndef CRONA_LAYOUT
+#define CRONA_LAYOUT
+
+#include <ostream>
+#include <list>
+#include "ast.hpp"
+#include "symbol_table.hpp"
+#include "types.hpp"
+
+namespace crona{
+
+class TypeAnalysis;
+
+// The layout pass gives every variable a storage location.
+// Globals are placed, in declaration order, at aligned offsets
+// of a single packed data segment. Formals and locals are
+// placed at aligned offsets from the base of their function's
+// frame. Locals of sibling blocks (the two arms of an if/else,
+// or a block following an earlier one) are never live at the
+// same time, so they are allowed to share slots: the frame
+// only needs to be as large as the deepest chain of nested
+// blocks. Once a symbol has a location, every IDNode that
+// refers to it is annotated with that same location. All sizes
+// and alignments are those of the given target.
+class Layout {
+
+private:
+	Layout(const DataLayout * targetIn) : myTarget(targetIn){
+		globalsSize = 0;
+		frameOffset = 0;
+		frameHighWater = 0;
+		currentFrame = nullptr;
+	}
+
+public:
+	static Layout * build(TypeAnalysis * typeAnalysis,
+		const DataLayout * target);
+
+	static size_t alignUp(size_t offset, size_t align){
+		if (align <= 1){ return offset; }
+		return (offset + align - 1) / align * align;
+	}
+
+	bool inFunction(){ return currentFrame != nullptr; }
+
+	//Give a global variable the next aligned slot in the
+	// global data segment
+	void allocGlobal(VarDeclNode * decl);
+
+	//Give a formal or local the next aligned slot in the
+	// frame of the current function
+	void allocLocal(VarDeclNode * decl);
+
+	void enterFn(FnSymbol * fn);
+	void leaveFn();
+
+	//Blocks are handled by saving the frame offset on entry
+	// and restoring it on exit, so that whatever the next
+	// block declares is placed over the slots of this one.
+	size_t enterBlock(){ return frameOffset; }
+	void leaveBlock(size_t mark){ frameOffset = mark; }
+
+	size_t getGlobalsSize(){ return globalsSize; }
+
+	//The size of the data segment plus the sizes of
+	// all frames
+	size_t totalSize();
+
+	//Write the data segment and the per-function frame
+	// sizes and slots to out. If a layout of the same program
+	// for another target is given, also report how much memory
+	// this target saves over it.
+	void report(std::ostream& out, Layout * compareTo);
+
+	class FrameInfo{
+	public:
+		FrameInfo(FnSymbol * fnIn) : fn(fnIn), size(0){ }
+		FnSymbol * fn;
+		size_t size;
+		//The formals and locals placed in this frame
+		std::list<VarDeclNode *> slots;
+	};
+
+	const std::list<FrameInfo *> * getFrames(){ return &frames; }
+	const DataLayout * getTarget(){ return myTarget; }
+
+	ProgramNode * ast;
+
+private:
+	const DataLayout * myTarget;
+	std::list<VarDeclNode *> globals;
+	std::list<FrameInfo *> frames;
+	FrameInfo * currentFrame;
+	size_t globalsSize;
+	size_t frameOffset;
+	size_t frameHighWater;
+};
+
+}
+
+#endif
@@ -2,26 +2,107 @@
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "errors.hpp"
 #include "scanner.hpp"
 #include "name_analysis.hpp"
 #include "type_analysis.hpp"
+#include "layout.hpp"
+#include "call_graph.hpp"
+#include "stack_analysis.hpp"
+#include "xref.hpp"
+#include "work_pool.hpp"
+#include "server.hpp"
+#include "result_cache.hpp"
+#include "stream.hpp"
+#include "module.hpp"
+#include "bulk_io.hpp"
+#include "golden.hpp"
+#include "probes.hpp"
 
 using namespace crona;
 
 static void usageAndDie(){
-	std::cerr << "Usage: cronac <infile>\n"
+	std::cerr << "Usage: cronac <infile>"
+	<< " (which may be gzip or zstd compressed)\n"
 	<< " [-c]: Do type checking\n"
 	<< " [-n <nameFile>]: Perform name analysis\n"
 	<< " [-u <unparseFile>]: Output canonical program form\n"
 	<< " [-p]: Parse the input to check syntax\n"
 	<< " [-t <tokensFile>]: Output tokens to <tokensFile>\n"
+	<< " [--layout <layoutFile>]: Output storage layout and frame sizes\n"
+	<< " [--target <name>]: Lay out data for target <name>: "
+	<< DataLayout::knownTargets() << "\n"
+	<< " [--callgraph <graphFile>]: Output the call graph\n"
+	<< " [--prune <entryFn>]: Drop functions and globals not"
+	<< " reachable from <entryFn> before any other stage\n"
+	<< " [--stack <stackFile>]: Output worst-case stack use as JSON,"
+	<< " from the --prune entry or main\n"
+	<< " [--index <indexFile>]: Output a cross-reference index\n"
+	<< " [--batch]: Allow many input files, and response files"
+	<< " @<listFile> naming one input per line, compiled in parallel\n"
+	<< " [--jobs <n>]: Use <n> threads for --batch, or alone for"
+	<< " rendering -u and -n output (by default, only for large"
+	<< " programs)\n"
+	<< " [--io ring|thread|sync]: Read --batch inputs ahead and write"
+	<< " outputs through io_uring (default, where available), a"
+	<< " background thread, or not at all\n"
+	<< " [--cache <dir>]: Reuse -p, -c, -u and -n results for unchanged"
+	<< " sources from the cache in <dir>\n"
+	<< " [--cache-size <MB>]: Bound the cache to <MB> megabytes"
+	<< " (default 64)\n"
+	<< " [--cache-stats]: Report cache hits and misses\n"
+	<< " [--stream]: Check and output -p, -c, -u and -n one declaration"
+	<< " at a time, in bounded memory. <infile> may be - for stdin\n"
+	<< " [--max-errors <n>]: Stop reporting after <n> errors\n"
+	<< " [--time-report]: Write the time, memory and counts of"
+	<< " tokens, nodes, symbols, scopes and types of each phase"
+	<< " to stderr\n"
+	<< " [--time-report=<jsonFile>]: Write the same to <jsonFile>,"
+	<< " one JSON object per input\n"
+	<< " [--perf-counters]: Add cycles, instructions, cache misses"
+	<< " and branch misses of each phase to the time report, where"
+	<< " the hardware and the kernel allow\n"
+	<< " [--stats]: Write the shape of the data each file builds:"
+	<< " AST nodes by class, nesting depths, scope lookups, hash"
+	<< " map loads, type flyweight scans and duplicate function"
+	<< " types\n"
+	<< " [--alloc-stats]: At exit, write how many allocations of"
+	<< " what sizes each phase and subsystem made (built in with"
+	<< " make ALLOC_STATS=1)\n"
+	<< " [--trace=<file>]: Write a Chrome trace of each file, phase"
+	<< " and function to <file>, with a track per thread\n"
+	<< " [--diag-format text|json]: Write diagnostics as text"
+	<< " (default) or as one JSON object per line\n"
+	<< " [--emit-interface]: Write the interface of a checked"
+	<< " <name>.crona to <name>.cri\n"
+	<< " [--import <file.cri>]: Declare the globals of the module"
+	<< " with this interface before those of <infile>, as a"
+	<< " declaration import \"<name>\"; in <infile> does from the"
+	<< " <name>.cri beside it\n"
+	<< "Or: cronac --index-query <indexFile> <name | line:col>\n"
+	<< "Or: cronac --run-tests <dir> [--jobs <n>] [--stream]: Check"
+	<< " each <name>.crona in <dir> as with -c, and compare what it"
+	<< " writes to stderr with <name>.err.expected\n"
+	<< "Or: cronac --server <socket>: Serve compile requests."
+	<< " While CRONAC_SERVER names the socket, cronac sends its"
+	<< " command line to the server instead of running it, unless"
+	<< " it reads standard input (-)\n"
 	;
 	exit(1);
 }
 
+//The bytes of the input this thread is compiling, when a batch
+// has already read them into memory
+static thread_local const std::string * prefetched = nullptr;
+
 static void writeTokenStream(const char * inPath, const char * outPath){
-	std::ifstream inStream(inPath);
+	SourceStream inStream(inPath, prefetched);
 	if (!inStream.good()){
 		std::string msg = "Bad input stream";
 		msg += inPath;
@@ -32,9 +113,15 @@ static void writeTokenStream(const char * inPath, const char * outPath){
 		throw new crona::InternalError(msg.c_str());
 	}
 
+	TimeReport::PhaseTimer timer("scan");
+	CRONA_PROBE1(lex__start, inPath);
 	Scanner scanner(&inStream);
 	if (strcmp(outPath, "--") == 0){
-		scanner.outputTokens(std::cout);
+		scanner.outputTokens(Report::out());
+	} else if (BulkIO::active() != nullptr){
+		std::ostringstream tokens;
+		scanner.outputTokens(tokens);
+		BulkIO::active()->write(outPath, tokens.str());
 	} else {
 		std::ofstream outStream(outPath);
 		if (!outStream.good()){
@@ -45,10 +132,11 @@ static void writeTokenStream(const char * inPath, const char * outPath){
 		scanner.outputTokens(outStream);
 		outStream.close();
 	}
+	CRONA_PROBE1(lex__end, inPath);
 }
 
 static crona::ProgramNode * parse(const char * inFile){
-	std::ifstream inStream(inFile);
+	SourceStream inStream(inFile, prefetched);
 	if (!inStream.good()){
 		std::string msg = "Bad input stream ";
 		msg += inFile;
@@ -59,18 +147,69 @@ static crona::ProgramNode * parse(const char * inFile){
 	// AST after parsing
 	crona::ProgramNode * root = nullptr;
 
+	TimeReport::PhaseTimer timer("parse");
+	CRONA_ALLOC_TAG(PARSER);
 	crona::Scanner scanner(&inStream);
-	crona::Parser parser(scanner, &root);
+	crona::Parser parser(scanner, &root, nullptr);
 
+	CRONA_PROBE1(parse__start, inFile);
+	size_t startNodes = TimeReport::counts().nodes;
 	int errCode = parser.parse();
+	CRONA_PROBE2(parse__end, inFile, errCode == 0);
 	if (errCode != 0){ return nullptr; }
+	root->setSize(TimeReport::counts().nodes - startNodes);
+	for (auto import : *root->getImports()){
+		std::string path = ModuleInterface::pathFor(inFile, 
+			import->getName());
+		import->setModule(ModuleInterface::load(path.c_str()));
+	}
 
+	if (Census * census = Census::current()){
+		census->takeShape(root);
+	}
 	return root;
 }
 
-static void outputAST(ASTNode * ast, const char * outPath){
+//Below this many nodes, starting the render threads and joining
+// their pieces costs more than rendering on one thread
+static const size_t PARALLEL_RENDER_NODES = 1 << 20;
+
+//Render with the given number of workers, or with 0, with as many
+// as the machine has if the tree is large enough to repay them
+static void outputAST(ProgramNode * ast, const char * outPath,
+	size_t workers, bool symbols = true){
+	TimeReport::PhaseTimer timer("output");
+	if (workers == 0){
+		bool large = ast->size() >= PARALLEL_RENDER_NODES;
+		workers = large ? WorkPool::defaultWorkers() : 1;
+	}
+	if (strcmp(outPath, "--") == 0){
+		OutBuffer out(&Report::out());
+		out.showSymbols(symbols);
+		ast->unparseParallel(out, workers);
+	} else if (BulkIO::active() != nullptr){
+		OutBuffer out;
+		out.showSymbols(symbols);
+		ast->unparseParallel(out, workers);
+		BulkIO::active()->write(outPath, out.text());
+	} else {
+		std::ofstream outStream(outPath);
+		if (!outStream.good()){
+			std::string msg = "Bad output file ";
+			msg += outPath;
+			throw new crona::InternalError(msg.c_str());
+		}
+		OutBuffer out(&outStream);
+		out.showSymbols(symbols);
+		ast->unparseParallel(out, workers);
+	}
+}
+
+static void outputLayout(Layout * layout, Layout * reference,
+	const char * outPath){
+	TimeReport::PhaseTimer timer("output");
 	if (strcmp(outPath, "--") == 0){
-		ast->unparse(std::cout, 0);
+		layout->report(Report::out(), reference);
 	} else {
 		std::ofstream outStream(outPath);
 		if (!outStream.good()){
@@ -78,134 +217,1105 @@ static void outputAST(ASTNode * ast, const char * outPath){
 			msg += outPath;
 			throw new crona::InternalError(msg.c_str());
 		}
-		ast->unparse(outStream, 0);
+		layout->report(outStream, reference);
 	}
 }
 
-static crona::NameAnalysis * doNameAnalysis(const char * inputPath){
+static void outputCallGraph(CallGraph * graph, const char * outPath){
+	TimeReport::PhaseTimer timer("output");
+	if (strcmp(outPath, "--") == 0){
+		graph->report(Report::out());
+	} else {
+		std::ofstream outStream(outPath);
+		if (!outStream.good()){
+			std::string msg = "Bad output file ";
+			msg += outPath;
+			throw new crona::InternalError(msg.c_str());
+		}
+		graph->report(outStream);
+	}
+}
+
+static void outputStack(StackAnalysis * stack, const char * entry,
+	const char * outPath){
+	TimeReport::PhaseTimer timer("output");
+	if (strcmp(outPath, "--") == 0){
+		stack->report(Report::out(), entry);
+	} else {
+		std::ofstream outStream(outPath);
+		if (!outStream.good()){
+			std::string msg = "Bad output file ";
+			msg += outPath;
+			throw new crona::InternalError(msg.c_str());
+		}
+		stack->report(outStream, entry);
+	}
+}
+
+static bool writeIndex(const char * inputPath, const char * outPath){
+	crona::ProgramNode * ast = parse(inputPath);
+	if (ast == nullptr){ return false; }
+	crona::XrefBuilder xref;
+	if (crona::NameAnalysis::build(ast, &xref) == nullptr){
+		return false;
+	}
+	TimeReport::PhaseTimer timer("output");
+	if (strcmp(outPath, "--") == 0){
+		xref.write(Report::out());
+	} else {
+		std::ofstream outStream(outPath, std::ios::binary);
+		if (!outStream.good()){
+			std::string msg = "Bad output file ";
+			msg += outPath;
+			throw new crona::InternalError(msg.c_str());
+		}
+		xref.write(outStream);
+	}
+	return true;
+}
+
+static int queryIndex(const char * indexPath, const char * key){
+	crona::XrefIndex * index = crona::XrefIndex::open(indexPath);
+	if (index == nullptr){
+		std::cerr << "Bad index file " << indexPath << std::endl;
+		return 1;
+	}
+	bool wellFormed = index->query(key, std::cout);
+	delete index;
+	if (!wellFormed){
+		std::cerr << "Bad position " << key 
+		  << ": expected <line>:<col>" << std::endl;
+		usageAndDie();
+	}
+	return 0;
+}
+
+static void pruneProgram(crona::CallGraph * graph, 
+	crona::ProgramNode * program, const char * entry){
+	if (!graph->markLive(entry)){
+		Report::note(std::string("No function ") + entry 
+		  + " to prune from; nothing pruned");
+		return;
+	}
+	graph->prune(program);
+}
+
+static crona::CallGraph * doCallGraph(const char * inputPath){
+	crona::ProgramNode * ast = parse(inputPath);
+	if (ast == nullptr){ return nullptr; }
+	crona::NameAnalysis * na = crona::NameAnalysis::build(ast);
+	if (na == nullptr){ return nullptr; }
+	return crona::CallGraph::build(na);
+}
+
+static crona::NameAnalysis * doNameAnalysis(const char * inputPath,
+	const char * pruneEntry){
 	crona::ProgramNode * ast = parse(inputPath);
 	if (ast == nullptr){ return nullptr; }
 	
-	return crona::NameAnalysis::build(ast);
+	crona::NameAnalysis * na = crona::NameAnalysis::build(ast);
+	if (na != nullptr && pruneEntry != nullptr){
+		crona::CallGraph * graph = crona::CallGraph::build(na);
+		pruneProgram(graph, na->ast, pruneEntry);
+	}
+	return na;
 }
 
-static bool doUnparsing(const char * inputPath, const char * outPath){
+static bool doUnparsing(const char * inputPath, const char * outPath,
+	const char * pruneEntry, size_t workers){
 	crona::ProgramNode * ast = parse(inputPath);
 	if (ast == nullptr){ 
-		std::cerr << "No AST built\n";
+		Report::note("No AST built");
 		return false;
 	}
 
-	outputAST(ast, outPath);
+	if (pruneEntry != nullptr){
+		//The call graph needs the names resolved. Name analysis
+		// annotates the IDs it resolves, so the tree is then
+		// unparsed without those annotations.
+		crona::NameAnalysis * na = crona::NameAnalysis::build(ast);
+		if (na == nullptr){
+			Report::note("No call graph built");
+			return false;
+		}
+		pruneProgram(crona::CallGraph::build(na), ast, pruneEntry);
+		outputAST(ast, outPath, workers, false);
+		return true;
+	}
+
+	outputAST(ast, outPath, workers);
 	return true;
 }
 
-static crona::TypeAnalysis * doTypeAnalysis(const char * inputPath){
-	crona::NameAnalysis * nameAnalysis = doNameAnalysis(inputPath);
+static crona::TypeAnalysis * doTypeAnalysis(const char * inputPath,
+	const char * pruneEntry){
+	crona::NameAnalysis * nameAnalysis = 
+		doNameAnalysis(inputPath, pruneEntry);
 	if (nameAnalysis == nullptr){ return nullptr; }
 	return TypeAnalysis::build(nameAnalysis);
 }
 
-int 
-main( const int argc, const char **argv )
-{
-	if (argc <= 1){ usageAndDie(); }
-	std::ifstream * input = new std::ifstream(argv[1]);
-	if (input == nullptr){ usageAndDie(); }
-	if (!input->good()){
-		std::cerr << "Bad path " << argv[1] << std::endl;
+//The options that apply to each input file
+class Options{
+public:
+	Options(){
+		tokensFile = NULL;
+		checkParse = false;
+		unparseFile = NULL;
+		namesFile = NULL;
+		checkTypes = false;
+		layoutFile = NULL;
+		graphFile = NULL;
+		pruneEntry = NULL;
+		stackFile = NULL;
+		indexFile = NULL;
+		cache = nullptr;
+		stream = false;
+		renderWorkers = 1;
+		maxErrors = 0;
+		diagFormat = DiagnosticEngine::TEXT;
+		emitInterface = false;
+		timeReport = false;
+		timeJSON = nullptr;
+		perfCounters = false;
+		stats = false;
+	}
+	const char * tokensFile;
+	bool checkParse;
+	const char * unparseFile;
+	const char * namesFile;
+	bool checkTypes;
+	const char * layoutFile;
+	const char * graphFile;
+	const char * pruneEntry;
+	const char * stackFile;
+	const char * indexFile;
+	ResultCache * cache;
+	bool stream;
+	//Threads used to render -u and -n output, or 0 to choose
+	// by the size of the tree
+	size_t renderWorkers;
+	size_t maxErrors;
+	DiagnosticEngine::Format diagFormat;
+	bool emitInterface;
+	bool timeReport;
+	//Where to append each file's time report as JSON
+	std::ostream * timeJSON;
+	bool perfCounters;
+	bool stats;
+};
+
+static int runOn(const char * inFile, const Options& opts);
+
+//Whether every stage requested is one whose results
+// the cache holds
+static bool cachedStagesOnly(const Options& opts){
+	return opts.tokensFile == nullptr && opts.layoutFile == nullptr
+	  && opts.graphFile == nullptr && opts.stackFile == nullptr
+	  && opts.indexFile == nullptr && !opts.emitInterface;
+}
+
+static const char * outputKind(const char * path){
+	if (path == nullptr){ return "none"; }
+	if (strcmp(path, "--") == 0){ return "stdout"; }
+	return "file";
+}
+
+static bool readWhole(const std::string& path, std::string& text){
+	std::ifstream in(path, std::ios::binary);
+	if (!in.good()){ return false; }
+	std::ostringstream bytes;
+	bytes << in.rdbuf();
+	text = bytes.str();
+	return true;
+}
+
+//The text of a source whose bytes have been read, decompressed
+// if need be. A corrupt source gives what could be read of it,
+// and the compile itself reports the error.
+static std::string sourceText(const char * path, const std::string& bytes){
+	if (DecompressBuf::sniff(bytes.data(), bytes.size()) 
+	  == DecompressBuf::PLAIN){
+		return bytes;
+	}
+	std::string text;
+	try {
+		SourceStream in(path, &bytes);
+		char chunk[4096];
+		while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0){
+			text.append(chunk, static_cast<size_t>(in.gcount()));
+		}
+	} catch (crona::InternalError * e){
+		delete e;
+	}
+	return text;
+}
+
+static bool writeWhole(const char * path, const std::string& text){
+	std::ofstream out(path, std::ios::binary);
+	out << text;
+	out.flush();
+	if (!out.good()){
+		Report::err() << "InternalError: Bad output file " 
+		  << path << "\n";
+		return false;
+	}
+	return true;
+}
+
+//Produce a file's results from the cache, or on a miss compile
+// it with every output captured and store what it produced.
+// Either way the results are then replayed from the entry, so a
+// hit writes exactly what a miss does.
+static int runCached(const char * inFile, const Options& opts){
+	ResultCache * cache = opts.cache;
+	std::string source;
+	if (prefetched != nullptr){
+		source = *prefetched;
+	} else if (!readWhole(inFile, source)){
+		Options uncached = opts;
+		uncached.cache = nullptr;
+		return runOn(inFile, uncached);
+	}
+	std::string flags = std::string("p:") + (opts.checkParse ? "1" : "0")
+	  + " c:" + (opts.checkTypes ? "1" : "0")
+	  + " u:" + outputKind(opts.unparseFile)
+	  + " n:" + outputKind(opts.namesFile)
+	  + " prune:" + (opts.pruneEntry ? opts.pruneEntry : "")
+	  + " max-errors:" + std::to_string(opts.maxErrors)
+	  + " diag:" 
+	  + (opts.diagFormat == DiagnosticEngine::JSON ? "json" : "text");
+	//Imports go into the key in full, each preceded by its
+	// length, so that the lookup compares them byte for byte
+	for (auto module : *ModuleInterface::imports()){
+		std::string encoded = module->encode();
+		flags += " import:" + std::to_string(encoded.size()) + ":" 
+		  + encoded;
+	}
+	//The source names its own imports, but their interfaces
+	// are not part of it
+	for (auto name : 
+	  ModuleInterface::importsNamedIn(sourceText(inFile, source))){
+		std::string path = ModuleInterface::pathFor(inFile, name);
+		std::string bytes;
+		flags += " source-import:" + std::to_string(name.size()) + ":" 
+		  + name;
+		if (readWhole(path.c_str(), bytes)){
+			flags += std::to_string(bytes.size()) + ":" + bytes;
+		} else {
+			flags += "missing";
+		}
+	}
+	std::string key = ResultCache::key(source, flags);
+
+	ResultCache::Entry entry;
+	if (!cache->lookup(key, entry)){
+		Options uncached = opts;
+		uncached.cache = nullptr;
+		std::string unparsedPath = cache->scratchPath();
+		std::string namesPath = cache->scratchPath();
+		if (strcmp(outputKind(opts.unparseFile), "file") == 0){
+			uncached.unparseFile = unparsedPath.c_str();
+		}
+		if (strcmp(outputKind(opts.namesFile), "file") == 0){
+			uncached.namesFile = namesPath.c_str();
+		}
+
+		std::ostream& prevErr = Report::err();
+		std::ostream& prevOut = Report::out();
+		std::ostringstream err;
+		std::ostringstream out;
+		Report::redirect(&err, &out);
+		{
+			//The outputs are read back below, so they must be
+			// on disk when the run returns
+			BulkIO::Bypass direct;
+			entry.status = runOn(inFile, uncached);
+		}
+		Report::redirect(&prevErr, &prevOut);
+
+		entry.err = err.str();
+		entry.out = out.str();
+		entry.hasUnparsed = readWhole(unparsedPath, entry.unparsed);
+		entry.hasNames = readWhole(namesPath, entry.names);
+		remove(unparsedPath.c_str());
+		remove(namesPath.c_str());
+		cache->store(key, entry);
+	}
+
+	Report::err() << entry.err;
+	Report::out() << entry.out;
+	if (entry.hasUnparsed 
+	  && !writeWhole(opts.unparseFile, entry.unparsed)){
+		return 1;
+	}
+	if (entry.hasNames && !writeWhole(opts.namesFile, entry.names)){
+		return 1;
+	}
+	return entry.status;
+}
+
+//An output of a streamed run, which is kept only if the run gets
+// as far as the same output would be written without --stream.
+// It goes to a scratch file beside its path, which is renamed into
+// place when it is kept, or to memory if it is for standard output.
+class StagedOutput{
+public:
+	StagedOutput(const char * pathIn) : path(pathIn), kept(false){
+		if (path == nullptr || strcmp(path, "--") == 0){ return; }
+		scratch = std::string(path) + ".partial."
+		  + std::to_string(getpid());
+		file.open(scratch);
+		if (!file.good()){
+			std::string msg = "Bad output file ";
+			msg += path;
+			throw new crona::InternalError(msg.c_str());
+		}
+	}
+	~StagedOutput(){
+		if (!kept && !scratch.empty()){
+			file.close();
+			remove(scratch.c_str());
+		}
+	}
+	std::ostream * stream(){
+		if (path == nullptr){ return nullptr; }
+		if (scratch.empty()){ return &memory; }
+		return &file;
+	}
+	void keep(){
+		if (path == nullptr || kept){ return; }
+		kept = true;
+		if (scratch.empty()){
+			Report::out() << memory.str();
+			return;
+		}
+		file.close();
+		if (rename(scratch.c_str(), path) != 0){
+			remove(scratch.c_str());
+			std::string msg = "Bad output file ";
+			msg += path;
+			throw new crona::InternalError(msg.c_str());
+		}
+	}
+private:
+	const char * path;
+	std::string scratch;
+	std::ofstream file;
+	std::ostringstream memory;
+	bool kept;
+};
+
+//Parse the input once, checking and writing out each top-level
+// declaration as soon as it is parsed
+static int runStreamed(const char * inFile, const Options& opts){
+	try {
+		SourceStream * in;
+		if (strcmp(inFile, "-") == 0){
+			in = new SourceStream(std::cin.rdbuf());
+		} else {
+			in = new SourceStream(inFile, prefetched);
+		}
+		StagedOutput unparsed(opts.unparseFile);
+		StagedOutput names(opts.namesFile);
+
+		DeclStream stream(inFile, unparsed.stream(), names.stream(), 
+			false, opts.checkTypes);
+		bool parsed;
+		{
+			TimeReport::PhaseTimer timer("stream");
+			CRONA_PROBE1(parse__start, inFile);
+			parsed = stream.parse(*in);
+			CRONA_PROBE2(parse__end, inFile, parsed);
+		}
+		delete in;
+		//Each output and message is as the stages would leave
+		// them without --stream, each stage parsing on its own
+		if (!parsed && opts.checkParse){
+			Report::note("Parse failed");
+		}
+		if (parsed){
+			unparsed.keep();
+		} else if (opts.unparseFile != nullptr){
+			Report::note("No AST built");
+		}
+		bool named = parsed && stream.namesPassed();
+		if (opts.namesFile != nullptr && !named){
+			Report::out() << "Name Analysis Failed\n";
+			return 1;
+		}
+		names.keep();
+		if (opts.checkTypes && !(named && stream.typesPassed())){
+			Report::out() << "Type Analysis Failed\n";
+			return 1;
+		}
+	} catch (crona::ToDoError * e){
+		Report::note(std::string("ToDoError: ") + e->msg());
+		return 1;
+	} catch (crona::InternalError * e){
+		Report::note(std::string("InternalError: ") + e->msg());
+		return 1;
+	}
+	return 0;
+}
+
+static void dropSuffix(std::string& path, const std::string& suffix){
+	if (path.size() > suffix.size() 
+	  && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0){
+		path.resize(path.size() - suffix.size());
+	}
+}
+
+//Write the interface of a checked program next to its source,
+// as <name>.cri for <name>.crona (or <name>.crona.gz, .zst)
+static void writeInterface(ProgramNode * ast, const char * inFile){
+	std::string path = inFile;
+	dropSuffix(path, ".gz");
+	dropSuffix(path, ".zst");
+	dropSuffix(path, ".crona");
+	std::string name = path.substr(path.find_last_of('/') + 1);
+	path += ".cri";
+	TimeReport::PhaseTimer timer("interface");
+	ModuleInterface * module = ModuleInterface::build(ast, name);
+	bool saved = module->save(path.c_str());
+	delete module;
+	if (!saved){
+		std::string msg = "Bad output file " + path;
+		throw new InternalError(msg.c_str());
+	}
+}
+
+//Run every requested stage on one input file, writing to the
+// current thread's report streams, and return the exit status
+static int runStages(const char * inFile, const Options& opts){
+	const char * tokensFile = opts.tokensFile;
+	bool checkParse = opts.checkParse;
+	const char * unparseFile = opts.unparseFile;
+	const char * namesFile = opts.namesFile;
+	bool checkTypes = opts.checkTypes;
+	const char * layoutFile = opts.layoutFile;
+	const char * graphFile = opts.graphFile;
+	const char * pruneEntry = opts.pruneEntry;
+	const char * stackFile = opts.stackFile;
+	const char * indexFile = opts.indexFile;
+
+	try {
+		if (tokensFile != nullptr){
+			writeTokenStream(inFile, tokensFile);
+		}
+		if (checkParse){
+			if (!parse(inFile)){
+				Report::note("Parse failed");
+			}
+		}
+		if (unparseFile != nullptr){
+			doUnparsing(inFile, unparseFile, pruneEntry, 
+				opts.renderWorkers);
+		}
+		if (namesFile){
+			crona::NameAnalysis * na;
+			na = doNameAnalysis(inFile, pruneEntry);
+			if (na == nullptr){
+				Report::out() << "Name Analysis Failed\n";
+				return 1;
+			}
+			outputAST(na->ast, namesFile, opts.renderWorkers);
+		}
+		if (checkTypes){
+			crona::TypeAnalysis * ta;
+			ta = doTypeAnalysis(inFile, pruneEntry);
+			if (ta == nullptr){
+				Report::out() << "Type Analysis Failed\n";
+				return 1;
+			}
+		}
+		if (layoutFile){
+			crona::TypeAnalysis * ta;
+			ta = doTypeAnalysis(inFile, pruneEntry);
+			if (ta == nullptr){
+				Report::out() << "Type Analysis Failed\n";
+				return 1;
+			}
+			//When a non-reference target is selected, also lay
+			// the program out for the reference target so the 
+			// report can show the memory saved. The selected
+			// target is laid out last, so its locations are 
+			// the ones left on the symbols.
+			const DataLayout * target = DataLayout::target();
+			const DataLayout * reference = DataLayout::reference();
+			crona::Layout * refLayout = nullptr;
+			if (target != reference){
+				refLayout = crona::Layout::build(ta, reference);
+			}
+			crona::Layout * layout = crona::Layout::build(ta, target);
+			outputLayout(layout, refLayout, layoutFile);
+		}
+		if (graphFile){
+			crona::CallGraph * graph = doCallGraph(inFile);
+			if (graph == nullptr){
+				Report::out() << "Name Analysis Failed\n";
+				return 1;
+			}
+			outputCallGraph(graph, graphFile);
+		}
+		if (stackFile){
+			crona::NameAnalysis * na;
+			na = doNameAnalysis(inFile, pruneEntry);
+			if (na == nullptr){
+				Report::out() << "Name Analysis Failed\n";
+				return 1;
+			}
+			crona::TypeAnalysis * ta = TypeAnalysis::build(na);
+			if (ta == nullptr){
+				Report::out() << "Type Analysis Failed\n";
+				return 1;
+			}
+			crona::Layout * layout = 
+				crona::Layout::build(ta, DataLayout::target());
+			crona::CallGraph * graph = crona::CallGraph::build(na);
+			crona::StackAnalysis * stack = 
+				crona::StackAnalysis::build(layout, graph);
+			const char * entry = pruneEntry ? pruneEntry : "main";
+			outputStack(stack, entry, stackFile);
+		}
+		if (indexFile){
+			if (!writeIndex(inFile, indexFile)){
+				Report::out() << "Name Analysis Failed\n";
+				return 1;
+			}
+		}
+		if (opts.emitInterface){
+			crona::TypeAnalysis * ta;
+			ta = doTypeAnalysis(inFile, pruneEntry);
+			if (ta == nullptr){
+				Report::out() << "Type Analysis Failed\n";
+				return 1;
+			}
+			writeInterface(ta->ast, inFile);
+		}
+	} catch (crona::ToDoError * e){
+		Report::note(std::string("ToDoError: ") + e->msg());
+		return 1;
+	} catch (crona::InternalError * e){
+		Report::note(std::string("InternalError: ") + e->msg());
+		return 1;
+	}
+
+	return 0;
+}
+
+static std::mutex timeJSONLock;
+
+static void reportAllocs(){
+#ifdef CRONA_ALLOC_STATS
+	AllocStats::report(std::cerr);
+#endif
+}
+
+static int runOn(const char * inFile, const Options& opts){
+	bool timed = opts.timeReport || opts.timeJSON != nullptr;
+	if (timed && TimeReport::current() == nullptr){
+		//A report covers the whole of one file's run, including
+		// any cache lookup
+		TimeReport report(inFile, opts.perfCounters);
+		TimeReport::install(&report);
+		int status = runOn(inFile, opts);
+		TimeReport::install(nullptr);
+		if (opts.timeReport){
+			report.writeTable(Report::err());
+		}
+		if (opts.timeJSON != nullptr){
+			std::lock_guard<std::mutex> guard(timeJSONLock);
+			report.writeJSON(*opts.timeJSON);
+			opts.timeJSON->flush();
+		}
+		return status;
+	}
+	if (opts.stats && Census::current() == nullptr){
+		Census census(inFile);
+		Census::install(&census);
+		int status = runOn(inFile, opts);
+		Census::install(nullptr);
+		census.write(Report::err());
+		return status;
+	}
+	Trace::Span span("file", inFile);
+	CRONA_PROBE1(file__open, inFile);
+	//A census needs the stages to be run, not looked up
+	if (opts.cache != nullptr && cachedStagesOnly(opts) && !opts.stats){
+		int status = runCached(inFile, opts);
+		CRONA_PROBE2(file__close, inFile, status);
+		return status;
+	}
+	//Diagnostics from every stage are gathered and written
+	// out together, in order of position, once all are done
+	DiagnosticEngine diags(opts.maxErrors, opts.diagFormat);
+	DiagnosticEngine * outer = DiagnosticEngine::install(&diags);
+	int status;
+	if (opts.stream){
+		status = runStreamed(inFile, opts);
+	} else {
+		status = runStages(inFile, opts);
+	}
+	diags.emit(Report::err());
+	DiagnosticEngine::install(outer);
+	CRONA_PROBE2(file__close, inFile, status);
+	return status;
+}
+
+static void readResponseFile(const char * listPath, 
+	std::vector<const char *>& inFiles){
+	std::ifstream list(listPath);
+	if (!list.good()){
+		std::cerr << "Bad response file " << listPath << std::endl;
 		usageAndDie();
 	}
+	std::string line;
+	while (std::getline(list, line)){
+		if (line.empty()){ continue; }
+		//The names must outlive the batch
+		char * name = new char[line.size() + 1];
+		strcpy(name, line.c_str());
+		inFiles.push_back(name);
+	}
+}
+
+static size_t fileSize(const char * path){
+	struct stat info;
+	if (stat(path, &info) != 0){ return 0; }
+	return static_cast<size_t>(info.st_size);
+}
+
+class FileResult{
+public:
+	FileResult() : status(0){ }
+	std::ostringstream err;
+	std::ostringstream out;
+	int status;
+};
+
+//Compile each input as its own job, largest first, capturing
+// what each one writes. Once all are done, the captured text is
+// printed file by file in the order the inputs were given, so the
+// output does not depend on how the jobs were scheduled. Each
+// file's text and status are the same as a run of cronac on that
+// file alone; the batch fails if any file does.
+//
+// Given bulk I/O, the inputs are read ahead in the order the jobs
+// will want them, and output files are written in the background.
+static int runBatch(std::vector<const char *>& inFiles, 
+	const Options& opts, size_t workers, BulkIO * io){
+	std::vector<FileResult *> results;
+	std::vector<size_t> sizes;
+	std::vector<size_t> bySize;
+	for (size_t k = 0; k < inFiles.size(); k++){
+		results.push_back(new FileResult());
+		sizes.push_back(fileSize(inFiles[k]));
+		bySize.push_back(k);
+	}
+	std::stable_sort(bySize.begin(), bySize.end(), [&](size_t a, size_t b){
+		return sizes[a] > sizes[b];
+	});
+
+	if (io != nullptr){
+		std::vector<const char *> readOrder;
+		for (size_t k : bySize){
+			readOrder.push_back(inFiles[k]);
+		}
+		io->prefetch(readOrder);
+		BulkIO::setActive(io);
+	}
+
+	WorkPool pool(workers);
+	for (size_t pos = 0; pos < bySize.size(); pos++){
+		size_t k = bySize[pos];
+		pool.add([&inFiles, &results, &opts, io, k, pos](){
+			FileResult * result = results[k];
+			Report::redirect(&result->err, &result->out);
+			bool readable;
+			if (io != nullptr){
+				prefetched = io->input(pos);
+				readable = prefetched != nullptr;
+			} else {
+				std::ifstream input(inFiles[k]);
+				readable = input.good();
+			}
+			if (!readable){
+				Report::err() << "Bad path " << inFiles[k] << std::endl;
+				result->status = 1;
+			} else {
+				result->status = runOn(inFiles[k], opts);
+			}
+			if (io != nullptr){
+				prefetched = nullptr;
+				io->release(pos);
+			}
+		});
+	}
+	pool.run();
+	Report::redirect(&std::cerr, &std::cout);
 
-	const char * inFile = NULL;
-	const char * tokensFile = NULL;
-	bool checkParse = false;
-	const char * unparseFile = NULL;
-	const char * namesFile = NULL;
-	bool checkTypes = false;
+	int status = 0;
+	if (io != nullptr){
+		BulkIO::setActive(nullptr);
+		if (!io->finish(std::cerr)){ status = 1; }
+	}
+	for (size_t k = 0; k < inFiles.size(); k++){
+		std::string errText = results[k]->err.str();
+		std::string outText = results[k]->out.str();
+		if (!errText.empty()){
+			std::cerr << "==> " << inFiles[k] << " <==\n" << errText;
+		}
+		if (!outText.empty()){
+			std::cout << "==> " << inFiles[k] << " <==\n" << outText;
+		}
+		if (results[k]->status > status){ status = results[k]->status; }
+		delete results[k];
+	}
+	std::cerr.flush();
+	std::cout.flush();
+	return status;
+}
+
+static int compile( const int argc, const char **argv )
+{
+	if (argc <= 1){ usageAndDie(); }
+	if (strcmp(argv[1], "--index-query") == 0){
+		//Queries read only the index, not any source
+		if (argc != 4){ usageAndDie(); }
+		return queryIndex(argv[2], argv[3]);
+	}
+	std::vector<const char *> inFiles;
+	Options opts;
+	bool batch = false;
+	size_t jobs = WorkPool::defaultWorkers();
+	bool jobsGiven = false;
+	const char * cacheDir = nullptr;
+	size_t cacheSize = ResultCache::DEFAULT_MAX_BYTES;
+	bool cacheStats = false;
+	const char * batchIO = "ring";
+	const char * testDir = nullptr;
+	const char * timeJSONPath = nullptr;
+	const char * tracePath = nullptr;
+	bool allocStats = false;
 
 	bool useful = false;
 	int i = 1;
 	for (int i = 1 ; i < argc ; i++){
-		if (argv[i][0] == '-'){
-			if (argv[i][1] == 't'){
+		if (argv[i][0] == '-' && argv[i][1] != '\0'){
+			if (strcmp(argv[i], "--layout") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				opts.layoutFile = argv[i];
+				useful = true;
+			} else if (strcmp(argv[i], "--target") == 0){
 				i++;
-				tokensFile = argv[i];
+				if (i >= argc){ usageAndDie(); }
+				const DataLayout * target = DataLayout::produce(argv[i]);
+				if (target == nullptr){
+					std::cerr << "Unknown target: ";
+					std::cerr << argv[i] << std::endl;
+					usageAndDie();
+				}
+				DataLayout::setTarget(target);
+			} else if (strcmp(argv[i], "--callgraph") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				opts.graphFile = argv[i];
+				useful = true;
+			} else if (strcmp(argv[i], "--prune") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				opts.pruneEntry = argv[i];
+			} else if (strcmp(argv[i], "--stack") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				opts.stackFile = argv[i];
+				useful = true;
+			} else if (strcmp(argv[i], "--index") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				opts.indexFile = argv[i];
+				useful = true;
+			} else if (strcmp(argv[i], "--batch") == 0){
+				batch = true;
+			} else if (strcmp(argv[i], "--jobs") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				int count = atoi(argv[i]);
+				if (count <= 0){ usageAndDie(); }
+				jobs = static_cast<size_t>(count);
+				jobsGiven = true;
+			} else if (strcmp(argv[i], "--time-report") == 0){
+				opts.timeReport = true;
+			} else if (strncmp(argv[i], "--time-report=", 14) == 0){
+				timeJSONPath = argv[i] + 14;
+			} else if (strcmp(argv[i], "--perf-counters") == 0){
+				opts.perfCounters = true;
+			} else if (strcmp(argv[i], "--stats") == 0){
+				opts.stats = true;
+			} else if (strcmp(argv[i], "--alloc-stats") == 0){
+#ifdef CRONA_ALLOC_STATS
+				allocStats = true;
+#else
+				std::cerr << "cronac was built without allocation"
+				  << " accounting; build it with make ALLOC_STATS=1\n";
+				return 1;
+#endif
+			} else if (strncmp(argv[i], "--trace=", 8) == 0){
+				tracePath = argv[i] + 8;
+			} else if (strcmp(argv[i], "--run-tests") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				testDir = argv[i];
+			} else if (strcmp(argv[i], "--io") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				batchIO = argv[i];
+				bool known = strcmp(batchIO, "ring") == 0
+				  || strcmp(batchIO, "thread") == 0
+				  || strcmp(batchIO, "sync") == 0;
+				if (!known){ usageAndDie(); }
+			} else if (strcmp(argv[i], "--cache") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				cacheDir = argv[i];
+			} else if (strcmp(argv[i], "--cache-size") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				int megabytes = atoi(argv[i]);
+				if (megabytes <= 0){ usageAndDie(); }
+				cacheSize = static_cast<size_t>(megabytes) * 1024 * 1024;
+			} else if (strcmp(argv[i], "--cache-stats") == 0){
+				cacheStats = true;
+			} else if (strcmp(argv[i], "--stream") == 0){
+				opts.stream = true;
+			} else if (strcmp(argv[i], "--max-errors") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				int count = atoi(argv[i]);
+				if (count <= 0){ usageAndDie(); }
+				opts.maxErrors = static_cast<size_t>(count);
+			} else if (strcmp(argv[i], "--diag-format") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				if (strcmp(argv[i], "json") == 0){
+					opts.diagFormat = DiagnosticEngine::JSON;
+				} else if (strcmp(argv[i], "text") == 0){
+					opts.diagFormat = DiagnosticEngine::TEXT;
+				} else {
+					usageAndDie();
+				}
+			} else if (strcmp(argv[i], "--emit-interface") == 0){
+				opts.emitInterface = true;
+				useful = true;
+			} else if (strcmp(argv[i], "--import") == 0){
+				i++;
+				if (i >= argc){ usageAndDie(); }
+				ModuleInterface * module = ModuleInterface::load(argv[i]);
+				if (module == nullptr){
+					std::cerr << "Bad interface file " << argv[i] << std::endl;
+					return 1;
+				}
+				ModuleInterface::addImport(module);
+			} else if (argv[i][1] == 't'){
+				i++;
+				opts.tokensFile = argv[i];
 				useful = true;
 			} else if (argv[i][1] == 'p'){
-				checkParse = true;
+				opts.checkParse = true;
 				useful = true;
 			} else if (argv[i][1] == 'u'){
 				i++;
 				if (i >= argc){ usageAndDie(); }
-				unparseFile = argv[i];
+				opts.unparseFile = argv[i];
 				useful = true;
 			} else if (argv[i][1] == 'n'){
 				i++;
-				namesFile = argv[i];
+				opts.namesFile = argv[i];
 				useful = true;
 			} else if (argv[i][1] == 'c'){
-				checkTypes = true;
+				opts.checkTypes = true;
 				useful = true;
 			} else {
 				std::cerr << "Unrecognized argument: ";
 				std::cerr << argv[i] << std::endl;
 				usageAndDie();
 			}
+		} else if (argv[i][0] == '@'){
+			readResponseFile(argv[i] + 1, inFiles);
 		} else {
-			if (inFile == NULL){
-				inFile = argv[i];
-			} else {
-				std::cerr << "Only 1 input file allowed";
-				std::cerr << argv[i] << std::endl;
-				usageAndDie();
-			}
+			inFiles.push_back(argv[i]);
+		}
+	}
+	std::ofstream timeJSONFile;
+	if (timeJSONPath != nullptr){
+		timeJSONFile.open(timeJSONPath);
+		if (!timeJSONFile.good()){
+			std::cerr << "Bad output file " << timeJSONPath << std::endl;
+			return 1;
 		}
+		opts.timeJSON = &timeJSONFile;
 	}
-	if (inFile == NULL){
+	//Counters alone are reported in the table
+	if (opts.perfCounters && opts.timeJSON == nullptr){
+		opts.timeReport = true;
+	}
+	std::ofstream traceFile;
+	Trace trace;
+	if (tracePath != nullptr){
+		traceFile.open(tracePath);
+		if (!traceFile.good()){
+			std::cerr << "Bad output file " << tracePath << std::endl;
+			return 1;
+		}
+		trace.start();
+	}
+	if (testDir != nullptr){
+		//Each test is run just as p5_tests/Makefile runs it
+		Options testOpts = opts;
+		testOpts.checkTypes = true;
+		GoldenRunner runner([&testOpts](const char * path){
+			return runOn(path, testOpts);
+		});
+		int failed = runner.run(testDir, jobs, std::cout);
+		if (tracePath != nullptr){ trace.finish(traceFile); }
+		if (allocStats){ reportAllocs(); }
+		return failed == 0 ? 0 : 1;
+	}
+	if (inFiles.empty()){
 		usageAndDie();
 	}
 	if (!useful){
 		std::cerr << "Hey, you didn't tell cronac to do anything!\n";
 		usageAndDie();
 	}
-
-	try {
-		if (tokensFile != nullptr){
-			writeTokenStream(inFile, tokensFile);
+	if (!batch && inFiles.size() > 1){
+		std::cerr << "Only 1 input file allowed without --batch: ";
+		std::cerr << inFiles[1] << std::endl;
+		usageAndDie();
+	}
+	if (opts.stream){
+		bool wholeProgram = !cachedStagesOnly(opts)
+		  || opts.pruneEntry != nullptr || cacheDir != nullptr;
+		if (wholeProgram){
+			std::cerr << "--stream only supports -p, -c, -u and -n\n";
+			usageAndDie();
 		}
-		if (checkParse){
-			if (!parse(inFile)){
-				std::cerr << "Parse failed" << std::endl;
-			}
+	}
+	if (!batch){
+		//In a batch the threads are all busy with files. Alone,
+		// a file is rendered in parallel only when --jobs asks
+		// for it or its tree is large.
+		opts.renderWorkers = jobsGiven ? jobs : 0;
+	}
+	if (cacheDir != nullptr){
+		try {
+			opts.cache = new ResultCache(cacheDir, cacheSize);
+		} catch (crona::InternalError * e){
+			std::cerr << e->msg() << std::endl;
+			return 1;
 		}
-		if (unparseFile != nullptr){
-			doUnparsing(inFile, unparseFile);
+	}
+
+	int status;
+	if (batch){
+		BulkIO * io = nullptr;
+		if (batchIO != nullptr && strcmp(batchIO, "sync") != 0){
+			io = new BulkIO(strcmp(batchIO, "ring") == 0);
 		}
-		if (namesFile){
-			crona::NameAnalysis * na;
-			na = doNameAnalysis(inFile);
-			if (na == nullptr){
-				std::cout << "Name Analysis Failed\n";
-				return 1;
-			}
-			outputAST(na->ast, namesFile);
+		status = runBatch(inFiles, opts, jobs, io);
+		delete io;
+	} else {
+		const char * inFile = inFiles.front();
+		std::ifstream input(inFile);
+		bool fromStdin = opts.stream && strcmp(inFile, "-") == 0;
+		if (!fromStdin && !input.good()){
+			std::cerr << "Bad path " << inFile << std::endl;
+			usageAndDie();
 		}
-		if (checkTypes){
-			crona::TypeAnalysis * ta;
-			ta = doTypeAnalysis(inFile);
-			if (ta == nullptr){
-				std::cout << "Type Analysis Failed\n";
-				return 1;
+		status = runOn(inFile, opts);
+	}
+	if (cacheStats && opts.cache != nullptr){
+		opts.cache->report(std::cerr);
+	}
+	if (tracePath != nullptr){ trace.finish(traceFile); }
+	delete opts.cache;
+	if (allocStats){ reportAllocs(); }
+	return status;
+}
+
+//A served command line may be answered from memory if it writes
+// nothing but its standard streams and names all of its inputs
+// directly
+static bool cacheable(const Server::Args& args){
+	for (auto& arg : args){
+		//Standard input is not part of the request
+		if (arg == "-"){ return false; }
+		if (arg == "--emit-interface"){ return false; }
+		//Timings differ from run to run
+		if (arg.compare(0, 13, "--time-report") == 0){ return false; }
+		if (arg == "--perf-counters"){ return false; }
+		if (arg.compare(0, 8, "--trace=") == 0){ return false; }
+		if (arg == "--alloc-stats" || arg == "--stats"){ return false; }
+	}
+	static const char * fileOutputs[] = {
+		"-t", "-u", "-n", "--layout", "--callgraph", "--stack", "--index"
+	};
+	for (size_t k = 0; k < args.size(); k++){
+		if (!args[k].empty() && args[k][0] == '@'){ return false; }
+		for (auto flag : fileOutputs){
+			if (args[k] != flag){ continue; }
+			if (k + 1 < args.size() && args[k + 1] != "--"){ 
+				return false;
 			}
 		}
-	} catch (crona::ToDoError * e){
-		std::cerr << "ToDoError: " << e->msg() << "\n";
-		return 1;
-	} catch (crona::InternalError * e){
-		std::cerr << "InternalError: " << e->msg() << "\n";
-		return 1;
 	}
+	return true;
+}
 
-	return 0;
+static int compileArgs(const Server::Args& args){
+	std::vector<const char *> argv;
+	argv.push_back("cronac");
+	for (auto& arg : args){
+		argv.push_back(arg.c_str());
+	}
+	return compile(static_cast<int>(argv.size()), argv.data());
+}
+
+//Builds, once in the server, the state that every compile would
+// otherwise set up for itself, so that each forked request finds
+// it already in place
+static void preloadCompiler(){
+	DataLayout::reference();
+	ErrorType::produce();
+	BasicType::VOID();
+	std::ostringstream warm;
+	warm << 0 << ' ' << 0.5 << std::endl;
+	std::cerr.flush();
+}
+
+int 
+main( const int argc, const char **argv )
+{
+	if (argc == 3 && strcmp(argv[1], "--server") == 0){
+		Server server(compileArgs, cacheable, preloadCompiler);
+		return server.serve(argv[2]);
+	}
+	const char * serverPath = getenv("CRONAC_SERVER");
+	//A command line reading standard input is run here, since the
+	// server cannot read this process's input
+	bool readsStdin = false;
+	for (int i = 1; i < argc; i++){
+		if (strcmp(argv[i], "-") == 0){ readsStdin = true; }
+	}
+	if (serverPath != nullptr && *serverPath != '\0' && !readsStdin){
+		Server::Args args(argv + 1, argv + argc);
+		int status;
+		if (Server::forward(serverPath, args, status)){
+			return status;
+		}
+		//With no server listening, run as usual
+	}
+	return compile(argc, argv);
 }
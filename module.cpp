@@ -0,0 +1,273 @@
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include "errors.hpp"
+#include "module.hpp"
+
+namespace crona{
+
+//An interface is a sequence of little-endian 32-bit words:
+// the magic number, the version, the module name, the number
+// of exports, then each export's name and type. A string is
+// its length followed by its bytes. A type is one of the codes
+// below, followed for an array by its element type code and
+// length, and for a function by its formal count, its formal
+// types and its return type.
+enum TypeCode{
+	CODE_VOID, CODE_INT, CODE_BOOL, CODE_BYTE, CODE_ARRAY, CODE_FN
+};
+
+static void putWord(std::string& out, uint32_t word){
+	for (int k = 0; k < 4; k++){
+		out.push_back(static_cast<char>((word >> (8 * k)) & 0xff));
+	}
+}
+
+static void putString(std::string& out, const std::string& str){
+	putWord(out, static_cast<uint32_t>(str.size()));
+	out += str;
+}
+
+static uint32_t basicCode(const BasicType * type){
+	switch (type->getBaseType()){
+	case INT: return CODE_INT;
+	case VOID: return CODE_VOID;
+	case BOOL: return CODE_BOOL;
+	case BYTE: return CODE_BYTE;
+	}
+	throw new InternalError("Unknown base type");
+}
+
+static void putType(std::string& out, const DataType * type){
+	if (const BasicType * basic = type->asBasic()){
+		putWord(out, basicCode(basic));
+	} else if (const ArrayType * array = type->asArray()){
+		putWord(out, CODE_ARRAY);
+		putWord(out, basicCode(ArrayType::baseType(array)->asBasic()));
+		putWord(out, static_cast<uint32_t>(array->getLength()));
+	} else if (const FnType * fn = type->asFn()){
+		putWord(out, CODE_FN);
+		putWord(out, static_cast<uint32_t>(fn->getFormalTypes()->size()));
+		for (auto formal : *fn->getFormalTypes()){
+			putType(out, formal);
+		}
+		putType(out, fn->getReturnType());
+	} else {
+		throw new InternalError("Type cannot be exported");
+	}
+}
+
+//Reads back what the put functions wrote, failing on
+// anything short or malformed
+class InterfaceReader{
+public:
+	InterfaceReader(const std::string& bytesIn) 
+	: bytes(bytesIn), at(0){ }
+
+	bool word(uint32_t& val){
+		if (bytes.size() - at < 4){ return false; }
+		val = 0;
+		for (size_t k = 0; k < 4; k++){
+			uint32_t byte = static_cast<unsigned char>(bytes[at + k]);
+			val |= byte << (8 * k);
+		}
+		at += 4;
+		return true;
+	}
+
+	bool str(std::string& val){
+		uint32_t len;
+		if (!word(len) || bytes.size() - at < len){ return false; }
+		val = bytes.substr(at, len);
+		at += len;
+		return true;
+	}
+
+	BasicType * basic(uint32_t code){
+		switch (code){
+		case CODE_VOID: return BasicType::produce(VOID);
+		case CODE_INT: return BasicType::produce(INT);
+		case CODE_BOOL: return BasicType::produce(BOOL);
+		case CODE_BYTE: return BasicType::produce(BYTE);
+		}
+		return nullptr;
+	}
+
+	DataType * type(){
+		uint32_t code;
+		if (!word(code)){ return nullptr; }
+		if (code == CODE_ARRAY){
+			uint32_t baseCode;
+			uint32_t len;
+			if (!word(baseCode) || !word(len)){ return nullptr; }
+			BasicType * base = basic(baseCode);
+			if (base == nullptr){ return nullptr; }
+			return ArrayType::produce(base, static_cast<int>(len));
+		}
+		if (code == CODE_FN){
+			return fnType();
+		}
+		return basic(code);
+	}
+
+	FnType * fnType(){
+		uint32_t count;
+		if (!word(count)){ return nullptr; }
+		auto formals = new std::list<const DataType *>();
+		for (uint32_t k = 0; k < count; k++){
+			DataType * formal = type();
+			if (formal == nullptr){ return nullptr; }
+			formals->push_back(formal);
+		}
+		DataType * ret = type();
+		if (ret == nullptr){ return nullptr; }
+		return new FnType(formals, ret);
+	}
+
+	bool done(){ return at == bytes.size(); }
+
+private:
+	const std::string& bytes;
+	size_t at;
+};
+
+ModuleInterface * ModuleInterface::build(ProgramNode * ast, 
+	std::string name){
+	ModuleInterface * module = new ModuleInterface(name);
+	for (auto decl : *ast->getGlobals()){
+		SemSymbol * sym = decl->ID()->getSymbol();
+		if (sym == nullptr){ continue; }
+		module->exports.push_back(Export(sym->getName(), 
+			sym->getDataType()));
+	}
+	return module;
+}
+
+std::string ModuleInterface::encode(){
+	std::string out;
+	putWord(out, MAGIC);
+	putWord(out, VERSION);
+	putString(out, name);
+	putWord(out, static_cast<uint32_t>(exports.size()));
+	for (auto& exp : exports){
+		putString(out, exp.name);
+		putType(out, exp.type);
+	}
+	return out;
+}
+
+bool ModuleInterface::save(const char * path){
+	std::string bytes = encode();
+	std::ifstream existing(path, std::ios::binary);
+	if (existing.good()){
+		std::ostringstream old;
+		old << existing.rdbuf();
+		if (old.str() == bytes){ return true; }
+	}
+	std::ofstream out(path, std::ios::binary);
+	out << bytes;
+	out.flush();
+	return out.good();
+}
+
+ModuleInterface * ModuleInterface::load(const char * path){
+	std::ifstream in(path, std::ios::binary);
+	if (!in.good()){ return nullptr; }
+	std::ostringstream contents;
+	contents << in.rdbuf();
+	std::string bytes = contents.str();
+
+	InterfaceReader reader(bytes);
+	uint32_t magic;
+	uint32_t version;
+	std::string name;
+	uint32_t count;
+	if (!reader.word(magic) || magic != MAGIC 
+	  || !reader.word(version) || version != VERSION
+	  || !reader.str(name) || !reader.word(count)){
+		return nullptr;
+	}
+	ModuleInterface * module = new ModuleInterface(name);
+	for (uint32_t k = 0; k < count; k++){
+		std::string expName;
+		DataType * type;
+		if (!reader.str(expName) || (type = reader.type()) == nullptr){
+			delete module;
+			return nullptr;
+		}
+		module->exports.push_back(Export(expName, type));
+	}
+	if (!reader.done()){
+		delete module;
+		return nullptr;
+	}
+	return module;
+}
+
+bool ModuleInterface::declare(ScopeTable * scope, size_t line, 
+	size_t col){
+	bool res = true;
+	for (auto& exp : exports){
+		if (scope->clash(exp.name)){
+			Report::fatal(line, col, "Import of " + exp.name 
+			  + " from module " + name 
+			  + " clashes with another import");
+			res = false;
+			continue;
+		}
+		if (exp.type->asFn() != nullptr){
+			scope->addFn(exp.name, static_cast<FnType *>(exp.type));
+		} else {
+			scope->addVar(exp.name, exp.type);
+		}
+	}
+	return res;
+}
+
+bool ModuleInterface::declareImports(ScopeTable * scope){
+	bool res = true;
+	for (auto module : *importList()){
+		res = module->declare(scope, 0, 0) && res;
+	}
+	return res;
+}
+
+bool ModuleInterface::importedByName(const std::string& name){
+	for (auto module : *importList()){
+		if (module->name == name){ return true; }
+	}
+	return false;
+}
+
+std::string ModuleInterface::pathFor(const std::string& sourcePath, 
+	const std::string& name){
+	size_t slash = sourcePath.find_last_of('/');
+	if (slash == std::string::npos){ return name + ".cri"; }
+	return sourcePath.substr(0, slash + 1) + name + ".cri";
+}
+
+std::list<std::string> ModuleInterface::importsNamedIn(
+	const std::string& source){
+	std::list<std::string> names;
+	static const std::string keyword = "import";
+	size_t at = source.find(keyword);
+	while (at != std::string::npos){
+		size_t next = at + keyword.size();
+		bool starts = at == 0 
+		  || !(isalnum(static_cast<unsigned char>(source[at - 1])) 
+		  || source[at - 1] == '_');
+		while (next < source.size() 
+		  && isspace(static_cast<unsigned char>(source[next]))){
+			next++;
+		}
+		if (starts && next < source.size() && source[next] == '"'){
+			size_t close = source.find('"', next + 1);
+			if (close == std::string::npos){ break; }
+			names.push_back(source.substr(next + 1, close - next - 1));
+		}
+		at = source.find(keyword, at + keyword.size());
+	}
+	return names;
+}
+
+}
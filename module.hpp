@@ -0,0 +1,104 @@
+#ifndef CRONA_MODULE
+#define CRONA_MODULE
+
+#include <list>
+#include <string>
+#include "ast.hpp"
+#include "symbol_table.hpp"
+#include "types.hpp"
+
+namespace crona{
+
+// The interface of a module: the name and type of every global
+// variable and function it declares. A module is one source
+// file, and its interface is written to a small binary file
+// once the module has passed type analysis. Other modules import
+// that file instead of the source, and its globals are declared
+// in their global scope before any of their own, so importing
+// needs no parsing at all.
+//
+// An interface holds only signatures, so editing a function body
+// leaves it unchanged. It is then not rewritten at all, and
+// whatever depends on its timestamp sees no change.
+//
+// A module imports another with a declaration import "name";
+// before its own declarations, which reads name.cri from the
+// importing source's directory. Interfaces named with --import
+// on the command line are imported by every module of the run.
+//
+// Imported globals have no storage in the importing module, and
+// calls to imported functions are left out of its call graph.
+class ModuleInterface{
+public:
+	//The interface of a checked program, named after its source
+	static ModuleInterface * build(ProgramNode * ast, std::string name);
+
+	//Read the interface at path, or return nullptr if it can't
+	// be read or isn't an interface
+	static ModuleInterface * load(const char * path);
+
+	//Write the interface to path unless the file there already
+	// holds exactly these bytes. Returns false if it can't be
+	// written.
+	bool save(const char * path);
+
+	//Interfaces imported by every module compiled in this run
+	static void addImport(ModuleInterface * module){
+		importList()->push_back(module);
+	}
+	static const std::list<ModuleInterface *> * imports(){
+		return importList();
+	}
+
+	//Declare every global imported on the command line in
+	// scope. Returns false, after reporting it, if two imports
+	// declare the same name.
+	static bool declareImports(ScopeTable * scope);
+	//Whether a module of this name was imported on the
+	// command line
+	static bool importedByName(const std::string& name);
+
+	//Declare this module's globals in scope, reporting a clash
+	// with one already there at the given position
+	bool declare(ScopeTable * scope, size_t line, size_t col);
+
+	//Where the source at sourcePath finds the interface of the
+	// module it imports as name
+	static std::string pathFor(const std::string& sourcePath, 
+		const std::string& name);
+	//The names of the modules source imports, found without
+	// parsing it. May name more than the source really imports
+	// (as when an import is commented out) but never fewer.
+	static std::list<std::string> importsNamedIn(
+		const std::string& source);
+
+	std::string getName(){ return name; }
+
+	//The bytes save would write
+	std::string encode();
+
+	static const uint32_t MAGIC = 0x494d5243; // "CRMI"
+	static const uint32_t VERSION = 1;
+
+private:
+	ModuleInterface(std::string nameIn) : name(nameIn){ }
+	static std::list<ModuleInterface *> * importList(){
+		static std::list<ModuleInterface *> list;
+		return &list;
+	}
+
+	class Export{
+	public:
+		Export(std::string nameIn, DataType * typeIn)
+		: name(nameIn), type(typeIn){ }
+		std::string name;
+		DataType * type;
+	};
+
+	std::string name;
+	std::list<Export> exports;
+};
+
+}
+
+#endif
@@ -2,13 +2,18 @@
 #include "symbol_table.hpp"
 #include "errName.hpp"
 #include "types.hpp"
+#include "module.hpp"
+#include "probes.hpp"
 
 namespace crona{
 
 bool ProgramNode::nameAnalysis(SymbolTable * symTab){
 	//Enter the global scope
 	symTab->enterScope();
-	bool res = true;
+	bool res = ModuleInterface::declareImports(symTab->getCurrentScope());
+	for (auto import : *myImports){
+		res = import->nameAnalysis(symTab) && res;
+	}
 	for (auto decl : *myGlobals){
 		res = decl->nameAnalysis(symTab) && res;
 	}
@@ -17,6 +22,17 @@ bool ProgramNode::nameAnalysis(SymbolTable * symTab){
 	return res;
 }
 
+bool ImportNode::nameAnalysis(SymbolTable * symTab){
+	//A module also named on the command line is already in scope
+	if (ModuleInterface::importedByName(myName)){ return true; }
+	if (myModule == nullptr){
+		Report::fatal(line(), col(), "No interface for module " 
+		  + myName);
+		return false;
+	}
+	return myModule->declare(symTab->getCurrentScope(), line(), col());
+}
+
 bool AssignStmtNode::nameAnalysis(SymbolTable * symTab){
 	return myExp->nameAnalysis(symTab);
 }
@@ -95,12 +111,15 @@ bool VarDeclNode::nameAnalysis(SymbolTable * symTab){
 		symTab->insert(new VarSymbol(varName, dataType));
 		SemSymbol * sym = symTab->find(varName);
 		this->myID->attachSymbol(sym);
+		symTab->noteDef(sym, myID->line(), myID->col());
 		return true;
 	}
 }
 
 bool FnDeclNode::nameAnalysis(SymbolTable * symTab){
 	std::string fnName = this->ID()->getName();
+	Trace::Span span("name analysis", fnName, mySize);
+	CRONA_PROBE1(name__start, fnName.c_str());
 
 	bool validRet = myRetType->nameAnalysis(symTab);
 
@@ -138,7 +157,7 @@ bool FnDeclNode::nameAnalysis(SymbolTable * symTab){
 		atFnScope->addFn(fnName, dataType);
 		SemSymbol * sym = atFnScope->lookup(fnName);
 		this->myID->attachSymbol(sym);
-		
+		symTab->noteDef(sym, myID->line(), myID->col());
 	}
 
 	bool validBody = true;
@@ -147,7 +166,9 @@ bool FnDeclNode::nameAnalysis(SymbolTable * symTab){
 	}
 
 	symTab->leaveScope();
-	return (validRet && validFormals && validName && validBody);
+	bool valid = validRet && validFormals && validName && validBody;
+	CRONA_PROBE2(name__end, fnName.c_str(), valid);
+	return valid;
 }
 
 bool IndexNode::nameAnalysis(SymbolTable * symTab){
@@ -229,6 +250,7 @@ bool IDNode::nameAnalysis(SymbolTable* symTab){
 		return NameErr::undeclID(line(), col());
 	}
 	this->attachSymbol(sym);
+	symTab->noteUse(sym, line(), col());
 	return true;
 }
 
@@ -9,8 +9,16 @@ namespace crona{
 class NameAnalysis{
 public:
 	static NameAnalysis * build(ProgramNode * astIn){
+		return build(astIn, nullptr);
+	}
+	//As above, also passing every definition and use
+	// to the given cross-reference builder
+	static NameAnalysis * build(ProgramNode * astIn, 
+		XrefBuilder * xref){
+		TimeReport::PhaseTimer timer("name analysis");
 		NameAnalysis * nameAnalysis = new NameAnalysis;
 		SymbolTable * symTab = new SymbolTable();
+		symTab->setXref(xref);
 		bool res = astIn->nameAnalysis(symTab);
 		delete symTab;
 		if (!res){ return nullptr; }
@@ -0,0 +1,61 @@
+#include "out_buffer.hpp"
+
+namespace crona{
+
+void OutBuffer::putUInt(unsigned long long val){
+	char digits[24];
+	size_t start = sizeof(digits);
+	do {
+		digits[--start] = static_cast<char>('0' + val % 10);
+		val /= 10;
+	} while (val != 0);
+	put(digits + start, sizeof(digits) - start);
+}
+
+void OutBuffer::putInt(long long val){
+	if (val >= 0){
+		putUInt(static_cast<unsigned long long>(val));
+		return;
+	}
+	put('-');
+	//Negate in unsigned arithmetic, which is also correct
+	// for the most negative value
+	putUInt(0ULL - static_cast<unsigned long long>(val));
+}
+
+void OutBuffer::indent(int depth){
+	static const std::string tabs(64, '\t');
+	while (depth > 0){
+		size_t len = depth < 64 ? static_cast<size_t>(depth) : 64;
+		buf.append(tabs, 0, len);
+		depth -= static_cast<int>(len);
+	}
+	spillIfFull();
+}
+
+void OutBuffer::putJSONString(const std::string& text){
+	static const char * hex = "0123456789abcdef";
+	put('"');
+	for (char c : text){
+		unsigned char u = static_cast<unsigned char>(c);
+		if (c == '"' || c == '\\'){
+			put('\\');
+			put(c);
+		} else if (u < 0x20){
+			put("\\u00");
+			put(hex[u >> 4]);
+			put(hex[u & 0xf]);
+		} else {
+			put(c);
+		}
+	}
+	put('"');
+}
+
+void OutBuffer::flush(){
+	if (sink == nullptr || buf.empty()){ return; }
+	sink->write(buf.data(), static_cast<std::streamsize>(buf.size()));
+	buf.clear();
+}
+
+}
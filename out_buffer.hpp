@@ -0,0 +1,73 @@
+#ifndef CRONA_OUT_BUFFER
+#define CRONA_OUT_BUFFER
+
+#include <ostream>
+#include <string>
+
+namespace crona{
+
+// The output engine for unparsing and token listings. Text is
+// gathered in one contiguous buffer and handed to the sink in
+// large blocks, rather than through a stream insertion per
+// token. A buffer with no sink keeps all of its text, so that
+// pieces of output can be built separately (even on separate
+// threads) and then appended to a sink in order.
+class OutBuffer{
+public:
+	OutBuffer() : sink(nullptr), symbols(true){ }
+	explicit OutBuffer(std::ostream * sinkIn) : sink(sinkIn), symbols(true){
+		buf.reserve(BLOCK_BYTES + BLOCK_BYTES / 4);
+	}
+	~OutBuffer(){ flush(); }
+
+	void put(char c){
+		buf.push_back(c);
+		spillIfFull();
+	}
+	void put(const char * text, size_t len){
+		buf.append(text, len);
+		spillIfFull();
+	}
+	void put(const char * text){
+		buf.append(text);
+		spillIfFull();
+	}
+	void put(const std::string& text){
+		buf.append(text);
+		spillIfFull();
+	}
+	void put(const OutBuffer& other){
+		put(other.buf.data(), other.buf.size());
+	}
+	//Decimal integers, formatted in place
+	void putInt(long long val);
+	void putUInt(unsigned long long val);
+	//The given number of tab characters
+	void indent(int depth);
+	//A JSON string literal holding text
+	void putJSONString(const std::string& text);
+
+	//Write any buffered text to the sink
+	void flush();
+	//Everything held by a buffer with no sink
+	const std::string& text() const { return buf; }
+	//Whether unparsing writes the type of each resolved name
+	// after it, as the output of name analysis does
+	bool showsSymbols() const { return symbols; }
+	void showSymbols(bool show){ symbols = show; }
+
+	static const size_t BLOCK_BYTES = 1 << 16;
+
+private:
+	void spillIfFull(){
+		if (sink != nullptr && buf.size() >= BLOCK_BYTES){ flush(); }
+	}
+
+	std::string buf;
+	std::ostream * sink;
+	bool symbols;
+};
+
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "perf_counters.hpp"
+
+namespace crona{
+
+const char * PerfCounters::eventName(Event event){
+	switch (event){
+	case CYCLES: return "cycles";
+	case INSTRUCTIONS: return "instructions";
+	case L1D_MISSES: return "L1D misses";
+	case LLC_MISSES: return "LLC misses";
+	case BRANCH_MISSES: return "branch misses";
+	case EVENT_COUNT: break;
+	}
+	return "unknown";
+}
+
+static __u64 cacheEvent(__u64 cache){
+	return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+	  | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+static void describe(PerfCounters::Event event, __u32& type,
+	__u64& config){
+	type = PERF_TYPE_HARDWARE;
+	switch (event){
+	case PerfCounters::CYCLES:
+		config = PERF_COUNT_HW_CPU_CYCLES;
+		return;
+	case PerfCounters::INSTRUCTIONS:
+		config = PERF_COUNT_HW_INSTRUCTIONS;
+		return;
+	case PerfCounters::L1D_MISSES:
+		type = PERF_TYPE_HW_CACHE;
+		config = cacheEvent(PERF_COUNT_HW_CACHE_L1D);
+		return;
+	case PerfCounters::LLC_MISSES:
+		type = PERF_TYPE_HW_CACHE;
+		config = cacheEvent(PERF_COUNT_HW_CACHE_LL);
+		return;
+	case PerfCounters::BRANCH_MISSES:
+		config = PERF_COUNT_HW_BRANCH_MISSES;
+		return;
+	case PerfCounters::EVENT_COUNT:
+		break;
+	}
+	config = 0;
+}
+
+PerfCounters::PerfCounters() : members(0), leader(-1){
+	for (size_t k = 0; k < EVENT_COUNT; k++){
+		Event event = static_cast<Event>(k);
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		describe(event, attr.type, attr.config);
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP 
+		  | PERF_FORMAT_TOTAL_TIME_ENABLED
+		  | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		//The group starts once all of it is open
+		attr.disabled = leader < 0 ? 1u : 0u;
+		//The calling thread, on whichever CPU it runs
+		long fd = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+		fds[k] = static_cast<int>(fd);
+		slots[k] = 0;
+		if (fd < 0){
+			if (why.empty()){
+				why = std::string(eventName(event)) + ": " 
+				  + strerror(errno);
+			}
+			continue;
+		}
+		if (leader < 0){ leader = fds[k]; }
+		slots[k] = members++;
+	}
+	if (leader >= 0){
+		ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+}
+
+PerfCounters::~PerfCounters(){
+	//The leader goes last, after the events in its group
+	for (size_t k = 0; k < EVENT_COUNT; k++){
+		if (fds[k] >= 0 && fds[k] != leader){ close(fds[k]); }
+	}
+	if (leader >= 0){ close(leader); }
+}
+
+bool PerfCounters::anyAvailable() const {
+	return leader >= 0;
+}
+
+void PerfCounters::read(Values& values) const {
+	for (size_t k = 0; k < EVENT_COUNT; k++){ values.counts[k] = -1; }
+	values.enabled = 0;
+	values.running = 0;
+	if (leader < 0){ return; }
+	//The member count, the time enabled, the time running and
+	// then each member's count
+	uint64_t data[3 + EVENT_COUNT];
+	ssize_t got = ::read(leader, data, sizeof(data));
+	if (got < static_cast<ssize_t>(3 * sizeof(uint64_t)) 
+	  || data[0] != members){
+		return;
+	}
+	values.enabled = data[1];
+	values.running = data[2];
+	for (size_t k = 0; k < EVENT_COUNT; k++){
+		if (fds[k] < 0){ continue; }
+		values.counts[k] = static_cast<long long>(data[3 + slots[k]]);
+	}
+}
+
+long long PerfCounters::delta(const Values& end, const Values& start,
+	Event event){
+	long long endCount = end.counts[event];
+	long long startCount = start.counts[event];
+	if (endCount < 0 || startCount < 0){ return -1; }
+	unsigned long long running = end.running - start.running;
+	unsigned long long enabled = end.enabled - start.enabled;
+	//A group that never ran in the interval counted nothing
+	if (running == 0){ return 0; }
+	double scaled = static_cast<double>(endCount - startCount)
+	  * static_cast<double>(enabled) / static_cast<double>(running);
+	return static_cast<long long>(scaled);
+}
+
+}
@@ -0,0 +1,82 @@
+#ifndef CRONA_PERF_COUNTERS
+#define CRONA_PERF_COUNTERS
+
+#include <string>
+
+namespace crona{
+
+// Hardware event counters for the calling thread, opened with
+// perf_event_open: cycles, instructions, L1 data cache read
+// misses, last level cache misses and branch misses. They count
+// user-space events only, which is all that an unprivileged
+// process may count.
+//
+// The counters are opened as one group, so the kernel schedules
+// them onto the hardware together and one read returns them all
+// at the same instant. When the group has to share the hardware
+// with other counters it runs only part of the time; each read
+// gives the raw counts with the time the group was enabled and
+// the time it was running, and the difference between two reads
+// is scaled up by the ratio of those times over that interval.
+//
+// Counters are often unavailable: in containers and virtual
+// machines, under a strict perf_event_paranoid setting, or on
+// hardware without a given event. Each counter that can't be
+// opened is left out, and the reason is kept, so a caller can
+// say why rather than fail.
+class PerfCounters{
+public:
+	enum Event{
+		CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES,
+		EVENT_COUNT
+	};
+	static const char * eventName(Event event);
+
+	//Raw counts of each event so far, with the nanoseconds the
+	// group has been enabled and running. A count is -1 if its
+	// counter is unavailable.
+	class Values{
+	public:
+		Values() : enabled(0), running(0){
+			for (size_t k = 0; k < EVENT_COUNT; k++){ counts[k] = -1; }
+		}
+		long long counts[EVENT_COUNT];
+		unsigned long long enabled;
+		unsigned long long running;
+	};
+
+	//How many times event happened between two reads, scaled
+	// to the whole of the time between them, or -1 if it wasn't
+	// counted at both
+	static long long delta(const Values& end, const Values& start,
+		Event event);
+
+	//Open and start every counter that can be opened, counting
+	// events on the calling thread
+	PerfCounters();
+	~PerfCounters();
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	bool available(Event event) const { return fds[event] >= 0; }
+	bool anyAvailable() const;
+	//Why the first counter that couldn't be opened wasn't
+	const std::string& whyUnavailable() const { return why; }
+
+	//Read every counter. Must be called on the thread that
+	// opened them.
+	void read(Values& values) const;
+
+private:
+	int fds[EVENT_COUNT];
+	//Where each event's count comes in a read of the group
+	size_t slots[EVENT_COUNT];
+	size_t members;
+	//The first counter opened, which leads the group
+	int leader;
+	std::string why;
+};
+
+}
+
+#endif
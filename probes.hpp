@@ -0,0 +1,42 @@
+#ifndef CRONA_PROBES
+#define CRONA_PROBES
+
+// Static tracepoints for attaching bpftrace, perf or SystemTap to
+// a running cronac, in the provider "cronac":
+//
+//   lex__start(file), lex__end(file)       scanning for -t
+//   parse__start(file), parse__end(file, ok)
+//   name__start(fn), name__end(fn, ok)     each function's name analysis
+//   type__start(fn), type__end(fn)         each function's type analysis
+//   diagnostic(line, col, msg)             each Report::fatal
+//   file__open(file), file__close(file, status)
+//
+// Strings are passed as char pointers. For example, to see how
+// long type analysis of each function takes:
+//
+//   bpftrace -e 'usdt:./cronac:cronac:type__start { @s[tid] = nsecs; }
+//     usdt:./cronac:cronac:type__end /@s[tid]/ {
+//     @[str(arg0)] = hist(nsecs - @s[tid]); delete(@s[tid]); }'
+//
+// A probe is a single nop and a note in the binary, so it costs
+// nothing until a tracer attaches. The probes are built in when
+// the make file finds <sys/sdt.h> (systemtap-sdt-dev), and expand
+// to nothing otherwise.
+
+#ifdef CRONA_SDT
+
+#include <sys/sdt.h>
+
+#define CRONA_PROBE1(name, a) DTRACE_PROBE1(cronac, name, a)
+#define CRONA_PROBE2(name, a, b) DTRACE_PROBE2(cronac, name, a, b)
+#define CRONA_PROBE3(name, a, b, c) DTRACE_PROBE3(cronac, name, a, b, c)
+
+#else
+
+#define CRONA_PROBE1(name, a)
+#define CRONA_PROBE2(name, a, b)
+#define CRONA_PROBE3(name, a, b, c)
+
+#endif
+
+#endif
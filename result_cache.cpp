@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+#include "errors.hpp"
+#include "content_hash.hpp"
+#include "result_cache.hpp"
+
+namespace crona{
+
+//Bump whenever the entry format or the meaning of any
+// cached output changes
+static const char * FORMAT = "CRONAC-CACHE 2";
+
+//Entry files are named by 16 hex digits; anything else in
+// the directory is left alone
+//How long a scratch file may sit before it is removed even if
+// its process still seems to exist
+static const time_t STALE_SCRATCH_SECONDS = 24 * 60 * 60;
+
+static bool isEntryName(const std::string& name){
+	if (name.size() != 16){ return false; }
+	for (char c : name){
+		if (!isxdigit(static_cast<unsigned char>(c))){ return false; }
+	}
+	return true;
+}
+
+//Results are only valid for the compiler that produced them,
+// so the executable is part of every key. Its path, size and
+// modification time stand in for its bytes, which are too many
+// to hash in every process.
+static std::string compilerIdentity(){
+	static const std::string identity = [](){
+		char path[4096];
+		ssize_t len = readlink("/proc/self/exe", path, sizeof(path));
+		struct stat info;
+		if (len > 0 && stat("/proc/self/exe", &info) == 0){
+			return std::string(path, static_cast<size_t>(len)) + " "
+			  + std::to_string(info.st_dev) + " " 
+			  + std::to_string(info.st_ino) + " "
+			  + std::to_string(info.st_size) + " "
+			  + std::to_string(info.st_mtim.tv_sec) + "." 
+			  + std::to_string(info.st_mtim.tv_nsec);
+		}
+		return std::string(__DATE__ " " __TIME__);
+	}();
+	return identity;
+}
+
+//Scratch files are named "tmp.<pid>.<n>". One whose process no
+// longer exists, or that has sat for a day, was left behind.
+static bool isStaleScratch(const std::string& name, time_t modified){
+	if (name.compare(0, 4, "tmp.") != 0){ return false; }
+	char * end;
+	long owner = strtol(name.c_str() + 4, &end, 10);
+	if (end == name.c_str() + 4 || *end != '.'){ return false; }
+	if (owner == getpid()){ return false; }
+	if (time(nullptr) - modified > STALE_SCRATCH_SECONDS){ 
+		return true;
+	}
+	return owner <= 0 
+	  || (kill(static_cast<pid_t>(owner), 0) != 0 && errno == ESRCH);
+}
+
+ResultCache::ResultCache(const std::string& dirIn, size_t maxBytesIn)
+: dir(dirIn), maxBytes(maxBytesIn), hits(0), misses(0), nextScratch(0),
+  measured(false), estimate(0){
+	if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST){
+		std::string msg = "Cannot create cache directory " + dir;
+		throw new InternalError(msg.c_str());
+	}
+}
+
+//Each piece is preceded by its length, as ContentHash does, so
+// no two different sets of pieces give the same key
+static void addKeyPiece(std::string& key, const std::string& piece){
+	key += std::to_string(piece.size());
+	key += ":";
+	key += piece;
+}
+
+std::string ResultCache::key(const std::string& source, 
+	const std::string& flags){
+	std::string key;
+	addKeyPiece(key, FORMAT);
+	addKeyPiece(key, compilerIdentity());
+	addKeyPiece(key, flags);
+	addKeyPiece(key, source);
+	return key;
+}
+
+std::string ResultCache::entryPath(const std::string& key){
+	ContentHash hash;
+	hash.add(key);
+	return dir + "/" + hash.hex();
+}
+
+std::string ResultCache::scratchPath(){
+	return dir + "/tmp." + std::to_string(getpid()) + "." 
+	  + std::to_string(nextScratch++);
+}
+
+static void writeSection(std::ostream& out, const char * name, 
+	const std::string& text){
+	out << name << " " << text.size() << "\n" << text << "\n";
+}
+
+static bool readSection(std::istream& in, const char * name, 
+	std::string& text){
+	std::string found;
+	size_t len;
+	if (!(in >> found >> len) || found != name){ return false; }
+	if (in.get() != '\n'){ return false; }
+	text.resize(len);
+	if (len > 0 && !in.read(&text[0], static_cast<std::streamsize>(len))){
+		return false;
+	}
+	return in.get() == '\n';
+}
+
+bool ResultCache::lookup(const std::string& key, Entry& entry){
+	std::string path = entryPath(key);
+	std::ifstream in(path, std::ios::binary);
+	std::string header;
+	std::string stored;
+	bool found = in.good() && std::getline(in, header) 
+	  && header == FORMAT
+	  && readSection(in, "key", stored) && stored == key
+	  && (in >> header >> entry.status) && header == "status"
+	  && in.get() == '\n'
+	  && (in >> header >> entry.hasUnparsed >> entry.hasNames)
+	  && header == "outputs" && in.get() == '\n'
+	  && readSection(in, "err", entry.err)
+	  && readSection(in, "out", entry.out)
+	  && readSection(in, "unparsed", entry.unparsed)
+	  && readSection(in, "names", entry.names);
+	if (!found){
+		misses++;
+		return false;
+	}
+	hits++;
+	//Touch the entry, so eviction sees it was just used
+	utimes(path.c_str(), nullptr);
+	return true;
+}
+
+void ResultCache::store(const std::string& key, const Entry& entry){
+	std::string scratch = scratchPath();
+	size_t bytes;
+	{
+		std::ofstream out(scratch, std::ios::binary);
+		out << FORMAT << "\n";
+		writeSection(out, "key", key);
+		out << "status " << entry.status << "\n";
+		out << "outputs " << entry.hasUnparsed << " " 
+		  << entry.hasNames << "\n";
+		writeSection(out, "err", entry.err);
+		writeSection(out, "out", entry.out);
+		writeSection(out, "unparsed", entry.unparsed);
+		writeSection(out, "names", entry.names);
+		out.flush();
+		if (!out.good()){
+			unlink(scratch.c_str());
+			return;
+		}
+		bytes = static_cast<size_t>(out.tellp());
+	}
+	if (rename(scratch.c_str(), entryPath(key).c_str()) != 0){
+		unlink(scratch.c_str());
+		return;
+	}
+	grew(bytes);
+}
+
+void ResultCache::grew(size_t bytes){
+	std::lock_guard<std::mutex> guard(sizing);
+	if (!measured){
+		//The first store measures the directory, which already
+		// holds the new entry
+		size_t entries;
+		estimate = survey(nullptr, entries);
+		measured = true;
+	} else {
+		//A replaced entry is counted twice until the next
+		// survey, which only makes eviction come sooner
+		estimate += bytes;
+	}
+	if (estimate > maxBytes){ evict(); }
+}
+
+size_t ResultCache::survey(std::vector<Aged> * aged, 
+	size_t& entries){
+	size_t total = 0;
+	entries = 0;
+	DIR * listing = opendir(dir.c_str());
+	if (listing == nullptr){ return 0; }
+	while (dirent * item = readdir(listing)){
+		std::string name = item->d_name;
+		bool entry = isEntryName(name);
+		if (!entry && name.compare(0, 4, "tmp.") != 0){ continue; }
+		struct stat info;
+		std::string path = dir + "/" + name;
+		if (stat(path.c_str(), &info) != 0){ continue; }
+		if (!entry){
+			if (isStaleScratch(name, info.st_mtime)){
+				unlink(path.c_str());
+			} else {
+				//A scratch file in use takes space all the same
+				total += static_cast<size_t>(info.st_size);
+			}
+			continue;
+		}
+		total += static_cast<size_t>(info.st_size);
+		entries++;
+		if (aged == nullptr){ continue; }
+		Aged found;
+		found.path = path;
+		found.used = info.st_mtime;
+		found.size = static_cast<size_t>(info.st_size);
+		aged->push_back(found);
+	}
+	closedir(listing);
+	return total;
+}
+
+void ResultCache::evict(){
+	std::vector<Aged> aged;
+	size_t entries;
+	size_t total = survey(&aged, entries);
+	size_t lowWater = maxBytes - maxBytes / 4;
+	if (total > maxBytes){
+		std::sort(aged.begin(), aged.end(), 
+		  [](const Aged& a, const Aged& b){
+			return a.used < b.used;
+		});
+		//Another process may be evicting at the same time, in
+		// which case some of these are already gone
+		for (auto& entry : aged){
+			if (total <= lowWater){ break; }
+			unlink(entry.path.c_str());
+			total -= entry.size;
+		}
+	}
+	estimate = total;
+}
+
+void ResultCache::report(std::ostream& out){
+	size_t entries;
+	size_t bytes;
+	{
+		std::lock_guard<std::mutex> guard(sizing);
+		bytes = survey(nullptr, entries);
+	}
+	out << "cache: " << hits << " hits, " << misses << " misses, "
+	  << entries << " entries, " << bytes << " bytes\n";
+}
+
+}
@@ -0,0 +1,98 @@
+#ifndef CRONA_RESULT_CACHE
+#define CRONA_RESULT_CACHE
+
+#include <atomic>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace crona{
+
+// An on-disk cache of compile results, shared by every cronac
+// process pointed at the same directory. Each entry is one file
+// named by a hash of its key: the source bytes, the cronac
+// executable and the flags and imports that shaped the result.
+// It holds the key itself, which a lookup compares in full so
+// that two keys with the same hash never share a result, then
+// the exit status, the diagnostics and status text, and the
+// unparsed (-u) and name-annotated (-n) programs.
+//
+// Entries are written to a private temporary file and renamed
+// into place, so a reader sees either a whole entry or none.
+// Each process keeps a running estimate of the directory's size,
+// measured once and then grown by every store. Only when the
+// estimate passes the size bound is the directory listed again,
+// and then the entries used least recently are removed until it
+// is a quarter below the bound, so a batch of stores lists it
+// only now and then. Scratch files left behind by processes that
+// died are counted and removed at the same time.
+class ResultCache{
+public:
+	ResultCache(const std::string& dirIn, size_t maxBytesIn);
+
+	class Entry{
+	public:
+		Entry() : status(0), hasUnparsed(false), hasNames(false){ }
+		int status;
+		std::string err;
+		std::string out;
+		//Whether the run wrote the -u and -n outputs at all
+		bool hasUnparsed;
+		bool hasNames;
+		std::string unparsed;
+		std::string names;
+	};
+
+	//The key for compiling source with the given flags, which
+	// holds all of both
+	static std::string key(const std::string& source, 
+		const std::string& flags);
+
+	//Fill entry from the cache, returning false on a miss
+	bool lookup(const std::string& key, Entry& entry);
+	void store(const std::string& key, const Entry& entry);
+
+	//A path in the cache directory no other thread or process
+	// will use, for staging output
+	std::string scratchPath();
+
+	//Write the hit and miss counts of this process and the
+	// size of the cache to out
+	void report(std::ostream& out);
+
+	static const size_t DEFAULT_MAX_BYTES = 64 * 1024 * 1024;
+
+private:
+	class Aged{
+	public:
+		std::string path;
+		time_t used;
+		size_t size;
+	};
+
+	std::string entryPath(const std::string& key);
+	//Add a stored entry of the given size to the estimate, and
+	// evict if that takes it past the bound
+	void grew(size_t bytes);
+	//Remove least recently used entries until the directory
+	// is a quarter below its bound
+	void evict();
+	//List the entries (into aged, if given) and return their
+	// total size, removing stale scratch files on the way
+	size_t survey(std::vector<Aged> * aged, size_t& entries);
+
+	std::string dir;
+	size_t maxBytes;
+	std::atomic<size_t> hits;
+	std::atomic<size_t> misses;
+	std::atomic<size_t> nextScratch;
+	//Guards the estimate and eviction
+	std::mutex sizing;
+	bool measured;
+	size_t estimate;
+};
+
+}
+
+#endif
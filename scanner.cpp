@@ -9,17 +9,22 @@ using Lexeme = crona::Parser::semantic_type;
 void Scanner::outputTokens(std::ostream& outstream){
 	Lexeme lexeme;
 	int tokenKind;
+	OutBuffer out(&outstream);
 	while(true){
 		tokenKind = this->yylex(&lexeme);
 		if (tokenKind == TokenKind::END){
-			outstream << "EOF" 
-			  << " [" << this->lineNum 
-			  << "," << this->colNum << "]"
-			  << std::endl;
+			out.put("EOF [");
+			out.putUInt(this->lineNum);
+			out.put(',');
+			out.putUInt(this->colNum);
+			out.put("]\n");
+			out.flush();
+			outstream.flush();
 			return;
 		} else {
-			outstream << lexeme.transToken->toString()
-			  << std::endl;
+			lexeme.transToken->write(out);
+			out.put('\n');
+			delete lexeme.transToken;
 		}
 	}
 }
@@ -5,8 +5,10 @@
 #include <FlexLexer.h>
 #endif
 
+#include <list>
 #include "grammar.hh"
 #include "errors.hpp"
+#include "time_report.hpp"
 
 using TokenKind = crona::Parser::token;
 
@@ -22,6 +24,9 @@ public:
 	hasError = false;
    };
    virtual ~Scanner() {
+	for (auto token : issued){
+		delete token;
+	}
    };
 
    //get rid of override virtual function warning
@@ -30,6 +35,39 @@ public:
    // YY_DECL defined in the flex crona.l
    virtual int yylex( crona::Parser::semantic_type * const lval);
 
+   //The parser reads its tokens through here, so that the 
+   // scanner owns every token it has handed out. Nodes copy
+   // what they need from their tokens, so the tokens only have
+   // to live until the rule using them has been reduced. The
+   // parser releases them after each top-level declaration,
+   // so at most one declaration's tokens are held at a time.
+   int lex(crona::Parser::semantic_type * const lval){
+	int kind;
+	CRONA_ALLOC_TAG(TOKENS);
+	TimeReport * report = TimeReport::current();
+	if (report == nullptr){
+		kind = yylex(lval);
+	} else {
+		auto start = std::chrono::steady_clock::now();
+		kind = yylex(lval);
+		report->addScanTime(std::chrono::steady_clock::now() - start);
+	}
+	if (kind != TokenKind::END){
+		issued.push_back(lval->transToken);
+	}
+	return kind;
+   }
+
+   //Delete every token but the last one read, which may be
+   // the parser's lookahead. Only safe between top-level 
+   // declarations, when no rule holds any token.
+   void releaseTokens(){
+	while (issued.size() > 1){
+		delete issued.front();
+		issued.pop_front();
+	}
+   }
+
    int makeBareToken(int tagIn){
         this->yylval->transToken = new Token(
 	  this->lineNum, this->colNum, tagIn);
@@ -69,21 +107,28 @@ public:
    }
 
    void warn(int lineNumIn, int colNumIn, std::string msg){
-	std::cerr << lineNumIn << ":" << colNumIn 
-		<< " ***WARNING*** " << msg << std::endl;
+	Report::record(DiagnosticEngine::SCAN_WARNING, 
+		static_cast<size_t>(lineNumIn), 
+		static_cast<size_t>(colNumIn), msg);
    }
 
    void error(int lineNumIn, int colNumIn, std::string msg){
-	std::cerr << lineNumIn << ":" << colNumIn 
-		<< " ***ERROR*** " << msg << std::endl;
+	Report::record(DiagnosticEngine::SCAN_ERROR, 
+		static_cast<size_t>(lineNumIn), 
+		static_cast<size_t>(colNumIn), msg);
    }
 
+   //Where the scanner has read up to
+   size_t getLine() const { return lineNum; }
+   size_t getCol() const { return colNum; }
+
    static std::string tokenKindString(int tokenKind);
 
    void outputTokens(std::ostream& outstream);
 
 private:
    crona::Parser::semantic_type *yylval = nullptr;
+   std::list<Token *> issued;
    size_t lineNum;
    size_t colNum;
    bool hasError;
@@ -0,0 +1,410 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "errors.hpp"
+#include "content_hash.hpp"
+#include "server.hpp"
+
+namespace crona{
+
+//Requests and answers are sequences of 32-bit words and of
+// strings, each string sent as its length followed by its bytes.
+// A request is a count of strings, then the working directory,
+// then the arguments. An answer is the exit status, then the
+// stderr text, then the stdout text.
+
+static bool writeAll(int fd, const char * buf, size_t len){
+	while (len > 0){
+		ssize_t done = send(fd, buf, len, MSG_NOSIGNAL);
+		if (done < 0 && errno == EINTR){ continue; }
+		if (done <= 0){ return false; }
+		buf += done;
+		len -= static_cast<size_t>(done);
+	}
+	return true;
+}
+
+static bool readAll(int fd, char * buf, size_t len){
+	while (len > 0){
+		ssize_t done = recv(fd, buf, len, 0);
+		if (done < 0 && errno == EINTR){ continue; }
+		if (done <= 0){ return false; }
+		buf += done;
+		len -= static_cast<size_t>(done);
+	}
+	return true;
+}
+
+static bool putWord(int fd, uint32_t word){
+	return writeAll(fd, reinterpret_cast<const char *>(&word), 4);
+}
+
+static bool putString(int fd, const std::string& str){
+	if (!putWord(fd, static_cast<uint32_t>(str.size()))){ 
+		return false;
+	}
+	return writeAll(fd, str.data(), str.size());
+}
+
+static bool getWord(int fd, uint32_t& word){
+	return readAll(fd, reinterpret_cast<char *>(&word), 4);
+}
+
+static bool getString(int fd, std::string& str){
+	uint32_t len;
+	if (!getWord(fd, len)){ return false; }
+	str.resize(len);
+	if (len == 0){ return true; }
+	return readAll(fd, &str[0], len);
+}
+
+static bool socketAddress(const char * path, sockaddr_un& addr){
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)){ return false; }
+	strcpy(addr.sun_path, path);
+	return true;
+}
+
+static std::string readFile(FILE * file){
+	std::string text;
+	rewind(file);
+	char buf[4096];
+	size_t got;
+	while ((got = fread(buf, 1, sizeof(buf), file)) > 0){
+		text.append(buf, got);
+	}
+	return text;
+}
+
+//Written to from the SIGCHLD handler, so that the serving loop
+// wakes up to reap children while it waits for clients
+static int childPipe[2] = { -1, -1 };
+
+static void childExited(int){
+	int saved = errno;
+	char byte = 0;
+	ssize_t ignored = write(childPipe[1], &byte, 1);
+	(void)ignored;
+	errno = saved;
+}
+
+int Server::serve(const char * path){
+	sockaddr_un addr;
+	if (!socketAddress(path, addr)){
+		std::cerr << "Socket path too long: " << path << std::endl;
+		return 1;
+	}
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0){
+		std::cerr << "Cannot create socket: " 
+		  << strerror(errno) << std::endl;
+		return 1;
+	}
+	//A socket left behind by an earlier server is replaced
+	unlink(path);
+	sockaddr * generic = reinterpret_cast<sockaddr *>(&addr);
+	//Requests run with the server's rights, so only its owner
+	// may connect
+	if (bind(listener, generic, sizeof(addr)) != 0 
+	  || chmod(path, 0600) != 0
+	  || listen(listener, 64) != 0){
+		std::cerr << "Cannot listen on " << path << ": " 
+		  << strerror(errno) << std::endl;
+		close(listener);
+		return 1;
+	}
+	if (pipe(childPipe) != 0){
+		std::cerr << "Cannot create pipe: " 
+		  << strerror(errno) << std::endl;
+		close(listener);
+		return 1;
+	}
+	fcntl(childPipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(childPipe[1], F_SETFL, O_NONBLOCK);
+	signal(SIGPIPE, SIG_IGN);
+	struct sigaction onChild;
+	memset(&onChild, 0, sizeof(onChild));
+	onChild.sa_handler = childExited;
+	onChild.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+	sigaction(SIGCHLD, &onChild, nullptr);
+
+	if (preload){ preload(); }
+	std::cout.flush();
+	std::cerr.flush();
+
+	while (true){
+		pollfd waits[2];
+		waits[0].fd = listener;
+		waits[0].events = POLLIN;
+		waits[1].fd = childPipe[0];
+		waits[1].events = POLLIN;
+		if (poll(waits, 2, -1) < 0){
+			if (errno == EINTR){ continue; }
+			std::cerr << "poll failed: " 
+			  << strerror(errno) << std::endl;
+			continue;
+		}
+		if (waits[1].revents != 0){
+			char drain[64];
+			while (read(childPipe[0], drain, sizeof(drain)) > 0){ }
+			reap();
+		}
+		if ((waits[0].revents & POLLIN) == 0){ continue; }
+		int client = accept(listener, nullptr, nullptr);
+		if (client < 0){
+			if (errno == EINTR){ continue; }
+			std::cerr << "accept failed: " 
+			  << strerror(errno) << std::endl;
+			continue;
+		}
+		handle(client);
+	}
+}
+
+//Reads one request from client and either answers it at once,
+// or starts a child for it and leaves client open until the
+// child has been reaped
+void Server::handle(int client){
+	uint32_t count;
+	std::string cwd;
+	Args args;
+	bool received = getWord(client, count) && count != 0
+	  && getString(client, cwd);
+	for (uint32_t k = 1; received && k < count; k++){
+		std::string arg;
+		received = getString(client, arg);
+		args.push_back(arg);
+	}
+	if (!received){
+		close(client);
+		return;
+	}
+
+	Answer answer;
+	if (args.size() == 1 && args[0] == "--server-stats"){
+		answer.out = "hits: " + std::to_string(hits)
+		  + "\nmisses: " + std::to_string(misses)
+		  + "\nremembered: " + std::to_string(answers.size()) 
+		  + "\nrunning: " + std::to_string(running.size()) + "\n";
+		answerClient(client, answer);
+		return;
+	}
+	std::string key;
+	bool keyed = cacheable(args) && requestKey(cwd, args, key);
+	auto found = keyed ? answers.find(key) : answers.end();
+	if (found != answers.end()){
+		hits++;
+		answerClient(client, found->second);
+		return;
+	}
+	misses++;
+	if (!start(client, cwd, args, keyed, key)){
+		answer.status = 1;
+		answer.err = "cronac server: could not run request\n";
+		answerClient(client, answer);
+	}
+}
+
+void Server::answerClient(int client, const Answer& answer){
+	putWord(client, static_cast<uint32_t>(answer.status));
+	putString(client, answer.err);
+	putString(client, answer.out);
+	close(client);
+}
+
+bool Server::start(int client, const std::string& cwd, 
+	const Args& args, bool keyed, const std::string& key){
+	FILE * errFile = tmpfile();
+	FILE * outFile = tmpfile();
+	if (errFile == nullptr || outFile == nullptr){
+		if (errFile != nullptr){ fclose(errFile); }
+		if (outFile != nullptr){ fclose(outFile); }
+		return false;
+	}
+
+	std::cout.flush();
+	std::cerr.flush();
+	pid_t child = fork();
+	if (child == 0){
+		//The child has no use for the server's own descriptors
+		// or for the other clients waiting on their answers
+		signal(SIGCHLD, SIG_DFL);
+		close(childPipe[0]);
+		close(childPipe[1]);
+		for (auto& other : running){ close(other.second.client); }
+		close(client);
+		//The compile may also leave through exit(), which
+		// flushes the standard streams into the files
+		dup2(fileno(errFile), 2);
+		dup2(fileno(outFile), 1);
+		if (chdir(cwd.c_str()) != 0){
+			std::cerr << "Bad directory " << cwd << std::endl;
+			exit(1);
+		}
+		int status = compile(args);
+		exit(status);
+	}
+	if (child < 0){
+		fclose(errFile);
+		fclose(outFile);
+		return false;
+	}
+
+	Running& request = running[child];
+	request.client = client;
+	request.keyed = keyed;
+	request.key = key;
+	request.errFile = errFile;
+	request.outFile = outFile;
+	return true;
+}
+
+//Answers the clients of every child that has exited, without
+// waiting for the ones still running
+void Server::reap(){
+	int status;
+	pid_t child;
+	while ((child = waitpid(-1, &status, WNOHANG)) > 0){
+		auto found = running.find(child);
+		if (found == running.end()){ continue; }
+		finish(found->second, status);
+		running.erase(found);
+	}
+}
+
+void Server::finish(Running& request, int status){
+	Answer answer;
+	if (WIFEXITED(status)){
+		answer.status = WEXITSTATUS(status);
+	} else {
+		answer.status = 1;
+	}
+	answer.err = readFile(request.errFile);
+	answer.out = readFile(request.outFile);
+	if (WIFSIGNALED(status)){
+		answer.err += "cronac server: request killed by signal ";
+		answer.err += std::to_string(WTERMSIG(status)) + "\n";
+	} else if (request.keyed){
+		remember(request.key, answer);
+	}
+	fclose(request.errFile);
+	fclose(request.outFile);
+	answerClient(request.client, answer);
+}
+
+static bool addContents(ContentHash& hash, const std::string& path){
+	std::ifstream file(path, std::ios::binary);
+	if (!file.good()){ return false; }
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	hash.add(path);
+	hash.add(contents.str());
+	return true;
+}
+
+//A source's import declarations name interfaces beside it, so
+// every interface in the directory of a named file is hashed too
+static bool addInterfaces(ContentHash& hash, const std::string& path,
+	std::set<std::string>& dirsSeen){
+	std::string dir = path.substr(0, path.find_last_of('/') + 1);
+	if (!dirsSeen.insert(dir).second){ return true; }
+	DIR * listing = opendir(dir.c_str());
+	if (listing == nullptr){ return true; }
+	std::vector<std::string> names;
+	while (dirent * item = readdir(listing)){
+		std::string name = item->d_name;
+		if (name.size() > 4 
+		  && name.compare(name.size() - 4, 4, ".cri") == 0){
+			names.push_back(name);
+		}
+	}
+	closedir(listing);
+	//Listing order is not stable, so hash in name order
+	std::sort(names.begin(), names.end());
+	for (auto& name : names){
+		if (!addContents(hash, dir + name)){ return false; }
+	}
+	return true;
+}
+
+bool Server::requestKey(const std::string& cwd, const Args& args, 
+	std::string& key){
+	ContentHash hash;
+	hash.add(cwd);
+	std::set<std::string> dirsSeen;
+	for (auto arg : args){
+		hash.add(arg);
+		std::string path = arg;
+		if (path.empty() || path[0] != '/'){ path = cwd + "/" + arg; }
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)){
+			continue;
+		}
+		if (!addContents(hash, path)){ return false; }
+		if (!addInterfaces(hash, path, dirsSeen)){ return false; }
+	}
+	key = hash.hex();
+	return true;
+}
+
+void Server::remember(const std::string& key, const Answer& answer){
+	if (answers.size() >= MAX_REMEMBERED){
+		answers.erase(answerOrder.front());
+		answerOrder.pop_front();
+	}
+	answers[key] = answer;
+	answerOrder.push_back(key);
+}
+
+bool Server::forward(const char * path, const Args& args, 
+	int& status){
+	sockaddr_un addr;
+	if (!socketAddress(path, addr)){ return false; }
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server < 0){ return false; }
+	sockaddr * generic = reinterpret_cast<sockaddr *>(&addr);
+	if (connect(server, generic, sizeof(addr)) != 0){
+		close(server);
+		return false;
+	}
+
+	char * cwd = getcwd(nullptr, 0);
+	bool sent = cwd != nullptr
+	  && putWord(server, static_cast<uint32_t>(args.size() + 1))
+	  && putString(server, cwd);
+	free(cwd);
+	for (auto arg : args){
+		sent = sent && putString(server, arg);
+	}
+
+	uint32_t answerStatus = 1;
+	std::string err;
+	std::string out;
+	bool answered = sent && getWord(server, answerStatus)
+	  && getString(server, err) && getString(server, out);
+	close(server);
+	if (!answered){ return false; }
+
+	std::cerr << err;
+	std::cout << out;
+	status = static_cast<int>(answerStatus);
+	return true;
+}
+
+}
@@ -0,0 +1,112 @@
+#ifndef CRONA_SERVER
+#define CRONA_SERVER
+
+#include <cstdio>
+#include <functional>
+#include <list>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <sys/types.h>
+
+namespace crona{
+
+// A compile server listens on a Unix socket and runs cronac
+// command lines sent to it by clients, so that repeated runs pay
+// for process start-up only once. Each request names the
+// client's working directory and its arguments, and is answered
+// with the exit status and everything the run wrote to stderr
+// and stdout.
+//
+// Every request is run in a forked child of the server. The
+// child changes to the client's directory and captures its
+// output in temporary files, and all the memory the compilation
+// allocated is released when the child exits. Children start
+// from the server's image, so whatever the server preloaded
+// before its first request (iostreams, the type flyweights, the
+// target layouts) is warm. The server keeps accepting while
+// children run, and answers each client as its child exits.
+//
+// The server remembers the answer to each request that writes
+// no files, keyed by a hash of its directory, its arguments, the
+// contents of every file its arguments name and of every module
+// interface beside those files. A repeated
+// request on unchanged inputs is answered from memory without
+// forking at all. The request "--server-stats" is answered with
+// counts of the requests answered from memory and by running.
+class Server{
+public:
+	typedef std::vector<std::string> Args;
+	//Runs one command line (without the program name) and
+	// returns its exit status
+	typedef std::function<int(const Args&)> Compile;
+	//Whether the output of a command line depends only on
+	// the files it names, so that it is safe to remember
+	typedef std::function<bool(const Args&)> Cacheable;
+	//Sets up, once in the server itself, whatever state every
+	// request would otherwise build for itself
+	typedef std::function<void()> Preload;
+
+	Server(Compile compileIn, Cacheable cacheableIn, Preload preloadIn)
+	: compile(compileIn), cacheable(cacheableIn), preload(preloadIn),
+	  hits(0), misses(0){ }
+
+	//Serve requests on the socket at path until killed. Only
+	// returns, with an error message written, if the socket
+	// cannot be set up. The socket is made accessible to its
+	// owner only.
+	int serve(const char * path);
+
+	//Send a command line to the server at path and relay its
+	// answer to this process's stderr and stdout. Returns false,
+	// having written nothing, if no server is listening there.
+	static bool forward(const char * path, const Args& args, 
+		int& status);
+
+	//The most answers kept in memory at once
+	static const size_t MAX_REMEMBERED = 512;
+
+private:
+	class Answer{
+	public:
+		Answer() : status(0){ }
+		int status;
+		std::string err;
+		std::string out;
+	};
+
+	//A request whose child has not exited yet
+	class Running{
+	public:
+		int client;
+		bool keyed;
+		std::string key;
+		FILE * errFile;
+		FILE * outFile;
+	};
+
+	void handle(int client);
+	bool start(int client, const std::string& cwd, const Args& args, 
+		bool keyed, const std::string& key);
+	void reap();
+	void finish(Running& request, int status);
+	static void answerClient(int client, const Answer& answer);
+	bool requestKey(const std::string& cwd, const Args& args, 
+		std::string& key);
+	void remember(const std::string& key, const Answer& answer);
+
+	Compile compile;
+	Cacheable cacheable;
+	Preload preload;
+	//Requests being run, by the pid of their child
+	std::unordered_map<pid_t, Running> running;
+	std::unordered_map<std::string, Answer> answers;
+	//Keys in the order they were remembered, oldest first
+	std::list<std::string> answerOrder;
+	size_t hits;
+	size_t misses;
+};
+
+}
+
+#endif
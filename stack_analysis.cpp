@@ -0,0 +1,168 @@
+#include "ast.hpp"
+#include "symbol_table.hpp"
+#include "errors.hpp"
+#include "stack_analysis.hpp"
+
+namespace crona{
+
+StackAnalysis * StackAnalysis::build(Layout * layout, CallGraph * graph){
+	//Frame sizes come from the layout and edges from the
+	// call graph, which must describe the same program
+	TimeReport::PhaseTimer timer("stack analysis");
+	StackAnalysis * analysis = new StackAnalysis(layout, graph);
+	size_t linkage = layout->getTarget()->linkageSize();
+
+	for (auto frame : *layout->getFrames()){
+		FnStack * fnStack = new FnStack();
+		fnStack->frame = frame->size;
+		analysis->stacks[frame->fn] = fnStack;
+	}
+
+	for (auto scc : *graph->getSCCs()){
+		//Every member of a component can reach every call
+		// the others make, imported or not
+		bool complete = true;
+		for (auto fn : scc->members){
+			if (!graph->importedCallees(fn)->empty()){
+				complete = false;
+			}
+			for (auto callee : *graph->callees(fn)){
+				if (graph->sccOf(callee) == scc){ continue; }
+				if (!analysis->stackOf(callee)->complete){
+					complete = false;
+				}
+			}
+		}
+		for (auto fn : scc->members){
+			FnStack * fnStack = analysis->stackOf(fn);
+			fnStack->complete = complete;
+			fnStack->bounded = !scc->recursive && complete;
+			size_t deepestCallee = 0;
+			for (auto callee : *graph->callees(fn)){
+				if (graph->sccOf(callee) == scc){ continue; }
+				FnStack * calleeStack = analysis->stackOf(callee);
+				if (!calleeStack->bounded){
+					fnStack->bounded = false;
+				}
+				if (fnStack->deepest == nullptr
+				  || calleeStack->worst > deepestCallee){
+					deepestCallee = calleeStack->worst;
+					fnStack->deepest = callee;
+				}
+			}
+			fnStack->worst = fnStack->frame + linkage + deepestCallee;
+		}
+	}
+	if (Census * census = Census::current()){
+		census->hashMap("stack frames", analysis->stacks);
+	}
+	return analysis;
+}
+
+StackAnalysis::FnStack * StackAnalysis::stackOf(FnSymbol * fn){
+	auto found = stacks.find(fn);
+	if (found == stacks.end()){
+		throw new InternalError("Function missing from layout");
+	}
+	return found->second;
+}
+
+void StackAnalysis::report(std::ostream& out, std::string entry){
+	out << "{\n";
+	out << "\"target\": \"" << layout->getTarget()->getName() << "\",\n";
+	out << "\"linkage\": " << layout->getTarget()->linkageSize() << ",\n";
+
+	FnSymbol * entryFn = graph->findFn(entry);
+	if (entryFn == nullptr){
+		out << "\"entry\": null,\n";
+	} else {
+		FnStack * entryStack = stackOf(entryFn);
+		out << "\"entry\": {\"name\": \"" << entry << "\", "
+		  << "\"worst\": " << entryStack->worst << ", "
+		  << "\"bounded\": " 
+		  << (entryStack->bounded ? "true" : "false") << ", "
+		  << "\"complete\": " 
+		  << (entryStack->complete ? "true" : "false") << ", "
+		  << "\"path\": [";
+		FnSymbol * onPath = entryFn;
+		bool first = true;
+		while (onPath != nullptr){
+			if (first){ first = false; }
+			else { out << ", "; }
+			out << "\"" << onPath->getName() << "\"";
+			CallGraph::SCC * scc = graph->sccOf(onPath);
+			if (scc->recursive){ break; }
+			onPath = stackOf(onPath)->deepest;
+		}
+		out << "]},\n";
+	}
+
+	out << "\"functions\": [";
+	bool firstFn = true;
+	for (auto frame : *layout->getFrames()){
+		FnStack * fnStack = stackOf(frame->fn);
+		out << (firstFn ? "\n" : ",\n");
+		firstFn = false;
+		out << "\t{\"name\": \"" << frame->fn->getName() << "\", "
+		  << "\"frame\": " << fnStack->frame << ", "
+		  << "\"worst\": " << fnStack->worst << ", "
+		  << "\"bounded\": " 
+		  << (fnStack->bounded ? "true" : "false") << ", "
+		  << "\"complete\": " 
+		  << (fnStack->complete ? "true" : "false") << ", "
+		  << "\"recursive\": "
+		  << (graph->sccOf(frame->fn)->recursive ? "true" : "false")
+		  << ", \"imported\": [";
+		bool firstImport = true;
+		for (auto callee : *graph->importedCallees(frame->fn)){
+			out << (firstImport ? "" : ", ") 
+			  << "\"" << callee->getName() << "\"";
+			firstImport = false;
+		}
+		out << "], \"deepest\": ";
+		if (fnStack->deepest == nullptr){
+			out << "null}";
+		} else {
+			out << "\"" << fnStack->deepest->getName() << "\"}";
+		}
+	}
+	out << "\n],\n";
+
+	out << "\"recursion\": [";
+	bool firstScc = true;
+	for (auto scc : *graph->getSCCs()){
+		if (!scc->recursive){ continue; }
+		out << (firstScc ? "" : ", ") << "[";
+		firstScc = false;
+		bool firstMember = true;
+		for (auto member : scc->members){
+			if (firstMember){ firstMember = false; }
+			else { out << ", "; }
+			out << "\"" << member->getName() << "\"";
+		}
+		out << "]";
+	}
+	out << "],\n";
+
+	out << "\"largeArrays\": [";
+	bool firstArr = true;
+	for (auto frame : *layout->getFrames()){
+		for (auto decl : frame->slots){
+			const DataType * type = decl->ID()->getSymbol()->getDataType();
+			if (!type->isArray()){ continue; }
+			size_t bytes = type->sizeIn(layout->getTarget());
+			if (bytes < LARGE_ARRAY_BYTES){ continue; }
+			out << (firstArr ? "\n" : ",\n");
+			firstArr = false;
+			out << "\t{\"function\": \"" << frame->fn->getName() << "\", "
+			  << "\"name\": \"" << decl->ID()->getName() << "\", "
+			  << "\"line\": " << decl->line() << ", "
+			  << "\"col\": " << decl->col() << ", "
+			  << "\"bytes\": " << bytes << "}";
+		}
+	}
+	out << (firstArr ? "]\n" : "\n]\n");
+	out << "}\n";
+}
+
+}
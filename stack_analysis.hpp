@@ -0,0 +1,62 @@
+#ifndef CRONA_STACK_ANALYSIS
+#define CRONA_STACK_ANALYSIS
+
+#include <ostream>
+#include "symbol_table.hpp"
+#include "layout.hpp"
+#include "call_graph.hpp"
+
+namespace crona{
+
+// Computes, for every function, the most stack that a call to
+// it can use: its own frame and call linkage, plus the worst
+// case of any function it calls. Components of the call graph
+// are visited callees-first, so each function and each edge is
+// looked at once. A function that can reach a recursive
+// component has no static bound, and is reported as unbounded.
+// So is one that can reach a call to an imported function, whose
+// stack use is not known here; it is also reported incomplete.
+class StackAnalysis {
+
+private:
+	StackAnalysis(Layout * layoutIn, CallGraph * graphIn)
+	: layout(layoutIn), graph(graphIn){ }
+
+public:
+	static StackAnalysis * build(Layout * layout, CallGraph * graph);
+
+	//Local arrays at least this many bytes long are called
+	// out in the report
+	static const size_t LARGE_ARRAY_BYTES = 1024;
+
+	class FnStack{
+	public:
+		FnStack() : frame(0), worst(0), bounded(true),
+		  complete(true), deepest(nullptr){ }
+		size_t frame;
+		//Only counts the functions in this program
+		size_t worst;
+		bool bounded;
+		//False if an imported function can be called, in
+		// which case worst is only a lower bound
+		bool complete;
+		//The callee on the path that uses the most stack
+		FnSymbol * deepest;
+	};
+
+	FnStack * stackOf(FnSymbol * fn);
+
+	//Write the analysis as JSON, with the worst case and
+	// deepest call path from the named entry function, or a
+	// null entry if there is no such function
+	void report(std::ostream& out, std::string entry);
+
+private:
+	Layout * layout;
+	CallGraph * graph;
+	HashMap<FnSymbol *, FnStack *> stacks;
+};
+
+}
+
+#endif
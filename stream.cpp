@@ -0,0 +1,108 @@
+#include "ast.hpp"
+#include "symbol_table.hpp"
+#include "errors.hpp"
+#include "scanner.hpp"
+#include "type_analysis.hpp"
+#include "module.hpp"
+#include "stream.hpp"
+
+namespace crona{
+
+DeclStream::DeclStream(std::string sourcePathIn, 
+	std::ostream * unparseOutIn, std::ostream * namesOutIn, 
+	bool checkNamesIn, bool checkTypesIn)
+: sourcePath(sourcePathIn), unparseOut(unparseOutIn), 
+  namesOut(namesOutIn),
+  checkNames(checkNamesIn || checkTypesIn || namesOutIn != nullptr),
+  checkTypes(checkTypesIn), namesOK(true), typesOK(true), decls(0){
+	symTab = new SymbolTable();
+	symTab->retireScopesTo(&retired);
+	//The global scope stays open for the whole stream
+	symTab->enterScope();
+	namesOK = ModuleInterface::declareImports(symTab->getCurrentScope());
+}
+
+DeclStream::~DeclStream(){
+	symTab->leaveScope();
+	for (auto scope : retired){
+		delete scope;
+	}
+	delete symTab;
+}
+
+bool DeclStream::parse(std::istream& in){
+	crona::ProgramNode * root = nullptr;
+	CRONA_ALLOC_TAG(PARSER);
+	crona::Scanner scanner(&in);
+	crona::Parser parser(scanner, &root, this);
+	int errCode = parser.parse();
+	//The program is empty, since the declarations were
+	// all taken by the stream
+	delete root;
+	return errCode == 0;
+}
+
+void DeclStream::take(ImportNode * import){
+	CRONA_ALLOC_TAG(OTHER);
+	if (unparseOut != nullptr){
+		OutBuffer out(unparseOut);
+		import->unparse(out, 0);
+	}
+	if (checkNames){
+		std::string path = ModuleInterface::pathFor(sourcePath, 
+			import->getName());
+		import->setModule(ModuleInterface::load(path.c_str()));
+		if (!import->nameAnalysis(symTab)){
+			namesOK = false;
+		} else if (namesOut != nullptr){
+			OutBuffer out(namesOut);
+			import->unparse(out, 0);
+		}
+	}
+	delete import;
+}
+
+void DeclStream::take(DeclNode * decl){
+	//The declaration is checked in the middle of parsing, but
+	// what that makes is not the parser's
+	CRONA_ALLOC_TAG(OTHER);
+	decls++;
+	if (Census * census = Census::current()){
+		census->takeShape(decl);
+	}
+	//Unparse first, since the -u form shows no symbols
+	if (unparseOut != nullptr){
+		OutBuffer out(unparseOut);
+		decl->unparse(out, 0);
+	}
+	if (checkNames){
+		bool named = decl->nameAnalysis(symTab);
+		if (!named){ 
+			namesOK = false;
+		} else {
+			if (namesOut != nullptr){
+				OutBuffer out(namesOut);
+				decl->unparse(out, 0);
+			}
+			//As without --stream, types are only checked while
+			// every name so far has resolved
+			if (checkTypes && namesOK){
+				TypeAnalysis * ta = TypeAnalysis::build();
+				decl->typeAnalysis(ta);
+				if (Census * census = Census::current()){
+					ta->census(census);
+				}
+				if (!ta->passed()){ typesOK = false; }
+				delete ta;
+			}
+		}
+	}
+
+	delete decl;
+	for (auto scope : retired){
+		delete scope;
+	}
+	retired.clear();
+}
+
+}
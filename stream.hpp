@@ -0,0 +1,76 @@
+#ifndef CRONA_STREAM
+#define CRONA_STREAM
+
+#include <istream>
+#include <list>
+#include <ostream>
+#include <string>
+#include "ast.hpp"
+#include "symbol_table.hpp"
+
+namespace crona{
+
+// Receives each top-level declaration from the parser as
+// soon as the declaration has been reduced, in place of the
+// parser collecting them into a ProgramNode. The sink takes
+// ownership of every node it is given. Imports, which come
+// before every declaration, are passed on the same way.
+class DeclSink{
+public:
+	virtual ~DeclSink(){ }
+	virtual void take(ImportNode * import) = 0;
+	virtual void take(DeclNode * decl) = 0;
+};
+
+// Checks and emits a program one top-level declaration at a
+// time. Each declaration is unparsed (-u), name-analyzed against
+// the global scope, unparsed with its names (-n) and type-checked
+// as soon as it is parsed, and then deleted along with the scopes
+// and symbols its body introduced. Only the global scope, holding
+// the signatures of the globals seen so far, outlives a
+// declaration. Since Crona requires names to be declared before
+// they are used, that is all a later declaration can refer to,
+// and the memory in use at any point is that of the global
+// signatures plus the one declaration being checked.
+//
+// The -n text of a declaration is written only if that
+// declaration passed name analysis, and types are checked only
+// while every declaration so far has. The caller decides whether
+// what was written stands once the whole program is seen.
+class DeclStream : public DeclSink{
+public:
+	//Either output may be null. Names are analyzed if checkNames
+	// or checkTypes is set, or if namesOut is given. Imports are
+	// found beside sourcePath.
+	DeclStream(std::string sourcePathIn, std::ostream * unparseOutIn, 
+		std::ostream * namesOutIn, bool checkNames, bool checkTypesIn);
+	~DeclStream();
+
+	//Scan and parse in, passing each declaration through this
+	// stream. Returns false if the input did not parse.
+	bool parse(std::istream& in);
+
+	void take(ImportNode * import) override;
+	void take(DeclNode * decl) override;
+
+	bool namesPassed(){ return namesOK; }
+	bool typesPassed(){ return typesOK; }
+	size_t declCount(){ return decls; }
+
+private:
+	std::string sourcePath;
+	std::ostream * unparseOut;
+	std::ostream * namesOut;
+	bool checkNames;
+	bool checkTypes;
+	SymbolTable * symTab;
+	//Scopes left while analyzing the current declaration
+	std::list<ScopeTable *> retired;
+	bool namesOK;
+	bool typesOK;
+	size_t decls;
+};
+
+}
+
+#endif
@@ -1,9 +1,20 @@
 #include "symbol_table.hpp"
 #include "types.hpp"
+#include "xref.hpp"
 namespace crona{
 
 SymbolTable::SymbolTable(){
 	scopeTableChain = new std::list<ScopeTable *>();
+	retired = nullptr;
+	xref = nullptr;
+}
+
+void SymbolTable::noteDef(SemSymbol * sym, size_t line, size_t col){
+	if (xref != nullptr){ xref->addDef(sym, line, col); }
+}
+
+void SymbolTable::noteUse(SemSymbol * sym, size_t line, size_t col){
+	if (xref != nullptr){ xref->addUse(sym, line, col); }
 }
 
 void SymbolTable::print(){
@@ -16,6 +27,7 @@ void SymbolTable::print(){
 ScopeTable * SymbolTable::enterScope(){
 	ScopeTable * newScope = new ScopeTable();
 	scopeTableChain->push_front(newScope);
+	if (Census * census = Census::current()){ census->scopeEntered(); }
 	return newScope;
 }
 
@@ -24,6 +36,12 @@ void SymbolTable::leaveScope(){
 		throw new InternalError("Attempt to pop"
 			"empty symbol table");
 	}
+	if (Census * census = Census::current()){
+		scopeTableChain->front()->census(census);
+	}
+	if (retired != nullptr){
+		retired->push_back(scopeTableChain->front());
+	}
 	scopeTableChain->pop_front();
 }
 
@@ -37,10 +55,17 @@ bool SymbolTable::clash(std::string varName){
 }
 
 SemSymbol * SymbolTable::find(std::string varName){
+	Census * census = Census::current();
+	size_t walked = 0;
 	for (ScopeTable * scope : *scopeTableChain){
+		walked++;
 		SemSymbol * sym = scope->lookup(varName);
-		if (sym != nullptr) { return sym; }
+		if (sym != nullptr) {
+			if (census){ census->scopesWalked(walked, true); }
+			return sym;
+		}
 	}
+	if (census){ census->scopesWalked(walked, false); }
 	return nullptr;
 }
 
@@ -49,9 +74,18 @@ bool SymbolTable::insert(SemSymbol * symbol){
 }
 
 ScopeTable::ScopeTable(){
+	TimeReport::counts().scopes++;
+	CRONA_ALLOC_TAG(SCOPES);
 	symbols = new HashMap<std::string, SemSymbol *>();
 }
 
+ScopeTable::~ScopeTable(){
+	for (auto entry : *symbols){
+		delete entry.second;
+	}
+	delete symbols;
+}
+
 std::string ScopeTable::toString(){
 	std::string result = "";
 	for (auto entry : *symbols){
@@ -78,6 +112,7 @@ SemSymbol * ScopeTable::lookup(std::string name){
 }
 
 bool ScopeTable::insert(SemSymbol * symbol){
+	CRONA_ALLOC_TAG(SCOPES);
 	std::string symName = symbol->getName();
 	bool alreadyInScope = (this->lookup(symName) != NULL);
 	if (alreadyInScope){
@@ -20,14 +20,20 @@ enum SymbolKind {
 	VAR, FN
 };
 
+class VarSymbol;
+class FnSymbol;
+class XrefBuilder;
+
 //A semantic symbol, which represents a single
 // variable, function, etc. Semantic symbols 
 // exist for the lifetime of a scope in the 
 // symbol table. 
 class SemSymbol {
 public:
+	CRONA_ALLOC_CLASS(SYMBOLS)
 	SemSymbol(std::string nameIn, DataType * typeIn) 
-	: myName(nameIn), myType(typeIn){ }
+	: myName(nameIn), myType(typeIn){ TimeReport::counts().symbols++; }
+	virtual ~SemSymbol(){ }
 	virtual std::string toString();
 	std::string getName() const { return myName; }
 	virtual SymbolKind getKind() const = 0;
@@ -35,6 +41,8 @@ public:
 	virtual DataType * getDataType() const{
 		return myType;
 	}
+	virtual VarSymbol * asVar(){ return nullptr; }
+	virtual FnSymbol * asFn(){ return nullptr; }
 	static std::string kindToString(SymbolKind symKind) { 
 		switch(symKind){
 			case VAR: return "var";
@@ -50,16 +58,38 @@ private:
 class VarSymbol : public SemSymbol {
 public:
 	VarSymbol(std::string name, DataType * type) 
-	: SemSymbol(name, type) { }
+	: SemSymbol(name, type), myStorage(UNALLOCATED), myOffset(0) { }
 	virtual SymbolKind getKind() const override { return VAR; } 
+	virtual VarSymbol * asVar() override { return this; }
+
+	//Set by the layout pass. The offset is relative to the
+	// start of the global data segment for GLOBAL storage, and
+	// to the base of the enclosing function's frame for FRAME
+	// storage.
+	void setLocation(StorageKind storageIn, size_t offsetIn){
+		myStorage = storageIn;
+		myOffset = offsetIn;
+	}
+	StorageKind getStorage() const { return myStorage; }
+	size_t getOffset() const { return myOffset; }
+private:
+	StorageKind myStorage;
+	size_t myOffset;
 };
 
 class FnSymbol : public SemSymbol{
 public:
 	FnSymbol(std::string name, FnType * fnType)
-	: SemSymbol(name, fnType){ }
+	: SemSymbol(name, fnType), myFrameSize(0){ }
 	virtual SymbolKind getKind() const { return FN; }
 	SymbolKind getKind(){ return FN; } 
+	virtual FnSymbol * asFn() override { return this; }
+
+	//Total bytes of formals and locals, set by the layout pass
+	void setFrameSize(size_t sizeIn){ myFrameSize = sizeIn; }
+	size_t getFrameSize() const { return myFrameSize; }
+private:
+	size_t myFrameSize;
 };
 
 //A single scope. The symbol table is broken down into a 
@@ -70,7 +100,10 @@ public:
 // a ScopeTable.
 class ScopeTable {
 	public:
+		CRONA_ALLOC_CLASS(SCOPES)
 		ScopeTable();
+		//Deletes the symbols of the scope along with it
+		~ScopeTable();
 		SemSymbol * lookup(std::string name);
 		bool insert(SemSymbol * symbol);
 		bool clash(std::string name);
@@ -81,6 +114,9 @@ class ScopeTable {
 		void addFn(std::string name, FnType * type){
 			insert(new FnSymbol(name, type));
 		}
+		void census(Census * census){
+			census->hashMap("scope symbols", *symbols);
+		}
 	private:
 		HashMap<std::string, SemSymbol *> * symbols;
 };
@@ -101,8 +137,22 @@ class SymbolTable{
 			getCurrentScope()->addFn(name, type);
 		}
 		void print();
+		//If a cross-reference builder is set, every 
+		// definition and resolved use noted during name 
+		// analysis is passed on to it
+		void setXref(XrefBuilder * xrefIn){ xref = xrefIn; }
+		void noteDef(SemSymbol * sym, size_t line, size_t col);
+		void noteUse(SemSymbol * sym, size_t line, size_t col);
+		//If a list is set, each scope left is added to it, so
+		// that the caller can delete it once nothing refers to
+		// its symbols any more. Otherwise scopes are kept.
+		void retireScopesTo(std::list<ScopeTable *> * retiredIn){
+			retired = retiredIn;
+		}
 	private:
 		std::list<ScopeTable *> * scopeTableChain;
+		std::list<ScopeTable *> * retired;
+		XrefBuilder * xref;
 };
 
 	
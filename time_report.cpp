@@ -0,0 +1,337 @@
+#include <ctime>
+#include <iomanip>
+#include <sys/resource.h>
+#include "out_buffer.hpp"
+#include "time_report.hpp"
+
+namespace crona{
+
+static long long micros(std::chrono::steady_clock::duration spent){
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		spent).count();
+}
+
+static void subtractCounts(TimeReport::Counts& made,
+	const TimeReport::Counts& now, const TimeReport::Counts& start){
+	made.tokens += now.tokens - start.tokens;
+	made.nodes += now.nodes - start.nodes;
+	made.symbols += now.symbols - start.symbols;
+	made.scopes += now.scopes - start.scopes;
+	made.types += now.types - start.types;
+}
+
+double TimeReport::cpuSeconds(){
+	timespec now;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	return static_cast<double>(now.tv_sec)
+	  + static_cast<double>(now.tv_nsec) / 1e9;
+}
+
+long TimeReport::peakRSSKB(){
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+//Add what each event counted between start and end to sums,
+// for the events counted at both. The raw counts are subtracted
+// first and only the difference is scaled, by how long the group
+// ran between the two reads.
+static void addEvents(long long * sums, const PerfCounters::Values& end,
+	const PerfCounters::Values& start){
+	for (size_t k = 0; k < PerfCounters::EVENT_COUNT; k++){
+		long long counted = PerfCounters::delta(end, start, 
+			static_cast<PerfCounters::Event>(k));
+		if (counted < 0){ continue; }
+		sums[k] += counted;
+	}
+}
+
+TimeReport::TimeReport(std::string subjectIn, bool withCounters)
+: subject(subjectIn), depth(0), scanPhase(0), totalWallUs(0),
+  totalCpuUs(0), peakKB(0), counters(nullptr){
+	if (withCounters){
+		counters = new PerfCounters();
+		counters->read(eventStart);
+	}
+	wallStart = std::chrono::steady_clock::now();
+	cpuStart = cpuSeconds();
+	countStart = counts();
+}
+
+TimeReport::~TimeReport(){
+	delete counters;
+}
+
+size_t TimeReport::phase(const std::string& name, size_t depthIn){
+	for (size_t k = 0; k < phases.size(); k++){
+		if (phases[k].name == name && phases[k].depth == depthIn){ return k; }
+	}
+	phases.push_back(Phase(name, depthIn));
+	return phases.size() - 1;
+}
+
+TimeReport::PhaseTimer::PhaseTimer(const char * nameIn)
+: span(nameIn),
+#ifdef CRONA_ALLOC_STATS
+  allocPhase(nameIn),
+#endif
+  report(TimeReport::current()), name(nameIn){
+	if (report == nullptr){ return; }
+	//Reserve the phase's place, so that phases are listed in
+	// the order they start rather than the order they end
+	report->phase(name, report->depth);
+	report->depth++;
+	peakStart = peakRSSKB();
+	countStart = counts();
+	cpuStart = cpuSeconds();
+	if (report->counters != nullptr){ report->counters->read(eventStart); }
+	wallStart = std::chrono::steady_clock::now();
+}
+
+TimeReport::PhaseTimer::~PhaseTimer(){
+	if (report == nullptr){ return; }
+	auto wallEnd = std::chrono::steady_clock::now();
+	PerfCounters::Values eventEnd;
+	if (report->counters != nullptr){ report->counters->read(eventEnd); }
+	double cpuEnd = cpuSeconds();
+	report->depth--;
+	Phase& done = report->phases[report->phase(name, report->depth)];
+	addEvents(done.events, eventEnd, eventStart);
+	done.runs++;
+	done.wallUs += micros(wallEnd - wallStart);
+	done.cpuUs += static_cast<long long>((cpuEnd - cpuStart) * 1e6);
+	done.rssGrowthKB += peakRSSKB() - peakStart;
+	subtractCounts(done.made, counts(), countStart);
+}
+
+void TimeReport::addScanTime(std::chrono::steady_clock::duration spent){
+	//This is called for every token, so the phase is only
+	// looked up when the depth it belongs at changes
+	static const std::string SCAN = "scan (parser's tokens)";
+	if (scanPhase >= phases.size() || phases[scanPhase].depth != depth
+	  || phases[scanPhase].name != SCAN){
+		scanPhase = phase(SCAN, depth);
+	}
+	Phase& scan = phases[scanPhase];
+	scan.hasCpu = false;
+	if (scan.runs == 0){ scan.runs = 1; }
+	scan.wallUs += micros(spent);
+	scan.made.tokens++;
+}
+
+void TimeReport::finishTotals(){
+	totalWallUs = micros(std::chrono::steady_clock::now() - wallStart);
+	totalCpuUs = static_cast<long long>((cpuSeconds() - cpuStart) * 1e6);
+	peakKB = peakRSSKB();
+	if (counters != nullptr){ counters->read(eventTotals); }
+}
+
+static void putMillis(std::ostream& out, long long micros){
+	out << std::setw(10) << std::fixed << std::setprecision(2)
+	  << static_cast<double>(micros) / 1000.0;
+}
+
+static void putCounts(std::ostream& out, const TimeReport::Counts& made){
+	out << std::setw(9) << made.tokens << std::setw(9) << made.nodes
+	  << std::setw(9) << made.symbols << std::setw(8) << made.scopes
+	  << std::setw(7) << made.types;
+}
+
+void TimeReport::writeTable(std::ostream& out){
+	finishTotals();
+	out << "time report: " << subject << "\n";
+	out << std::left << std::setw(26) << "phase" << std::right
+	  << std::setw(5) << "runs" << std::setw(10) << "wall ms"
+	  << std::setw(10) << "cpu ms" << std::setw(10) << "+peak KB"
+	  << std::setw(9) << "tokens" << std::setw(9) << "nodes"
+	  << std::setw(9) << "symbols" << std::setw(8) << "scopes"
+	  << std::setw(7) << "types" << "\n";
+	for (auto& phase : phases){
+		std::string label = std::string(2 * phase.depth, ' ') + phase.name;
+		out << std::left << std::setw(26) << label << std::right
+		  << std::setw(5) << phase.runs;
+		putMillis(out, phase.wallUs);
+		if (phase.hasCpu){
+			putMillis(out, phase.cpuUs);
+			out << std::setw(10) << phase.rssGrowthKB;
+		} else {
+			out << std::setw(10) << "-" << std::setw(10) << "-";
+		}
+		putCounts(out, phase.made);
+		out << "\n";
+	}
+	Counts made;
+	subtractCounts(made, counts(), countStart);
+	out << std::left << std::setw(26) << "total" << std::right
+	  << std::setw(5) << "";
+	putMillis(out, totalWallUs);
+	putMillis(out, totalCpuUs);
+	out << std::setw(10) << "";
+	putCounts(out, made);
+	out << "\n" << "peak RSS: " << peakKB << " KB\n";
+	if (counters != nullptr){ writeEventTable(out); }
+	out.flush();
+}
+
+//The number of nodes in the AST: what the phase that made the
+// most made in each of its runs
+static size_t astNodes(const std::vector<size_t>& made){
+	size_t most = 0;
+	for (auto nodes : made){
+		if (nodes > most){ most = nodes; }
+	}
+	return most;
+}
+
+static void putEvent(std::ostream& out, int width, long long count,
+	bool counted){
+	out << std::setw(width);
+	if (counted){ out << count; } else { out << "-"; }
+}
+
+static void putRatio(std::ostream& out, int width, long long count,
+	long long per, bool counted){
+	out << std::setw(width);
+	if (!counted || per <= 0){
+		out << "-";
+		return;
+	}
+	out << std::fixed << std::setprecision(2)
+	  << static_cast<double>(count) / static_cast<double>(per);
+}
+
+void TimeReport::writeEventTable(std::ostream& out){
+	if (!counters->anyAvailable()){
+		out << "hardware events: unavailable ("
+		  << counters->whyUnavailable() << ")\n";
+		return;
+	}
+	std::vector<size_t> nodesPerRun;
+	for (auto& phase : phases){
+		if (phase.runs > 0 && phase.hasCpu){
+			nodesPerRun.push_back(phase.made.nodes / phase.runs);
+		}
+	}
+	long long nodes = static_cast<long long>(astNodes(nodesPerRun));
+
+	bool has[PerfCounters::EVENT_COUNT];
+	for (size_t k = 0; k < PerfCounters::EVENT_COUNT; k++){
+		has[k] = counters->available(static_cast<PerfCounters::Event>(k));
+	}
+	out << "hardware events (user space, " << nodes << " AST nodes)\n";
+	out << std::left << std::setw(26) << "phase" << std::right
+	  << std::setw(14) << "cycles" << std::setw(14) << "instructions"
+	  << std::setw(6) << "IPC" << std::setw(12) << "L1D misses"
+	  << std::setw(12) << "LLC misses" << std::setw(12) << "br misses"
+	  << std::setw(10) << "L1D/node" << std::setw(10) << "LLC/node"
+	  << "\n";
+	auto putRow = [&](const std::string& label, const long long * events){
+		out << std::left << std::setw(26) << label << std::right;
+		putEvent(out, 14, events[PerfCounters::CYCLES],
+			has[PerfCounters::CYCLES]);
+		putEvent(out, 14, events[PerfCounters::INSTRUCTIONS],
+			has[PerfCounters::INSTRUCTIONS]);
+		putRatio(out, 6, events[PerfCounters::INSTRUCTIONS],
+			events[PerfCounters::CYCLES],
+			has[PerfCounters::INSTRUCTIONS] && has[PerfCounters::CYCLES]);
+		putEvent(out, 12, events[PerfCounters::L1D_MISSES],
+			has[PerfCounters::L1D_MISSES]);
+		putEvent(out, 12, events[PerfCounters::LLC_MISSES],
+			has[PerfCounters::LLC_MISSES]);
+		putEvent(out, 12, events[PerfCounters::BRANCH_MISSES],
+			has[PerfCounters::BRANCH_MISSES]);
+		putRatio(out, 10, events[PerfCounters::L1D_MISSES], nodes,
+			has[PerfCounters::L1D_MISSES]);
+		putRatio(out, 10, events[PerfCounters::LLC_MISSES], nodes,
+			has[PerfCounters::LLC_MISSES]);
+		out << "\n";
+	};
+	for (auto& phase : phases){
+		//Events are counted around whole phases, not tokens
+		if (!phase.hasCpu){ continue; }
+		putRow(std::string(2 * phase.depth, ' ') + phase.name, phase.events);
+	}
+	long long totals[PerfCounters::EVENT_COUNT] = {};
+	addEvents(totals, eventTotals, eventStart);
+	putRow("total", totals);
+	if (!counters->whyUnavailable().empty()){
+		out << "not counted: " << counters->whyUnavailable() << "\n";
+	}
+}
+
+static const char * const EVENT_KEYS[PerfCounters::EVENT_COUNT] = {
+	"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"
+};
+
+static void putEventsJSON(OutBuffer& out, const PerfCounters * counters,
+	const long long * events){
+	if (counters == nullptr){ return; }
+	for (size_t k = 0; k < PerfCounters::EVENT_COUNT; k++){
+		if (!counters->available(static_cast<PerfCounters::Event>(k))){
+			continue;
+		}
+		out.put(",\"");
+		out.put(EVENT_KEYS[k]);
+		out.put("\":");
+		out.putInt(events[k]);
+	}
+}
+
+static void putCountsJSON(OutBuffer& out, const TimeReport::Counts& made){
+	out.put(",\"tokens\":");
+	out.putUInt(made.tokens);
+	out.put(",\"nodes\":");
+	out.putUInt(made.nodes);
+	out.put(",\"symbols\":");
+	out.putUInt(made.symbols);
+	out.put(",\"scopes\":");
+	out.putUInt(made.scopes);
+	out.put(",\"types\":");
+	out.putUInt(made.types);
+}
+
+void TimeReport::writeJSON(std::ostream& sink){
+	finishTotals();
+	OutBuffer out(&sink);
+	out.put("{\"file\":");
+	out.putJSONString(subject);
+	out.put(",\"wall_us\":");
+	out.putInt(totalWallUs);
+	out.put(",\"cpu_us\":");
+	out.putInt(totalCpuUs);
+	out.put(",\"peak_rss_kb\":");
+	out.putInt(peakKB);
+	Counts made;
+	subtractCounts(made, counts(), countStart);
+	putCountsJSON(out, made);
+	long long totals[PerfCounters::EVENT_COUNT] = {};
+	if (counters != nullptr){ addEvents(totals, eventTotals, eventStart); }
+	putEventsJSON(out, counters, totals);
+	out.put(",\"phases\":[");
+	bool first = true;
+	for (auto& phase : phases){
+		if (!first){ out.put(','); }
+		first = false;
+		out.put("{\"name\":");
+		out.putJSONString(phase.name);
+		out.put(",\"depth\":");
+		out.putUInt(phase.depth);
+		out.put(",\"runs\":");
+		out.putUInt(phase.runs);
+		out.put(",\"wall_us\":");
+		out.putInt(phase.wallUs);
+		if (phase.hasCpu){
+			out.put(",\"cpu_us\":");
+			out.putInt(phase.cpuUs);
+			out.put(",\"rss_growth_kb\":");
+			out.putInt(phase.rssGrowthKB);
+			putEventsJSON(out, counters, phase.events);
+		}
+		putCountsJSON(out, phase.made);
+		out.put('}');
+	}
+	out.put("]}\n");
+}
+
+}
@@ -0,0 +1,144 @@
+#ifndef CRONA_TIME_REPORT
+#define CRONA_TIME_REPORT
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "trace.hpp"
+#include "alloc_stats.hpp"
+#include "perf_counters.hpp"
+
+namespace crona{
+
+// What each phase of a run cost, for --time-report: wall and CPU
+// time, how much the peak RSS grew, and how many tokens, AST
+// nodes, symbols, scopes and types were made. A phase that runs
+// more than once (each stage parses the source again) is summed
+// over its runs. Phases started inside another phase are shown
+// nested under it, and their cost is also part of its cost.
+//
+// Like the diagnostic engine, a report is installed per thread.
+// With none installed a phase timer does nothing but test one
+// thread-local pointer (and whether a trace is running), and the
+// counts are plain thread-local increments, so both stay in the
+// build at no measurable cost.
+class TimeReport{
+public:
+	//What has been made on this thread so far
+	class Counts{
+	public:
+		Counts() : tokens(0), nodes(0), symbols(0), scopes(0),
+		  types(0){ }
+		size_t tokens;
+		size_t nodes;
+		size_t symbols;
+		size_t scopes;
+		size_t types;
+	};
+	static Counts& counts(){
+		static thread_local Counts made;
+		return made;
+	}
+
+	//A report on the run over the named input. With counters,
+	// each phase also reports the hardware events counted on
+	// the calling thread, which must be the one that runs it.
+	TimeReport(std::string subjectIn, bool withCounters = false);
+	~TimeReport();
+
+	//The report of the calling thread, or null if none is
+	// being made
+	static TimeReport * current(){ return *slot(); }
+	//Make report the calling thread's report, and return the
+	// one it replaces
+	static TimeReport * install(TimeReport * report){
+		TimeReport * prev = *slot();
+		*slot() = report;
+		return prev;
+	}
+
+	//Times the named phase from its construction to its
+	// destruction, when the thread has a report
+	class PhaseTimer{
+	public:
+		PhaseTimer(const char * nameIn);
+		~PhaseTimer();
+	private:
+		//Each phase is also a span of the trace, if there is one
+		Trace::Span span;
+#ifdef CRONA_ALLOC_STATS
+		AllocStats::PhaseScope allocPhase;
+#endif
+		TimeReport * report;
+		const char * name;
+		std::chrono::steady_clock::time_point wallStart;
+		double cpuStart;
+		long peakStart;
+		Counts countStart;
+		PerfCounters::Values eventStart;
+	};
+
+	//Time the scanner spent producing tokens for the parser,
+	// measured token by token. It is reported as a phase
+	// nested in the phase that parsed.
+	void addScanTime(std::chrono::steady_clock::duration spent);
+
+	//A table, one phase to a line, ending with the totals,
+	// and a second one of the hardware events if counted
+	void writeTable(std::ostream& out);
+	//The same as one line of JSON, with times in microseconds
+	void writeJSON(std::ostream& out);
+
+private:
+	static TimeReport ** slot(){
+		static thread_local TimeReport * report = nullptr;
+		return &report;
+	}
+
+	class Phase{
+	public:
+		Phase(std::string nameIn, size_t depthIn)
+		: name(nameIn), depth(depthIn), runs(0), wallUs(0), cpuUs(0),
+		  rssGrowthKB(0), hasCpu(true){
+			for (size_t k = 0; k < PerfCounters::EVENT_COUNT; k++){
+				events[k] = 0;
+			}
+		}
+		std::string name;
+		size_t depth;
+		size_t runs;
+		long long wallUs;
+		long long cpuUs;
+		long rssGrowthKB;
+		bool hasCpu;
+		Counts made;
+		long long events[PerfCounters::EVENT_COUNT];
+	};
+	//The index of the named phase at depth, added if new
+	size_t phase(const std::string& name, size_t depth);
+	void finishTotals();
+	void writeEventTable(std::ostream& out);
+
+	static double cpuSeconds();
+	static long peakRSSKB();
+
+	std::string subject;
+	//Phases in the order they were first started
+	std::vector<Phase> phases;
+	size_t depth;
+	size_t scanPhase;
+	std::chrono::steady_clock::time_point wallStart;
+	double cpuStart;
+	long long totalWallUs;
+	long long totalCpuUs;
+	long peakKB;
+	Counts countStart;
+	PerfCounters * counters;
+	PerfCounters::Values eventStart;
+	PerfCounters::Values eventTotals;
+};
+
+}
+
+#endif
@@ -6,7 +6,7 @@ namespace crona{
 using TokenKind = crona::Parser::token;
 using Lexeme = crona::Parser::semantic_type;
 
-static std::string tokenKindString(int tokKind){
+static const char * tokenKindString(int tokKind){
 	switch(tokKind){
 		case TokenKind::END: return "EOF";
 		case TokenKind::AND: return "AND";
@@ -24,6 +24,7 @@ static std::string tokenKindString(int tokKind){
 		case TokenKind::EQUALS: return "EQUALS";
 		case TokenKind::FALSE: return "FALSE";
 		case TokenKind::HAVOC: return "HAVOC";
+		case TokenKind::IMPORT: return "IMPORT";
 		case TokenKind::ID: return "ID";
 		case TokenKind::IF: return "IF";
 		case TokenKind::INT: return "INT";
@@ -60,14 +61,28 @@ static std::string tokenKindString(int tokKind){
 
 Token::Token(size_t lineIn, size_t columnIn, int kindIn)
   : myLine(lineIn), myCol(columnIn), myKind(kindIn){
+	TimeReport::counts().tokens++;
 }
 
 std::string Token::toString(){
-	return tokenKindString(kind())
+	return std::string(tokenKindString(kind()))
 	+ " [" + std::to_string(line()) 
 	+ "," + std::to_string(col()) + "]";
 }
 
+void Token::writePos(OutBuffer& out){
+	out.put(" [");
+	out.putUInt(line());
+	out.put(',');
+	out.putUInt(col());
+	out.put(']');
+}
+
+void Token::write(OutBuffer& out){
+	out.put(tokenKindString(kind()));
+	writePos(out);
+}
+
 size_t Token::line() const { 
 	return this->myLine; 
 }
@@ -85,12 +100,19 @@ IDToken::IDToken(size_t lIn, size_t cIn, std::string vIn)
 }
 
 std::string IDToken::toString(){
-	return tokenKindString(kind()) + ":"
+	return std::string(tokenKindString(kind())) + ":"
 	+ this->myValue
 	+ " [" + std::to_string(line()) 
 	+ "," + std::to_string(col()) + "]";
 }
 
+void IDToken::write(OutBuffer& out){
+	out.put(tokenKindString(kind()));
+	out.put(':');
+	out.put(myValue);
+	writePos(out);
+}
+
 const std::string IDToken::value() const { 
 	return this->myValue; 
 }
@@ -100,12 +122,19 @@ StrToken::StrToken(size_t lIn, size_t cIn, std::string sIn)
 }
 
 std::string StrToken::toString(){
-	return tokenKindString(kind()) + ":"
+	return std::string(tokenKindString(kind())) + ":"
 	+ this->myStr
 	+ " [" + std::to_string(line()) 
 	+ "," + std::to_string(col()) + "]";
 }
 
+void StrToken::write(OutBuffer& out){
+	out.put(tokenKindString(kind()));
+	out.put(':');
+	out.put(myStr);
+	writePos(out);
+}
+
 const std::string StrToken::str() const {
 	return this->myStr;
 }
@@ -114,12 +143,19 @@ IntLitToken::IntLitToken(size_t lIn, size_t cIn, int numIn)
   : Token(lIn, cIn, TokenKind::INTLITERAL), myNum(numIn){}
 
 std::string IntLitToken::toString(){
-	return tokenKindString(kind()) + ":"
+	return std::string(tokenKindString(kind())) + ":"
 	+ std::to_string(this->myNum)
 	+ " [" + std::to_string(line()) 
 	+ "," + std::to_string(col()) + "]";
 }
 
+void IntLitToken::write(OutBuffer& out){
+	out.put(tokenKindString(kind()));
+	out.put(':');
+	out.putInt(myNum);
+	writePos(out);
+}
+
 int IntLitToken::num() const {
 	return this->myNum;
 }
@@ -2,16 +2,25 @@
 #define CRONA_TOKEN_H
 
 #include <string>
+#include "out_buffer.hpp"
+#include "time_report.hpp"
+#include "alloc_stats.hpp"
 
 namespace crona{
 
 class Token{
 public:
+	CRONA_ALLOC_CLASS(TOKENS)
 	Token(size_t lineIn, size_t columnIn, int kindIn);
+	virtual ~Token(){ }
 	virtual std::string toString();
+	//Write the same text as toString to out
+	virtual void write(OutBuffer& out);
 	size_t line() const;
 	size_t col() const;
 	int kind() const;
+protected:
+	void writePos(OutBuffer& out);
 private:
 	const size_t myLine;
 	const size_t myCol;
@@ -23,6 +32,7 @@ public:
 	IDToken(size_t lIn, size_t cIn, std::string valIn);
 	const std::string value() const;
 	virtual std::string toString() override;
+	virtual void write(OutBuffer& out) override;
 private:
 	const std::string myValue;
 	
@@ -32,6 +42,7 @@ class StrToken : public Token{
 public:
 	StrToken(size_t lIn, size_t cIn, std::string valIn);
 	virtual std::string toString() override;
+	virtual void write(OutBuffer& out) override;
 	const std::string str() const;
 private:
 	const std::string myStr;
@@ -50,6 +61,7 @@ class IntLitToken : public Token{
 public:
 	IntLitToken(size_t lIn, size_t cIn, int numIn);
 	virtual std::string toString() override;
+	virtual void write(OutBuffer& out) override;
 	int num() const;
 private:
 	const int myNum;
@@ -0,0 +1,174 @@
+#include "out_buffer.hpp"
+#include "trace.hpp"
+
+namespace crona{
+
+static const size_t NO_NODES = static_cast<size_t>(-1);
+
+class TraceEvent{
+public:
+	TraceEvent(const char * categoryIn, const std::string& nameIn,
+		size_t nodesIn, long long startNsIn)
+	: category(categoryIn), name(nameIn), nodes(nodesIn),
+	  startNs(startNsIn), durNs(0){ }
+	const char * category;
+	std::string name;
+	size_t nodes;
+	long long startNs;
+	long long durNs;
+};
+
+class Trace::ThreadLog{
+public:
+	ThreadLog(size_t tidIn, std::chrono::steady_clock::time_point originIn)
+	: tid(tidIn), origin(originIn){ }
+	long long sinceOrigin(std::chrono::steady_clock::time_point when){
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			when - origin).count();
+	}
+	size_t tid;
+	std::chrono::steady_clock::time_point origin;
+	std::string name;
+	std::vector<TraceEvent> events;
+};
+
+static std::atomic<unsigned> nextGeneration(1);
+
+//The log the calling thread last recorded in, and the trace
+// it belongs to
+static thread_local Trace::ThreadLog * cachedLog = nullptr;
+static thread_local unsigned cachedGeneration = 0;
+
+Trace::Trace()
+: origin(std::chrono::steady_clock::now()), generation(0){ }
+
+Trace::~Trace(){
+	Trace * self = this;
+	running().compare_exchange_strong(self, nullptr);
+	for (auto log : logs){
+		delete log;
+	}
+}
+
+void Trace::start(){
+	generation = nextGeneration++;
+	origin = std::chrono::steady_clock::now();
+	running().store(this);
+	nameThread("main");
+}
+
+Trace::ThreadLog * Trace::addThread(){
+	std::lock_guard<std::mutex> guard(lock);
+	ThreadLog * log = new ThreadLog(logs.size() + 1, origin);
+	log->name = "thread " + std::to_string(log->tid);
+	logs.push_back(log);
+	return log;
+}
+
+Trace::ThreadLog * Trace::threadLog(){
+	Trace * trace = running().load(std::memory_order_acquire);
+	if (trace == nullptr){ return nullptr; }
+	if (cachedGeneration != trace->generation){
+		cachedLog = trace->addThread();
+		cachedGeneration = trace->generation;
+	}
+	return cachedLog;
+}
+
+void Trace::nameThread(const std::string& name){
+	ThreadLog * log = threadLog();
+	if (log != nullptr){ log->name = name; }
+}
+
+Trace::Span::Span(const char * phase) : log(nullptr), slot(0){
+	if (running().load(std::memory_order_relaxed) == nullptr){ return; }
+	begin("phase", phase, NO_NODES);
+}
+
+Trace::Span::Span(const char * category, const std::string& name)
+: log(nullptr), slot(0){
+	if (running().load(std::memory_order_relaxed) == nullptr){ return; }
+	begin(category, name, NO_NODES);
+}
+
+Trace::Span::Span(const char * category, const std::string& name,
+	size_t nodes)
+: log(nullptr), slot(0){
+	if (running().load(std::memory_order_relaxed) == nullptr){ return; }
+	begin(category, name, nodes);
+}
+
+void Trace::Span::begin(const char * category, const std::string& name,
+	size_t nodes){
+	log = threadLog();
+	if (log == nullptr){ return; }
+	//The event is placed now so that spans are listed in the
+	// order they start, and filled in when the span ends
+	startTime = std::chrono::steady_clock::now();
+	slot = log->events.size();
+	log->events.push_back(TraceEvent(category, name, nodes,
+		log->sinceOrigin(startTime)));
+}
+
+Trace::Span::~Span(){
+	if (log == nullptr){ return; }
+	auto endTime = std::chrono::steady_clock::now();
+	log->events[slot].durNs = std::chrono::duration_cast<
+		std::chrono::nanoseconds>(endTime - startTime).count();
+}
+
+//Trace-event times are in microseconds, and may have a fraction
+static void putMicros(OutBuffer& out, long long ns){
+	out.putInt(ns / 1000);
+	out.put('.');
+	long long frac = ns % 1000;
+	out.put(static_cast<char>('0' + frac / 100));
+	out.put(static_cast<char>('0' + frac / 10 % 10));
+	out.put(static_cast<char>('0' + frac % 10));
+}
+
+void Trace::finish(std::ostream& sink){
+	Trace * self = this;
+	running().compare_exchange_strong(self, nullptr);
+	OutBuffer out(&sink);
+	out.put("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	out.put("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+		"\"args\":{\"name\":\"cronac\"}}");
+	for (auto log : logs){
+		out.put(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+		out.putUInt(log->tid);
+		out.put(",\"args\":{\"name\":");
+		out.putJSONString(log->name);
+		out.put("}}");
+		//Tracks are sorted in the order the threads started
+		out.put(",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,"
+			"\"tid\":");
+		out.putUInt(log->tid);
+		out.put(",\"args\":{\"sort_index\":");
+		out.putUInt(log->tid);
+		out.put("}}");
+	}
+	for (auto log : logs){
+		for (auto& event : log->events){
+			out.put(",\n{\"name\":");
+			out.putJSONString(event.name);
+			out.put(",\"cat\":");
+			out.putJSONString(event.category);
+			out.put(",\"ph\":\"X\",\"pid\":1,\"tid\":");
+			out.putUInt(log->tid);
+			out.put(",\"ts\":");
+			putMicros(out, event.startNs);
+			out.put(",\"dur\":");
+			putMicros(out, event.durNs);
+			if (event.nodes != NO_NODES){
+				out.put(",\"args\":{\"nodes\":");
+				out.putUInt(event.nodes);
+				out.put('}');
+			}
+			out.put('}');
+		}
+	}
+	out.put("\n]}\n");
+}
+
+}
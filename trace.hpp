@@ -0,0 +1,80 @@
+#ifndef CRONA_TRACE
+#define CRONA_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace crona{
+
+// Spans of a run in the Chrome trace-event format, for --trace,
+// to be opened in Perfetto or chrome://tracing: one span for each
+// file and each phase, and under name and type analysis one for
+// each function, carrying its name and how many AST nodes it has.
+// Each thread that records a span gets a track of its own.
+//
+// Each thread appends to its own log, so recording a span takes
+// no lock; a lock is only taken the first time a thread records
+// one, to add its log to the trace. With no trace started a span
+// does nothing but load one pointer.
+class Trace{
+public:
+	Trace();
+	~Trace();
+
+	//Make this the trace spans are recorded in, with the
+	// calling thread's track named "main"
+	void start();
+	//Stop recording, and write every span as trace-event
+	// JSON. All threads that recorded spans must be done.
+	void finish(std::ostream& out);
+
+	//Name the calling thread's track, if there is a trace
+	static void nameThread(const std::string& name);
+
+	class ThreadLog;
+
+	//Records the time from its construction to its destruction
+	class Span{
+	public:
+		//A phase
+		Span(const char * phase);
+		//Work on one named thing, such as a file or a function,
+		// in the given category
+		Span(const char * category, const std::string& name);
+		//As above, for a subtree of the given number of nodes
+		Span(const char * category, const std::string& name,
+			size_t nodes);
+		~Span();
+	private:
+		void begin(const char * category, const std::string& name,
+			size_t nodes);
+		ThreadLog * log;
+		size_t slot;
+		std::chrono::steady_clock::time_point startTime;
+	};
+
+private:
+	//The calling thread's log in the running trace, or null
+	static ThreadLog * threadLog();
+	ThreadLog * addThread();
+
+	static std::atomic<Trace *>& running(){
+		static std::atomic<Trace *> trace(nullptr);
+		return trace;
+	}
+
+	std::chrono::steady_clock::time_point origin;
+	//Tells this trace's logs from those of an earlier one
+	// that a thread may still point to
+	unsigned generation;
+	std::mutex lock;
+	std::vector<ThreadLog *> logs;
+};
+
+}
+
+#endif
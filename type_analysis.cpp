@@ -4,6 +4,7 @@
 #include "types.hpp"
 #include "name_analysis.hpp"
 #include "type_analysis.hpp"
+#include "probes.hpp"
 
 namespace crona{
 
@@ -11,11 +12,15 @@ TypeAnalysis * TypeAnalysis::build(NameAnalysis * nameAnalysis){
 	//To emphasize that type analysis depends on name analysis
 	// being complete, a name analysis must be supplied for
 	// type analysis to be performed.
+	TimeReport::PhaseTimer timer("type analysis");
 	TypeAnalysis * typeAnalysis = new TypeAnalysis();
 	auto ast = nameAnalysis->ast;
 	typeAnalysis->ast = ast;
 
 	ast->typeAnalysis(typeAnalysis);
+	if (Census * census = Census::current()){
+		typeAnalysis->census(census);
+	}
 	if (typeAnalysis->hasError){
 		return nullptr;
 	}
@@ -24,6 +29,12 @@ TypeAnalysis * TypeAnalysis::build(NameAnalysis * nameAnalysis){
 
 }
 
+TypeAnalysis * TypeAnalysis::build(){
+	TypeAnalysis * typeAnalysis = new TypeAnalysis();
+	typeAnalysis->ast = nullptr;
+	return typeAnalysis;
+}
+
 void ProgramNode::typeAnalysis(TypeAnalysis * ta){
 
 	//pass the TypeAnalysis down throughout
@@ -42,6 +53,8 @@ void ProgramNode::typeAnalysis(TypeAnalysis * ta){
 }
 
 void FnDeclNode::typeAnalysis(TypeAnalysis * ta){
+	Trace::Span span("type analysis", myID->getName(), mySize);
+	CRONA_PROBE1(type__start, myID->getName().c_str());
 
 	ta->nodeType(this, ta->getCurrentFnType());
     std::list<const DataType *> * formals = new std::list<const DataType *>();
@@ -57,7 +70,7 @@ void FnDeclNode::typeAnalysis(TypeAnalysis * ta){
     {
         stmt->typeAnalysis(ta);
     }
-
+	CRONA_PROBE1(type__end, myID->getName().c_str());
 }
 
 void StmtNode::typeAnalysis(TypeAnalysis * ta){
@@ -286,6 +299,9 @@ void IndexNode::typeAnalysis(TypeAnalysis * ta) {
 	if(isArr == nullptr){
 		ta->nodeType(this, ErrorType::produce());
 		ta->errArrayID(myOffset->line(), myOffset->col()-2);
+	} else if(type_offset->isInt()){
+		//An element has the array's base type
+		ta->nodeType(this, ArrayType::baseType(type_base));
 	}
 }
 
@@ -22,11 +22,18 @@ private:
 	// can only be created via the static build function
 	TypeAnalysis(){
 		hasError = false;
+		currentFnType = nullptr;
 	}
 
 public:
 	static TypeAnalysis * build(NameAnalysis * astRoot);
-	//static TypeAnalysis * build();
+	//Add the state of the node type map to a census
+	void census(Census * census) const {
+		census->hashMap("node types", nodeToType);
+	}
+	//An analysis with no program, for checking declarations
+	// one at a time by calling their typeAnalysis directly
+	static TypeAnalysis * build();
 
 	//The type analysis has an instance variable to say whether
 	// the analysis failed or not. Setting this variable is much
@@ -49,6 +56,7 @@ public:
 	// overloaded: this 2-argument nodeType puts a value into the
 	// map with a given type. 
 	void nodeType(const ASTNode * node, const DataType * type){
+		CRONA_ALLOC_TAG(NODE_TYPES);
 		nodeToType[node] = type;
 	}
 
@@ -3,7 +3,11 @@
 
 #include <list>
 #include <sstream>
+#include <mutex>
 #include "errors.hpp"
+#include "time_report.hpp"
+#include "alloc_stats.hpp"
+#include "census.hpp"
 
 #include <unordered_map>
 
@@ -28,12 +32,101 @@ enum BaseType{
 	INT, VOID, BOOL, BYTE
 };
 
+//Where the storage for a variable lives once the
+// layout pass has run: the packed global data segment,
+// or the frame of the enclosing function.
+enum StorageKind{
+	UNALLOCATED, GLOBAL, FRAME
+};
+
+//Describes how a target stores data: the size and alignment
+// (in bytes) of each base type, the alignment of stack frames,
+// and whether bool arrays are packed with one element per bit.
+// Every size and alignment query goes through the selected
+// target, which defaults to the reference target "lp64".
+class DataLayout{
+public:
+	//Get a known target by name, or nullptr if there is none.
+	// As with the types below, there is only ever one instance
+	// of each target.
+	static const DataLayout * produce(std::string name){
+		static std::list<DataLayout *> targets = {
+			new DataLayout("lp64", 8, 8, false),
+			new DataLayout("lp64-packed", 8, 8, true),
+			new DataLayout("ilp32", 4, 4, false),
+			new DataLayout("ilp32-packed", 4, 4, true),
+		};
+		for (DataLayout * target : targets){
+			if (target->myName == name){ return target; }
+		}
+		return nullptr;
+	}
+	static std::string knownTargets(){
+		return "lp64 (default), lp64-packed, ilp32, ilp32-packed";
+	}
+	static const DataLayout * reference(){
+		return produce("lp64");
+	}
+	static const DataLayout * target(){
+		return selected(nullptr);
+	}
+	static void setTarget(const DataLayout * targetIn){
+		selected(targetIn);
+	}
+
+	std::string getName() const { return myName; }
+	bool packsBools() const { return myPackBools; }
+	size_t frameAlign() const { return myWordSize; }
+	//Bytes each call pushes besides the callee's frame: the
+	// return address and the saved frame pointer
+	size_t linkageSize() const { return 2 * myWordSize; }
+
+	size_t sizeOf(BaseType base) const {
+		switch(base){
+		case BaseType::BOOL: return 1;
+		case BaseType::BYTE: return 1;
+		case BaseType::INT: return myIntSize;
+		case BaseType::VOID: return myWordSize;
+		}
+		return 0;
+	}
+	size_t alignOf(BaseType base) const {
+		//Scalars are naturally aligned
+		return sizeOf(base);
+	}
+	size_t arraySize(BaseType elt, size_t length) const {
+		if (elt == BaseType::BOOL && myPackBools){
+			return (length + 7) / 8;
+		}
+		return length * sizeOf(elt);
+	}
+	size_t arrayAlign(BaseType elt) const {
+		if (elt == BaseType::BOOL && myPackBools){ return 1; }
+		return alignOf(elt);
+	}
+private:
+	DataLayout(std::string nameIn, size_t intSizeIn,
+	  size_t wordSizeIn, bool packBoolsIn)
+	: myName(nameIn), myIntSize(intSizeIn),
+	  myWordSize(wordSizeIn), myPackBools(packBoolsIn){ }
+	static const DataLayout * selected(const DataLayout * newTarget){
+		static const DataLayout * current = reference();
+		if (newTarget != nullptr){ current = newTarget; }
+		return current;
+	}
+	std::string myName;
+	size_t myIntSize;
+	size_t myWordSize;
+	bool myPackBools;
+};
+
 //This class is the superclass for all crona types. You
 // can get information about which type is implemented
 // concretely using the as<X> functions, or query information
 // using the is<X> functions.
 class DataType{
 public:
+	CRONA_ALLOC_CLASS(TYPES)
 	virtual std::string getString() const = 0;
 	virtual const BasicType * asBasic() const { return nullptr; }
 	virtual const ArrayType * asArray() const { return nullptr; }
@@ -45,8 +138,26 @@ public:
 	virtual bool isByte() const { return false; }
 	virtual bool isArray() const { return false; }
 	virtual bool validVarType() const = 0 ;
-	virtual size_t getSize() const = 0;
+	//The number of bytes and the boundary (in bytes) that
+	// storage of this type needs on the selected target
+	size_t getSize() const { 
+		return sizeIn(DataLayout::target());
+	}
+	size_t getAlignment() const { 
+		return alignIn(DataLayout::target());
+	}
+	//The same, on a given target
+	virtual size_t sizeIn(const DataLayout * target) const = 0;
+	virtual size_t alignIn(const DataLayout * target) const = 0;
+	//The same text as getString, made once with the type, for
+	// writers that print a type at every use of a name
+	const std::string& str() const { return myString; }
 protected:
+	DataType(){ TimeReport::counts().types++; }
+	//Each concrete type calls this once it is fully built
+	void cacheString(){ myString = getString(); }
+private:
+	std::string myString;
 };
 
 //This DataType subclass is the superclass for all crona types. 
@@ -67,11 +178,17 @@ public:
 		return "ERROR";
 	}
 	virtual bool validVarType() const override { return false; }
-	virtual size_t getSize() const override { return 0; }
+	virtual size_t sizeIn(const DataLayout *) const override {
+		return 0; 
+	}
+	virtual size_t alignIn(const DataLayout *) const override {
+		return 1; 
+	}
 private:
 	ErrorType(){ 
 		/* private constructor, can only 
 		be called from produce */
+		cacheString();
 	}
 	size_t line;
 	size_t col;
@@ -112,15 +229,28 @@ public:
 		// multiple calls to this function (it is essentially
 		// a global variable that can only be accessed
 		// in this function).
-		static std::list<BasicType *> flyweights;
+		//There are only a handful of base types, so all
+		// of them are made up front. Initialization of a static
+		// local happens exactly once even when several threads
+		// get here together, and the list is never changed
+		// afterwards, so no locking is needed to read it.
+		static std::list<BasicType *> flyweights = {
+			new BasicType(BaseType::INT),
+			new BasicType(BaseType::VOID),
+			new BasicType(BaseType::BOOL),
+			new BasicType(BaseType::BYTE),
+		};
+		size_t looked = 0;
 		for(BasicType * fly : flyweights){
+			looked++;
 			if (fly->getBaseType() == base){
+				if (Census * census = Census::current()){
+					census->basicScan(looked);
+				}
 				return fly;
 			}
 		}
-		BasicType * newType = new BasicType(base);
-		flyweights.push_back(newType);
-		return newType;
+		throw new InternalError("Unknown base type");
 	}
 	const BasicType * asBasic() const override {
 		return this;
@@ -145,16 +275,17 @@ public:
 	}
 	virtual BaseType getBaseType() const { return myBaseType; }
 	virtual std::string getString() const override;
-	virtual size_t getSize() const override { 
-		if (isBool()){ return 1; }
-		else if (isByte()){ return 1; }
-		else if (isVoid()){ return 8; }
-		else if (isInt()){ return 8; }
-		else { return 0; }
+	virtual size_t sizeIn(const DataLayout * target) const override { 
+		return target->sizeOf(myBaseType);
+	}
+	virtual size_t alignIn(const DataLayout * target) const override {
+		return target->alignOf(myBaseType);
 	}
 private:
 	BasicType(BaseType base) 
-	: myBaseType(base){ }
+	: myBaseType(base){ 
+		cacheString();
+	}
 	BaseType myBaseType;
 };
 
@@ -167,15 +298,24 @@ public:
 		// a global variable that can only be accessed
 		// in this function).
 		static std::list<ArrayType *> flyweights;
+		//Array types are made on demand, so the list is
+		// guarded for compilations running side by side
+		static std::mutex flyweightsLock;
+		std::lock_guard<std::mutex> guard(flyweightsLock);
+		Census * census = Census::current();
+		size_t looked = 0;
 		for(ArrayType * fly : flyweights){
+			looked++;
 			if (fly->myBasicType == basicType){
 				if (fly->myLength == length){
+					if (census){ census->arrayScan(looked, flyweights.size()); }
 					return fly;
 				}
 			}
 		}
 		ArrayType * newType = new ArrayType(basicType, length);
 		flyweights.push_back(newType);
+		if (census){ census->arrayScan(looked, flyweights.size()); }
 		return newType;
 	}
 
@@ -195,16 +335,20 @@ public:
 	}
 	bool isArray() const override { return true; } 
 	const ArrayType * asArray() const override { return this; }
-	int getLength(){ return myLength; }
-	size_t getSize() const override { 
+	int getLength() const { return myLength; }
+	size_t sizeIn(const DataLayout * target) const override { 
 		const size_t lonLength = static_cast<size_t>(myLength);
-		return lonLength * myBasicType->getSize(); 
+		return target->arraySize(myBasicType->getBaseType(), lonLength); 
+	}
+	size_t alignIn(const DataLayout * target) const override {
+		return target->arrayAlign(myBasicType->getBaseType());
 	}
 	
 private:
 	ArrayType(const BasicType * basicType, int length)
 	: myBasicType(basicType), myLength(length){
 		/* private constructor, can only be called from produce */
+		cacheString();
 	}
 	const BasicType * myBasicType;
 	int myLength;
@@ -219,6 +363,10 @@ public:
 	  myFormalTypes(formalsIn),
 	  myRetType(retTypeIn)
 	{
+		cacheString();
+		if (Census * census = Census::current()){
+			census->fnTypeMade(str());
+		}
 	}
 	std::string getString() const override{
 		std::string result = "";
@@ -241,7 +389,12 @@ public:
 		return myFormalTypes;
 	}
 	virtual bool validVarType() const override { return false; }
-	virtual size_t getSize() const override { return 0; }
+	virtual size_t sizeIn(const DataLayout *) const override {
+		return 0; 
+	}
+	virtual size_t alignIn(const DataLayout *) const override {
+		return 1; 
+	}
 private:
 	const std::list<const DataType *> * myFormalTypes;
 	const DataType * myRetType;
@@ -1,340 +1,388 @@
+#include <vector>
 #include "ast.hpp"
 #include "errors.hpp"
 #include "symbol_table.hpp"
+#include "work_pool.hpp"
 
 namespace crona{
 
-static void doIndent(std::ostream& out, int indent){
-	for (int k = 0 ; k < indent; k++){ out << "\t"; }
+void ImportNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("import \"");
+	out.put(myName);
+	out.put("\";\n");
 }
 
-void ProgramNode::unparse(std::ostream& out, int indent){
+void ProgramNode::unparse(OutBuffer& out, int indent){
+	for (ImportNode * import : *myImports){
+		import->unparse(out, indent);
+	}
 	for (DeclNode * decl : *myGlobals){
 		decl->unparse(out, indent);
 	}
 }
 
-void VarDeclNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent); 
+void ProgramNode::unparseParallel(OutBuffer& out, size_t workers){
+	if (workers <= 1 || myGlobals->size() <= 1){
+		unparse(out, 0);
+		return;
+	}
+	for (ImportNode * import : *myImports){
+		import->unparse(out, 0);
+	}
+	//Unparsing only reads the tree, so runs of globals can be
+	// rendered side by side. Each run is a few times smaller
+	// than a worker's share, so the load evens out.
+	size_t runLength = myGlobals->size() / (workers * 4);
+	if (runLength == 0){ runLength = 1; }
+	std::vector<OutBuffer *> pieces;
+	WorkPool pool(workers);
+	auto runStart = myGlobals->begin();
+	while (runStart != myGlobals->end()){
+		auto runEnd = runStart;
+		for (size_t k = 0; k < runLength && runEnd != myGlobals->end(); k++){
+			runEnd++;
+		}
+		OutBuffer * piece = new OutBuffer();
+		piece->showSymbols(out.showsSymbols());
+		pieces.push_back(piece);
+		pool.add([runStart, runEnd, piece](){
+			for (auto itr = runStart; itr != runEnd; itr++){
+				(*itr)->unparse(*piece, 0);
+			}
+		});
+		runStart = runEnd;
+	}
+	pool.run();
+	for (auto piece : pieces){
+		out.put(*piece);
+		delete piece;
+	}
+}
+
+void VarDeclNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent); 
 	myID->unparse(out, 0);
-	out << ":";
+	out.put(":");
 	myType->unparse(out, 0);
-	out << ";\n";
+	out.put(";\n");
 }
 
-void FormalDeclNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent); 
+void FormalDeclNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent); 
 	ID()->unparse(out, 0);
-	out << ":";
+	out.put(":");
 	getTypeNode()->unparse(out, 0);
 }
 
-void FnDeclNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent); 
+void FnDeclNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent); 
 	myID->unparse(out, 0);
-	out << ":";
+	out.put(":");
 	myRetType->unparse(out, 0); 
-	out << "(";
+	out.put("(");
 	bool firstFormal = true;
 	for(auto formal : *myFormals){
 		if (firstFormal) { firstFormal = false; }
-		else { out << ", "; }
+		else { out.put(", "); }
 		formal->unparse(out, 0);
 	}
-	out << "){\n";
+	out.put("){\n");
 	for(auto stmt : *myBody){
 		stmt->unparse(out, indent+1);
 	}
-	doIndent(out, indent);
-	out << "}\n";
+	out.indent(indent);
+	out.put("}\n");
 }
 
-void AssignStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void AssignStmtNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myExp->unparse(out,0);
-	out << ";\n";
+	out.put(";\n");
 }
 
-void ReadStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "read ";
+void ReadStmtNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("read ");
 	myDst->unparse(out,0);
-	out << ";\n";
+	out.put(";\n");
 }
 
-void WriteStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "write ";
+void WriteStmtNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("write ");
 	mySrc->unparse(out,0);
-	out << ";\n";
+	out.put(";\n");
 }
 
-void PostIncStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void PostIncStmtNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myLVal->unparse(out,0);
-	out << "++;\n";
+	out.put("++;\n");
 }
 
-void PostDecStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void PostDecStmtNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myLVal->unparse(out,0);
-	out << "--;\n";
+	out.put("--;\n");
 }
 
-void IfStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "if (";
+void IfStmtNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("if (");
 	myCond->unparse(out, 0);
-	out << "){\n";
+	out.put("){\n");
 	for (auto stmt : *myBody){
 		stmt->unparse(out, indent + 1);
 	}
-	doIndent(out, indent);
-	out << "}\n";
+	out.indent(indent);
+	out.put("}\n");
 }
 
-void IfElseStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "if (";
+void IfElseStmtNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("if (");
 	myCond->unparse(out, 0);
-	out << "){\n";
+	out.put("){\n");
 	for (auto stmt : *myBodyTrue){
 		stmt->unparse(out, indent + 1);
 	}
-	doIndent(out, indent);
-	out << "} else {\n";
+	out.indent(indent);
+	out.put("} else {\n");
 	for (auto stmt : *myBodyFalse){
 		stmt->unparse(out, indent + 1);
 	}
-	doIndent(out, indent);
-	out << "}\n";
+	out.indent(indent);
+	out.put("}\n");
 }
 
-void WhileStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "while (";
+void WhileStmtNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("while (");
 	myCond->unparse(out, 0);
-	out << "){\n";
+	out.put("){\n");
 	for (auto stmt : *myBody){
 		stmt->unparse(out, indent + 1);
 	}
-	doIndent(out, indent);
-	out << "}\n";
+	out.indent(indent);
+	out.put("}\n");
 }
 
-void ReturnStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "return";
+void ReturnStmtNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("return");
 	if (myExp != nullptr){
-		out << " ";
+		out.put(" ");
 		myExp->unparse(out, 0);
 	}
-	out << ";\n";
+	out.put(";\n");
 }
 
-void CallStmtNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void CallStmtNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myCallExp->unparse(out, 0);
-	out << ";\n";
+	out.put(";\n");
 }
 
-void ExpNode::unparseNested(std::ostream& out){
-	out << "(";
+void ExpNode::unparseNested(OutBuffer& out){
+	out.put("(");
 	unparse(out, 0);
-	out << ")";
+	out.put(")");
 }
 
-void CallExpNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void CallExpNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myID->unparse(out, 0);
-	out << "(";
+	out.put("(");
 	
 	bool firstArg = true;
 	for(auto arg : *myArgs){
 		if (firstArg) { firstArg = false; }
-		else { out << ", "; }
+		else { out.put(", "); }
 		arg->unparse(out, 0);
 	}
-	out << ")";
+	out.put(")");
 }
-void CallExpNode::unparseNested(std::ostream& out){
+void CallExpNode::unparseNested(OutBuffer& out){
 	unparse(out, 0);
 }
 
-void IndexNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void IndexNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myBase->unparseNested(out);
-	out << "[";
+	out.put("[");
 	myOffset->unparse(out, 0);
-	out << "]";
+	out.put("]");
 }
 
-void MinusNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void MinusNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myExp1->unparseNested(out); 
-	out << " - ";
+	out.put(" - ");
 	myExp2->unparseNested(out);
 }
 
-void PlusNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void PlusNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myExp1->unparseNested(out); 
-	out << " + ";
+	out.put(" + ");
 	myExp2->unparseNested(out);
 }
 
-void TimesNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void TimesNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myExp1->unparseNested(out); 
-	out << " * ";
+	out.put(" * ");
 	myExp2->unparseNested(out);
 }
 
-void DivideNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void DivideNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myExp1->unparseNested(out); 
-	out << " / ";
+	out.put(" / ");
 	myExp2->unparseNested(out);
 }
 
-void AndNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void AndNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myExp1->unparseNested(out); 
-	out << " && ";
+	out.put(" && ");
 	myExp2->unparseNested(out);
 }
 
-void OrNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void OrNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myExp1->unparseNested(out); 
-	out << " || ";
+	out.put(" || ");
 	myExp2->unparseNested(out);
 }
 
-void EqualsNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void EqualsNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myExp1->unparseNested(out); 
-	out << " == ";
+	out.put(" == ");
 	myExp2->unparseNested(out);
 }
 
-void NotEqualsNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void NotEqualsNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myExp1->unparseNested(out); 
-	out << " != ";
+	out.put(" != ");
 	myExp2->unparseNested(out);
 }
 
-void GreaterNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void GreaterNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myExp1->unparseNested(out); 
-	out << " > ";
+	out.put(" > ");
 	myExp2->unparseNested(out);
 }
 
-void GreaterEqNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void GreaterEqNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myExp1->unparseNested(out); 
-	out << " >= ";
+	out.put(" >= ");
 	myExp2->unparseNested(out);
 }
 
-void LessNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void LessNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myExp1->unparseNested(out); 
-	out << " < ";
+	out.put(" < ");
 	myExp2->unparseNested(out);
 }
 
-void LessEqNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void LessEqNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myExp1->unparseNested(out); 
-	out << " <= ";
+	out.put(" <= ");
 	myExp2->unparseNested(out);
 }
 
-void NotNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "!";
+void NotNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("!");
 	myExp->unparseNested(out); 
 }
 
-void NegNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "-";
+void NegNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("-");
 	myExp->unparseNested(out); 
 }
 
-void VoidTypeNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "void";
+void VoidTypeNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("void");
 }
 
-void IntTypeNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "int";
+void IntTypeNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("int");
 }
 
-void BoolTypeNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "bool";
+void BoolTypeNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("bool");
 }
 
-void ByteTypeNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "byte";
+void ByteTypeNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("byte");
 }
 
-void ArrayTypeNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void ArrayTypeNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myBase->unparse(out, 0);
-	out << " array[" << myLen << "]";
+	out.put(" array[");
+	out.putUInt(myLen);
+	out.put(']');
 }
 
-void AssignExpNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
+void AssignExpNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
 	myDst->unparseNested(out);
-	out << " = ";
+	out.put(" = ");
 	mySrc->unparseNested(out);
 }
 
-void LValNode::unparseNested(std::ostream& out){
+void LValNode::unparseNested(OutBuffer& out){
 	unparse(out, 0);
 }
 
-void IDNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << name;
-	if (mySymbol != nullptr){
-		out << "("
-		  << mySymbol->getDataType()->getString()
-		  << ")";
+void IDNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put(name);
+	if (mySymbol != nullptr && out.showsSymbols()){
+		out.put('(');
+		out.put(mySymbol->getDataType()->str());
+		out.put(')');
 	}
 }
 
-void HavocNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "havoc";
+void HavocNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("havoc");
 }
 
-void IntLitNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << myNum;
+void IntLitNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.putInt(myNum);
 }
 
-void StrLitNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << myStr;
+void StrLitNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put(myStr);
 }
 
-void FalseNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "false";
+void FalseNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("false");
 }
 
-void TrueNode::unparse(std::ostream& out, int indent){
-	doIndent(out, indent);
-	out << "true";
+void TrueNode::unparse(OutBuffer& out, int indent){
+	out.indent(indent);
+	out.put("true");
 }
 
 } //End namespace crona
@@ -0,0 +1,69 @@
+#include <thread>
+#include "trace.hpp"
+#include "work_pool.hpp"
+
+namespace crona{
+
+WorkPool::WorkPool(size_t workersIn){
+	if (workersIn == 0){ workersIn = 1; }
+	for (size_t i = 0; i < workersIn; i++){
+		queues.push_back(new Queue());
+	}
+	nextQueue = 0;
+}
+
+WorkPool::~WorkPool(){
+	for (auto queue : queues){
+		delete queue;
+	}
+}
+
+size_t WorkPool::defaultWorkers(){
+	size_t hardware = std::thread::hardware_concurrency();
+	if (hardware == 0){ return 1; }
+	return hardware;
+}
+
+void WorkPool::add(std::function<void()> job){
+	queues[nextQueue]->jobs.push_back(job);
+	nextQueue = (nextQueue + 1) % queues.size();
+}
+
+bool WorkPool::take(size_t self, std::function<void()>& job){
+	//Own queue first, then every other queue in turn
+	for (size_t k = 0; k < queues.size(); k++){
+		Queue * queue = queues[(self + k) % queues.size()];
+		std::lock_guard<std::mutex> guard(queue->lock);
+		if (!queue->jobs.empty()){
+			job = queue->jobs.front();
+			queue->jobs.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkPool::work(size_t self){
+	//No job adds more jobs, so once nothing can be taken
+	// from any queue this worker is done
+	if (self != 0){
+		Trace::nameThread("worker " + std::to_string(self));
+	}
+	std::function<void()> job;
+	while (take(self, job)){
+		job();
+	}
+}
+
+void WorkPool::run(){
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < queues.size(); i++){
+		threads.push_back(std::thread(&WorkPool::work, this, i));
+	}
+	work(0);
+	for (auto& thread : threads){
+		thread.join();
+	}
+}
+
+}
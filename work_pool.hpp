@@ -0,0 +1,47 @@
+#ifndef CRONA_WORK_POOL
+#define CRONA_WORK_POOL
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace crona{
+
+// A fixed set of worker threads, each with its own queue of
+// jobs. Jobs are dealt out round-robin in the order they are
+// added, so adding them largest first gives every worker a
+// share of the large ones. A worker runs its own jobs in order,
+// and once its queue is empty it steals the next job waiting in
+// another worker's queue, so no worker sits idle while any
+// job is still waiting.
+class WorkPool{
+public:
+	WorkPool(size_t workersIn);
+	~WorkPool();
+
+	void add(std::function<void()> job);
+
+	//Run every added job, using the calling thread as one of
+	// the workers, and return once all of them have finished
+	void run();
+
+	//One worker per hardware thread
+	static size_t defaultWorkers();
+
+private:
+	class Queue{
+	public:
+		std::mutex lock;
+		std::deque<std::function<void()>> jobs;
+	};
+	bool take(size_t self, std::function<void()>& job);
+	void work(size_t self);
+
+	std::vector<Queue *> queues;
+	size_t nextQueue;
+};
+
+}
+
+#endif
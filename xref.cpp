@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "errors.hpp"
+#include "xref.hpp"
+
+namespace crona{
+
+XrefBuilder::Entry * XrefBuilder::entry(SemSymbol * sym){
+	auto found = entries.find(sym);
+	if (found != entries.end()){ return found->second; }
+	Entry * newEntry = new Entry(sym);
+	entries[sym] = newEntry;
+	order.push_back(newEntry);
+	return newEntry;
+}
+
+void XrefBuilder::addDef(SemSymbol * sym, size_t line, size_t col){
+	entry(sym)->def = Site(line, col);
+}
+
+void XrefBuilder::addUse(SemSymbol * sym, size_t line, size_t col){
+	entry(sym)->uses.push_back(Site(line, col));
+}
+
+static bool siteBefore(size_t l1, size_t c1, size_t l2, size_t c2){
+	return l1 < l2 || (l1 == l2 && c1 < c2);
+}
+
+static uint32_t word(size_t val){
+	return static_cast<uint32_t>(val);
+}
+
+void XrefBuilder::write(std::ostream& out){
+	std::sort(order.begin(), order.end(), [](Entry * a, Entry * b){
+		int byName = a->sym->getName().compare(b->sym->getName());
+		if (byName != 0){ return byName < 0; }
+		return siteBefore(a->def.line, a->def.col, 
+			b->def.line, b->def.col);
+	});
+
+	size_t nSyms = order.size();
+	size_t nUses = 0;
+	for (auto e : order){ nUses += e->uses.size(); }
+	size_t nPos = nSyms + nUses;
+
+	size_t symOff = XrefIndex::HEADER_WORDS;
+	size_t useOff = symOff + nSyms * XrefIndex::SYM_WORDS;
+	size_t posOff = useOff + nUses * XrefIndex::USE_WORDS;
+	size_t strOff = posOff + nPos * XrefIndex::POS_WORDS;
+
+	std::vector<uint32_t> words(strOff, 0);
+	std::string pool;
+	HashMap<std::string, size_t> interned;
+	auto intern = [&](const std::string& s){
+		auto found = interned.find(s);
+		if (found != interned.end()){ return found->second; }
+		size_t off = pool.size();
+		pool += s;
+		interned[s] = off;
+		return off;
+	};
+
+	std::vector<Site> posSites;
+	std::vector<size_t> posSyms;
+	posSites.reserve(nPos);
+	posSyms.reserve(nPos);
+
+	size_t nextUse = 0;
+	for (size_t i = 0; i < nSyms; i++){
+		Entry * e = order[i];
+		std::sort(e->uses.begin(), e->uses.end(), [](Site a, Site b){
+			return siteBefore(a.line, a.col, b.line, b.col);
+		});
+		std::string name = e->sym->getName();
+		DataType * type = e->sym->getDataType();
+		std::string typeStr = type == nullptr ? "NULL" : type->getString();
+		size_t nameAt = intern(name);
+		size_t typeAt = intern(typeStr);
+
+		uint32_t * rec = &words[symOff + i * XrefIndex::SYM_WORDS];
+		rec[0] = word(nameAt);
+		rec[1] = word(name.size());
+		rec[2] = word(static_cast<size_t>(e->sym->getKind()));
+		rec[3] = word(typeAt);
+		rec[4] = word(typeStr.size());
+		rec[5] = word(e->def.line);
+		rec[6] = word(e->def.col);
+		rec[7] = word(nextUse);
+		rec[8] = word(e->uses.size());
+
+		posSites.push_back(e->def);
+		posSyms.push_back(i);
+		for (auto use : e->uses){
+			uint32_t * useRec = &words[useOff + nextUse * XrefIndex::USE_WORDS];
+			useRec[0] = word(use.line);
+			useRec[1] = word(use.col);
+			nextUse++;
+			posSites.push_back(use);
+			posSyms.push_back(i);
+		}
+	}
+
+	std::vector<size_t> posOrder(nPos);
+	for (size_t i = 0; i < nPos; i++){ posOrder[i] = i; }
+	std::sort(posOrder.begin(), posOrder.end(), [&](size_t a, size_t b){
+		return siteBefore(posSites[a].line, posSites[a].col,
+			posSites[b].line, posSites[b].col);
+	});
+	for (size_t i = 0; i < nPos; i++){
+		uint32_t * rec = &words[posOff + i * XrefIndex::POS_WORDS];
+		size_t from = posOrder[i];
+		rec[0] = word(posSites[from].line);
+		rec[1] = word(posSites[from].col);
+		rec[2] = word(posSyms[from]);
+	}
+
+	words[0] = XrefIndex::MAGIC;
+	words[1] = XrefIndex::VERSION;
+	words[2] = word(nSyms);
+	words[3] = word(nUses);
+	words[4] = word(nPos);
+	words[5] = word(pool.size());
+	words[6] = word(symOff);
+	words[7] = word(useOff);
+	words[8] = word(posOff);
+	words[9] = word(strOff);
+
+	out.write(reinterpret_cast<const char *>(words.data()), 
+		static_cast<std::streamsize>(words.size() * sizeof(uint32_t)));
+	out.write(pool.data(), static_cast<std::streamsize>(pool.size()));
+	if (Census * census = Census::current()){
+		census->hashMap("xref symbols", entries);
+		census->hashMap("xref strings", interned);
+	}
+}
+
+XrefIndex * XrefIndex::open(const char * path){
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0){ return nullptr; }
+	struct stat info;
+	if (fstat(fd, &info) != 0){
+		close(fd);
+		return nullptr;
+	}
+	size_t bytes = static_cast<size_t>(info.st_size);
+	if (bytes < HEADER_WORDS * sizeof(uint32_t)){
+		close(fd);
+		return nullptr;
+	}
+	void * map = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED){ return nullptr; }
+
+	if (!tablesFit(static_cast<const uint32_t *>(map), bytes)){
+		munmap(map, bytes);
+		return nullptr;
+	}
+	return new XrefIndex(map, bytes);
+}
+
+//Whether the header is an index's, and every table it places
+// lies inside the file and after the header. Each record's own
+// offsets are checked as the record is read.
+bool XrefIndex::tablesFit(const uint32_t * header, size_t bytes){
+	if (header[0] != MAGIC || header[1] != VERSION){ return false; }
+	size_t totalWords = bytes / sizeof(uint32_t);
+	//Words are 32 bits and sizes 64, so none of these overflow
+	size_t tables[3][2] = {
+		{ header[6], header[2] * SYM_WORDS },
+		{ header[7], header[3] * USE_WORDS },
+		{ header[8], header[4] * POS_WORDS },
+	};
+	for (auto& table : tables){
+		if (table[0] < HEADER_WORDS || table[0] + table[1] > totalWords){
+			return false;
+		}
+	}
+	size_t strStart = header[9] * sizeof(uint32_t);
+	return strStart >= HEADER_WORDS * sizeof(uint32_t)
+	  && strStart + header[5] <= bytes;
+}
+
+XrefIndex::XrefIndex(void * mapIn, size_t bytesIn)
+: map(mapIn), bytes(bytesIn){
+	words = static_cast<const uint32_t *>(map);
+	nSyms = words[2];
+	nUses = words[3];
+	nPos = words[4];
+	strBytes = words[5];
+	symOff = words[6];
+	useOff = words[7];
+	posOff = words[8];
+	strings = static_cast<const char *>(map) + words[9] * sizeof(uint32_t);
+}
+
+XrefIndex::~XrefIndex(){
+	munmap(map, bytes);
+}
+
+void XrefIndex::writeSym(size_t i, std::ostream& out){
+	const uint32_t * rec = sym(i);
+	out << str(rec[0], rec[1])
+	  << "\t" << SemSymbol::kindToString(static_cast<SymbolKind>(rec[2]))
+	  << "\t" << str(rec[3], rec[4])
+	  << "\t[" << rec[5] << "," << rec[6] << "]\n";
+	//A corrupt record's uses are left out rather than read from
+	// outside the table
+	if (static_cast<size_t>(rec[7]) + rec[8] > nUses){ return; }
+	const uint32_t * use = words + useOff + rec[7] * USE_WORDS;
+	for (uint32_t u = 0; u < rec[8]; u++){
+		out << "\t[" << use[0] << "," << use[1] << "]\n";
+		use += USE_WORDS;
+	}
+}
+
+void XrefIndex::queryName(std::string name, std::ostream& out){
+	//Find the first symbol whose name is not less than name
+	size_t lo = 0;
+	size_t hi = nSyms;
+	while (lo < hi){
+		size_t mid = lo + (hi - lo) / 2;
+		const uint32_t * rec = sym(mid);
+		if (compareName(name, rec) > 0){
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	for (size_t i = lo; i < nSyms; i++){
+		const uint32_t * rec = sym(i);
+		if (compareName(name, rec) != 0){
+			break;
+		}
+		writeSym(i, out);
+	}
+}
+
+void XrefIndex::queryPos(size_t line, size_t col, std::ostream& out){
+	//Find the last definition or use starting at or before
+	// the given place, then check that its name covers it
+	size_t lo = 0;
+	size_t hi = nPos;
+	while (lo < hi){
+		size_t mid = lo + (hi - lo) / 2;
+		const uint32_t * rec = pos(mid);
+		if (siteBefore(line, col, rec[0], rec[1])){
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	if (lo == 0){ return; }
+	const uint32_t * rec = pos(lo - 1);
+	size_t symIdx = rec[2];
+	if (symIdx >= nSyms){ return; }
+	if (rec[0] != line || col >= rec[1] + sym(symIdx)[1]){ return; }
+	writeSym(symIdx, out);
+}
+
+//Read one number at text, leaving end just past it. strtoul
+// alone would also take a sign or leading space.
+static bool parseNumber(const char * text, const char *& end, 
+	size_t& value){
+	if (!isdigit(static_cast<unsigned char>(*text))){ return false; }
+	char * stop;
+	errno = 0;
+	unsigned long parsed = strtoul(text, &stop, 10);
+	if (errno == ERANGE){ return false; }
+	value = parsed;
+	end = stop;
+	return true;
+}
+
+bool XrefIndex::parsePos(const std::string& key, size_t& line, 
+	size_t& col){
+	const char * end;
+	return parseNumber(key.c_str(), end, line) && *end == ':'
+	  && parseNumber(end + 1, end, col) && *end == '\0'
+	  && end == key.c_str() + key.size();
+}
+
+bool XrefIndex::query(std::string key, std::ostream& out){
+	//No name has a colon in it
+	if (key.find(':') == std::string::npos){
+		queryName(key, out);
+		return true;
+	}
+	size_t line;
+	size_t col;
+	if (!parsePos(key, line, col)){ return false; }
+	queryPos(line, col, out);
+	return true;
+}
+
+}
@@ -0,0 +1,128 @@
+#ifndef CRONA_XREF
+#define CRONA_XREF
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "symbol_table.hpp"
+
+namespace crona{
+
+// A cross-reference index maps every symbol (name, kind, type
+// and place of definition) to each place it is used. It is
+// collected by an XrefBuilder while name analysis runs and is
+// written as a flat binary file of 32-bit words, laid out so
+// that it can be mapped into memory and searched as-is:
+//
+//	header		magic, version, nSyms, nUses, nPos, 
+//			strBytes, symOff, useOff, posOff, strOff
+//	symbols		nameOff, nameLen, kind, typeOff, typeLen,
+//			defLine, defCol, firstUse, useCount
+//			(sorted by name, then place of definition)
+//	uses		line, col
+//			(grouped by symbol, then sorted by place)
+//	positions	line, col, symbol
+//			(every definition and use, sorted by place)
+//	strings		names and type strings, not terminated
+//
+// Offsets are in words from the start of the file.
+class XrefBuilder{
+public:
+	void addDef(SemSymbol * sym, size_t line, size_t col);
+	void addUse(SemSymbol * sym, size_t line, size_t col);
+	void write(std::ostream& out);
+private:
+	class Site{
+	public:
+		Site(size_t lineIn, size_t colIn) 
+		: line(lineIn), col(colIn){ }
+		size_t line;
+		size_t col;
+	};
+	class Entry{
+	public:
+		Entry(SemSymbol * symIn) 
+		: sym(symIn), def(0, 0){ }
+		SemSymbol * sym;
+		Site def;
+		std::vector<Site> uses;
+	};
+	Entry * entry(SemSymbol * sym);
+
+	HashMap<SemSymbol *, Entry *> entries;
+	std::vector<Entry *> order;
+};
+
+// A written index, mapped read-only into memory. Lookups by
+// name and by position are binary searches over the mapped
+// tables; nothing is parsed or copied.
+class XrefIndex{
+public:
+	//Map the index at path, or return nullptr if it can't
+	// be opened or isn't an index
+	static XrefIndex * open(const char * path);
+	~XrefIndex();
+
+	//Write every symbol with the given name, with its uses
+	void queryName(std::string name, std::ostream& out);
+	//Write the symbol defined or used at the given place,
+	// with its uses
+	void queryPos(size_t line, size_t col, std::ostream& out);
+	//Dispatch on the form of the key: one with a colon is a
+	// position, anything else is a name. Returns false, writing
+	// nothing, if the key is not a well-formed "line:col".
+	bool query(std::string key, std::ostream& out);
+	//Read a "line:col" key, returning false unless it is two
+	// decimal numbers that fit in a size_t and nothing else
+	static bool parsePos(const std::string& key, size_t& line, 
+		size_t& col);
+
+	static const uint32_t MAGIC = 0x49585243; // "CRXI"
+	static const uint32_t VERSION = 1;
+	static const size_t HEADER_WORDS = 10;
+	static const size_t SYM_WORDS = 9;
+	static const size_t USE_WORDS = 2;
+	static const size_t POS_WORDS = 3;
+
+private:
+	XrefIndex(void * mapIn, size_t bytesIn);
+	static bool tablesFit(const uint32_t * header, size_t bytes);
+	const uint32_t * sym(size_t i) const { 
+		return words + symOff + i * SYM_WORDS;
+	}
+	const uint32_t * pos(size_t i) const { 
+		return words + posOff + i * POS_WORDS;
+	}
+	bool inStrings(uint32_t off, uint32_t len) const {
+		return static_cast<size_t>(off) + len <= strBytes;
+	}
+	//A string of the pool, or an empty one if a corrupt record
+	// places it outside the pool
+	std::string str(uint32_t off, uint32_t len) const {
+		if (!inStrings(off, len)){ return std::string(); }
+		return std::string(strings + off, len);
+	}
+	//How name compares to the name of a symbol record
+	int compareName(const std::string& name, const uint32_t * rec) const {
+		if (!inStrings(rec[0], rec[1])){ return name.compare(""); }
+		return name.compare(0, name.size(), strings + rec[0], rec[1]);
+	}
+	void writeSym(size_t i, std::ostream& out);
+
+	void * map;
+	size_t bytes;
+	const uint32_t * words;
+	const char * strings;
+	size_t nSyms;
+	size_t nUses;
+	size_t nPos;
+	size_t strBytes;
+	size_t symOff;
+	size_t useOff;
+	size_t posOff;
+};
+
+}
+
+#endif